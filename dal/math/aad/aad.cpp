@@ -14,6 +14,7 @@
 #include <dal/math/aad/aad.hpp>
 
 namespace Dal::AAD {
-    size_t TapNode_::numAdj_ = 1;
-    bool Tape_::multi_ = false;
+    thread_local size_t TapNode_::numAdj_ = 1;
+    thread_local bool Tape_::multi_ = false;
+    size_t Tape_::blockSize_ = BLOCK_SIZE;
 }
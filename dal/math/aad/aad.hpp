@@ -12,22 +12,43 @@
 
 #pragma once
 #include <dal/math/aad/expr.hpp>
+#include <dal/math/aad/dual.hpp>
+#include <dal/math/aad/dual2.hpp>
 
 namespace Dal::AAD {
 
     struct NumResultsResetterForAAD_ {
+        bool multi_;
+        size_t numAdj_;
         ~NumResultsResetterForAAD_() {
-            Tape_::multi_ = false;
-            TapNode_::numAdj_ = 1;
+            Tape_::multi_ = multi_;
+            TapNode_::numAdj_ = numAdj_;
         }
     };
 
+    //  applies to the calling thread only, until the returned resetter restores its previous setting
     FORCE_INLINE auto SetNumResultsForAAD(bool multi = false, size_t num_results = 1) {
+        auto retval = std::make_unique<NumResultsResetterForAAD_>(NumResultsResetterForAAD_{Tape_::multi_, TapNode_::numAdj_});
         Tape_::multi_ = multi;
         TapNode_::numAdj_ = num_results;
-        return std::make_unique<NumResultsResetterForAAD_>();
+        return retval;
     }
 
+    //  Records on tape while in scope, then restores the previous tape of the thread, also when leaving on an exception
+    class TapeScope_ {
+        Tape_* previous_;
+
+    public:
+        explicit TapeScope_(Tape_& tape) : previous_(Number_::Tape()) { Number_::SetTape(tape); }
+        ~TapeScope_() {
+            if (previous_)
+                Number_::SetTape(*previous_);
+        }
+
+        TapeScope_(const TapeScope_&) = delete;
+        TapeScope_& operator=(const TapeScope_&) = delete;
+    };
+
     template <class IT_> FORCE_INLINE void PutOnTape(IT_ begin, IT_ end) {
         std::for_each(begin, end, [](Number_& n) { n.PutOnTape(); });
     }
@@ -12,85 +12,155 @@
 
 #pragma once
 
-#include <array>
+#include <algorithm>
 #include <cstring>
+#include <functional>
 #include <iterator>
-#include <list>
+#include <memory>
+#include <new>
+#include <vector>
+#include <dal/utilities/exceptions.hpp>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
 
 namespace Dal::AAD {
 
+    //  Blocks are carved out of contiguous chunks, which grow geometrically and are only released by Clear():
+    //  rewinding and replaying the tape never touches the allocator, and the block directory keeps the sweep off list links
+    //  BLOCK_SIZE_ is the default number of entries per block, which can be changed at construction or with SetBlockSize()
     template <class T_, size_t BLOCK_SIZE_> class BlockList_ {
     private:
-        std::list<std::array<T_, BLOCK_SIZE_>> data_;
-        using iterator = typename std::list<std::array<T_, BLOCK_SIZE_>>::iterator;
-        using const_iterator = typename std::list<std::array<T_, BLOCK_SIZE_>>::const_iterator;
-        using block_iter = typename std::array<T_, BLOCK_SIZE_>::iterator;
-        using const_block_iter = typename std::array<T_, BLOCK_SIZE_>::const_iterator;
-
-        iterator currBlock_;
-        iterator lastBlock_;
-
-        block_iter nextSpace_;
-        block_iter lastSpace_;
-
-        iterator markedBlock_;
-        block_iter markedSpace_;
-
-        void NewBlock() {
-            data_.emplace_back();
-            currBlock_ = lastBlock_ = std::prev(data_.end());
-            nextSpace_ = currBlock_->begin();
-            lastSpace_ = currBlock_->end();
+        static constexpr size_t CACHE_LINE = 64;
+        static constexpr size_t HUGE_PAGE = size_t(1) << 21;
+        static constexpr size_t MAX_CHUNK_BLOCKS = 64;
+
+        struct ChunkDeleter_ {
+            std::align_val_t align_;
+            void operator()(T_* p) const { ::operator delete(p, align_); }
+        };
+
+        std::vector<std::unique_ptr<T_, ChunkDeleter_>> chunks_;
+        //  block directory, in allocation order
+        std::vector<T_*> blocks_;
+        size_t firstChunkBlocks_ = 0;
+        size_t blockSize_;
+        size_t bytes_ = 0;
+        size_t highWater_ = 0;
+
+        size_t currBlock_ = 0;
+        T_* nextSpace_ = nullptr;
+        T_* lastSpace_ = nullptr;
+
+        size_t markedBlock_ = 0;
+        T_* markedSpace_ = nullptr;
+
+        void AddChunk(size_t n_blocks) {
+            const size_t bytes = n_blocks * blockSize_ * sizeof(T_);
+            const auto align = static_cast<std::align_val_t>(bytes >= HUGE_PAGE ? HUGE_PAGE : CACHE_LINE);
+            chunks_.emplace_back(static_cast<T_*>(::operator new(bytes, align)), ChunkDeleter_{align});
+            T_* chunk = chunks_.back().get();
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+            if (bytes >= HUGE_PAGE)
+                madvise(chunk, bytes, MADV_HUGEPAGE);
+#endif
+            for (size_t i = 0; i < n_blocks; ++i)
+                blocks_.push_back(chunk + i * blockSize_);
+            if (chunks_.size() == 1)
+                firstChunkBlocks_ = n_blocks;
+            bytes_ += bytes;
+        }
+
+        void SetBlock(size_t block) {
+            currBlock_ = block;
+            nextSpace_ = blocks_[block];
+            lastSpace_ = nextSpace_ + blockSize_;
+            highWater_ = std::max(highWater_, block + 1);
+        }
+
+        //  the mark goes back to the start when the blocks it pointed into may be released
+        void ResetMark() {
+            markedBlock_ = 0;
+            markedSpace_ = blocks_[0];
         }
 
         void NextBlock() {
-            if (currBlock_ == lastBlock_)
-                NewBlock();
-            else {
-                ++currBlock_;
-                nextSpace_ = currBlock_->begin();
-                lastSpace_ = currBlock_->end();
-            }
+            if (currBlock_ + 1 == blocks_.size())
+                AddChunk(std::min(blocks_.size(), MAX_CHUNK_BLOCKS));
+            SetBlock(currBlock_ + 1);
+        }
+
+        //  a position at the end of a block is the beginning of the next one, when there is one
+        template <class I_, class L_, class P_> static I_ Position(L_* list, size_t block, P_ space) {
+            if (space == list->blocks_[block] + list->blockSize_ && block + 1 < list->blocks_.size())
+                return I_(list, block + 1, list->blocks_[block + 1]);
+            return I_(list, block, space);
         }
 
     public:
-        struct BlockPosition_ {
-            iterator currBlock_;
-            block_iter nextSpace_;
+        explicit BlockList_(size_t block_size = BLOCK_SIZE_) : blockSize_(block_size) {
+            AddChunk(1);
+            SetBlock(0);
+            ResetMark();
+        }
 
-            BlockPosition_() = default;
-            BlockPosition_(iterator curr_block, block_iter next_space): currBlock_(curr_block), nextSpace_(next_space) {}
-        };
+        void Clear() {
+            chunks_.clear();
+            blocks_.clear();
+            bytes_ = 0;
+            highWater_ = 0;
+            AddChunk(1);
+            SetBlock(0);
+            ResetMark();
+        }
 
-        BlockList_() { NewBlock(); }
+        //  discards the content and releases all chunks but the first one, which keeps the pages already touched
+        void Trim() {
+            chunks_.erase(chunks_.begin() + 1, chunks_.end());
+            blocks_.erase(blocks_.begin() + static_cast<std::ptrdiff_t>(firstChunkBlocks_), blocks_.end());
+            bytes_ = firstChunkBlocks_ * blockSize_ * sizeof(T_);
+            highWater_ = 0;
+            SetBlock(0);
+            ResetMark();
+        }
 
-        void Clear() {
-            data_.clear();
-            NewBlock();
+        //  discards the content, like Clear()
+        void SetBlockSize(size_t block_size) {
+            blockSize_ = block_size;
+            Clear();
         }
 
-        void Rewind() {
-            currBlock_ = data_.begin();
-            nextSpace_ = currBlock_->begin();
-            lastSpace_ = currBlock_->end();
+        //  pre-allocates n_blocks blocks in one chunk, typically the high-water mark of a previous run
+        void Reserve(size_t n_blocks) {
+            if (n_blocks > blocks_.size())
+                AddChunk(n_blocks - blocks_.size());
         }
 
+        //  pre-allocates the blocks to take n more entries after the current position, whatever their grouping in EmplaceBackMulti
+        //  one block more than the plain count covers the space left at the ends of blocks
+        void ReserveAhead(size_t n) { Reserve(currBlock_ + 2 + n / blockSize_); }
+
+        void Rewind() { SetBlock(0); }
+
         [[nodiscard]] int Size() const {
-            int count = 0;
-            for(ConstIterator_ it = this->Begin(); it != this->End(); ++it)
-                count += 1;
-            return count;
+            return static_cast<int>(currBlock_ * blockSize_ + (nextSpace_ - blocks_[currBlock_]));
         }
 
+        [[nodiscard]] size_t BlockSize() const { return blockSize_; }
+        [[nodiscard]] size_t NumBlocks() const { return blocks_.size(); }
+        [[nodiscard]] size_t HighWater() const { return highWater_; }
+        [[nodiscard]] size_t Bytes() const { return bytes_; }
+
         void Memset(unsigned char val) {
-            for (auto& arr : data_)
-                std::memset(&arr[0], val, BLOCK_SIZE_ * sizeof(T_));
+            for (auto& block : blocks_)
+                std::memset(static_cast<void*>(block), val, blockSize_ * sizeof(T_));
         }
 
         template <typename... Args_> T_* EmplaceBack(Args_&&... args) {
             if (nextSpace_ == lastSpace_)
                 NextBlock();
-            T_* emplaced = new (&*nextSpace_) T_(std::forward<Args_>(args)...);
+            T_* emplaced = new (nextSpace_) T_(std::forward<Args_>(args)...);
             ++nextSpace_;
             return emplaced;
         }
@@ -98,25 +168,28 @@ namespace Dal::AAD {
         T_* EmplaceBack() {
             if (nextSpace_ == lastSpace_)
                 NextBlock();
-            auto old_next = nextSpace_;
-            ++nextSpace_;
-            return &*old_next;
+            return nextSpace_++;
         }
 
+        //  the entries are contiguous, so that there can be no more than a block of them
         template <size_t N_> T_* EmplaceBackMulti() {
-            if (std::distance(nextSpace_, lastSpace_) < static_cast<int>(N_))
+            if (lastSpace_ - nextSpace_ < static_cast<std::ptrdiff_t>(N_)) {
+                REQUIRE(N_ <= blockSize_, "entries do not fit in a block");
                 NextBlock();
-            auto old_next = nextSpace_;
+            }
+            T_* old_next = nextSpace_;
             nextSpace_ += N_;
-            return &*old_next;
+            return old_next;
         }
 
         T_* EmplaceBackMulti(const size_t& n) {
-            if (std::distance(nextSpace_, lastSpace_) < static_cast<int>(n))
+            if (lastSpace_ - nextSpace_ < static_cast<std::ptrdiff_t>(n)) {
+                REQUIRE(n <= blockSize_, "entries do not fit in a block");
                 NextBlock();
-            auto old_next = nextSpace_;
+            }
+            T_* old_next = nextSpace_;
             nextSpace_ += n;
-            return &*old_next;
+            return old_next;
         }
 
         void SetMark() {
@@ -126,40 +199,33 @@ namespace Dal::AAD {
             markedSpace_ = nextSpace_;
         }
 
-        auto GetPosition() {
-            if (nextSpace_ == lastSpace_)
-                NextBlock();
-            return Iterator_(currBlock_, nextSpace_, currBlock_->begin(), currBlock_->end());
-        }
+        class Iterator_;
+        class ConstIterator_;
 
-        auto GetPosition() const {
+        auto GetPosition() {
             if (nextSpace_ == lastSpace_)
                 NextBlock();
-            return ConstIterator_(currBlock_, nextSpace_, currBlock_->begin(), currBlock_->end());
+            return Iterator_(this, currBlock_, nextSpace_);
         }
 
-        auto GetZeroPosition() {
-            return Iterator_(data_.begin(), data_.begin()->begin(), data_.begin()->begin(), data_.begin()->end());
-        }
+        auto GetZeroPosition() { return Begin(); }
 
-        auto GetZeroPosition() const {
-            return ConstIterator_(data_.begin(), data_.begin()->begin(), data_.begin()->begin(), data_.begin()->end());
-        }
+        auto GetZeroPosition() const { return Begin(); }
 
         void RewindToMark() {
             currBlock_ = markedBlock_;
             nextSpace_ = markedSpace_;
-            lastSpace_ = currBlock_->end();
+            lastSpace_ = blocks_[currBlock_] + blockSize_;
         }
 
-
-
+        //  iterators compare by address: a position is unique once the end of a block is moved to the next one
         class Iterator_ {
         public:
-            iterator currBlock_;
-            block_iter currSpace_;
-            block_iter firstSpace_;
-            block_iter lastSpace_;
+            BlockList_* list_;
+            size_t currBlock_;
+            T_* currSpace_;
+            T_* firstSpace_;
+            T_* lastSpace_;
 
             using difference_type = std::ptrdiff_t;
             using reference = T_&;
@@ -168,62 +234,45 @@ namespace Dal::AAD {
             using iterator_category = std::bidirectional_iterator_tag;
 
             Iterator_() = default;
-            Iterator_(iterator cb, block_iter cs, block_iter fs, block_iter ls)
-                : currBlock_(cb), currSpace_(cs), firstSpace_(fs), lastSpace_(ls) {}
+            Iterator_(BlockList_* list, size_t cb, T_* cs)
+                : list_(list), currBlock_(cb), currSpace_(cs), firstSpace_(list->blocks_[cb]), lastSpace_(firstSpace_ + list->blockSize_) {}
 
             Iterator_& operator++() {
                 ++currSpace_;
-                if (currSpace_ == lastSpace_) {
+                if (currSpace_ == lastSpace_ && currBlock_ + 1 < list_->blocks_.size()) {
                     ++currBlock_;
-                    firstSpace_ = currBlock_->begin();
-                    lastSpace_ = currBlock_->end();
+                    firstSpace_ = list_->blocks_[currBlock_];
+                    lastSpace_ = firstSpace_ + list_->blockSize_;
                     currSpace_ = firstSpace_;
                 }
                 return *this;
             }
 
-            inline const Iterator_& operator++() const {
-                return this->operator++();
-            }
-
             Iterator_& operator--() {
                 if (currSpace_ == firstSpace_) {
                     --currBlock_;
-                    firstSpace_ = currBlock_->begin();
-                    lastSpace_ = currBlock_->end();
+                    firstSpace_ = list_->blocks_[currBlock_];
+                    lastSpace_ = firstSpace_ + list_->blockSize_;
                     currSpace_ = lastSpace_;
                 }
                 --currSpace_;
                 return *this;
             }
 
-            inline const Iterator_& operator--() const {
-                return this->operator--();
-            }
-
-            T_& operator*() { return *currSpace_; }
-
-            const T_& operator*() const { return *currSpace_; }
+            T_& operator*() const { return *currSpace_; }
+            T_* operator->() const { return currSpace_; }
 
-            T_* operator->() { return &*currSpace_; }
-
-            const T_* operator->() const { return &*currSpace_; }
-
-            bool operator==(const Iterator_& rhs) {
-                return currBlock_ == rhs.currBlock_ && currSpace_ == rhs.currSpace_;
-            }
-
-            bool operator!=(const Iterator_& rhs) {
-                return currBlock_ != rhs.currBlock_ || currSpace_ != rhs.currSpace_;
-            }
+            bool operator==(const Iterator_& rhs) const { return currSpace_ == rhs.currSpace_; }
+            bool operator!=(const Iterator_& rhs) const { return currSpace_ != rhs.currSpace_; }
         };
 
         class ConstIterator_ {
         public:
-            const_iterator currBlock_;
-            const_block_iter currSpace_;
-            const_block_iter firstSpace_;
-            const_block_iter lastSpace_;
+            const BlockList_* list_;
+            size_t currBlock_;
+            const T_* currSpace_;
+            const T_* firstSpace_;
+            const T_* lastSpace_;
 
             using difference_type = std::ptrdiff_t;
             using reference = const T_&;
@@ -232,15 +281,15 @@ namespace Dal::AAD {
             using iterator_category = std::bidirectional_iterator_tag;
 
             ConstIterator_() = default;
-            ConstIterator_(const_iterator cb, const_block_iter cs, const_block_iter fs, const_block_iter ls)
-                : currBlock_(cb), currSpace_(cs), firstSpace_(fs), lastSpace_(ls) {}
+            ConstIterator_(const BlockList_* list, size_t cb, const T_* cs)
+                : list_(list), currBlock_(cb), currSpace_(cs), firstSpace_(list->blocks_[cb]), lastSpace_(firstSpace_ + list->blockSize_) {}
 
             ConstIterator_& operator++() {
                 ++currSpace_;
-                if (currSpace_ == lastSpace_) {
+                if (currSpace_ == lastSpace_ && currBlock_ + 1 < list_->blocks_.size()) {
                     ++currBlock_;
-                    firstSpace_ = currBlock_->begin();
-                    lastSpace_ = currBlock_->end();
+                    firstSpace_ = list_->blocks_[currBlock_];
+                    lastSpace_ = firstSpace_ + list_->blockSize_;
                     currSpace_ = firstSpace_;
                 }
                 return *this;
@@ -249,8 +298,8 @@ namespace Dal::AAD {
             ConstIterator_& operator--() {
                 if (currSpace_ == firstSpace_) {
                     --currBlock_;
-                    firstSpace_ = currBlock_->begin();
-                    lastSpace_ = currBlock_->end();
+                    firstSpace_ = list_->blocks_[currBlock_];
+                    lastSpace_ = firstSpace_ + list_->blockSize_;
                     currSpace_ = lastSpace_;
                 }
                 --currSpace_;
@@ -258,71 +307,45 @@ namespace Dal::AAD {
             }
 
             const T_& operator*() const { return *currSpace_; }
-            const T_* operator->() const { return &*currSpace_; }
-
-            bool operator==(const ConstIterator_& rhs) {
-                return currBlock_ == rhs.currBlock_ && currSpace_ == rhs.currSpace_;
-            }
+            const T_* operator->() const { return currSpace_; }
 
-            bool operator!=(const ConstIterator_& rhs) {
-                return currBlock_ != rhs.currBlock_ || currSpace_ != rhs.currSpace_;
-            }
+            bool operator==(const ConstIterator_& rhs) const { return currSpace_ == rhs.currSpace_; }
+            bool operator!=(const ConstIterator_& rhs) const { return currSpace_ != rhs.currSpace_; }
         };
 
-        Iterator_ Begin() {
-            return Iterator_(data_.begin(), data_.begin()->begin(), data_.begin()->begin(), data_.begin()->end());
-        }
+        Iterator_ Begin() { return Iterator_(this, 0, blocks_[0]); }
 
-        inline Iterator_ begin() {
-            return Begin();
-        }
+        inline Iterator_ begin() { return Begin(); }
 
-        Iterator_ End() { return Iterator_(currBlock_, nextSpace_, currBlock_->begin(), currBlock_->end()); }
+        Iterator_ End() { return Position<Iterator_>(this, currBlock_, nextSpace_); }
 
-        inline Iterator_ end() {
-            return End();
-        }
+        inline Iterator_ end() { return End(); }
 
-        ConstIterator_ Begin() const {
-            return ConstIterator_(data_.begin(), data_.begin()->begin(), data_.begin()->begin(), data_.begin()->end());
-        }
+        ConstIterator_ Begin() const { return ConstIterator_(this, 0, blocks_[0]); }
 
-        inline ConstIterator_ begin() const {
-            return Begin();
-        }
+        inline ConstIterator_ begin() const { return Begin(); }
 
-        ConstIterator_ End() const {
-            return ConstIterator_(currBlock_, nextSpace_, currBlock_->begin(), currBlock_->end());
-        }
+        ConstIterator_ End() const { return Position<ConstIterator_>(this, currBlock_, nextSpace_); }
 
-        inline ConstIterator_ end() const {
-            return End();
-        }
+        inline ConstIterator_ end() const { return End(); }
 
-        Iterator_ Mark() {
-            return Iterator_(markedBlock_, markedSpace_, markedBlock_->begin(), markedBlock_->end());
-        }
+        Iterator_ Mark() { return Iterator_(this, markedBlock_, markedSpace_); }
 
+        //  the block is found from the directory, the position within the block directly
         Iterator_ Find(const T_* const element) {
-            Iterator_ it = End();
-            Iterator_ b = Begin();
-
-            while (it != b) {
-                --it;
-                if (&*it == element)
-                    return it;
+            const std::less<const T_*> less;
+            for (size_t b = currBlock_ + 1; b > 0; --b) {
+                const T_* first = blocks_[b - 1];
+                if (!less(element, first) && less(element, first + blockSize_))
+                    return Iterator_(this, b - 1, blocks_[b - 1] + (element - first));
             }
-
-            if (&*it == element)
-                return it;
-
             return End();
         }
 
         void RewindTo(const Iterator_& position) {
             currBlock_ = position.currBlock_;
             nextSpace_ = position.currSpace_;
-            lastSpace_ = currBlock_->end();
+            lastSpace_ = blocks_[currBlock_] + blockSize_;
         }
     };
-} // namespace Dal
+} // namespace Dal::AAD
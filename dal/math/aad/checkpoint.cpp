@@ -0,0 +1,108 @@
+//
+// Created by wegam on 2024/11/2.
+//
+
+#include <map>
+#include <dal/platform/platform.hpp>
+#include <dal/platform/strict.hpp>
+#include <dal/math/aad/checkpoint.hpp>
+#include <dal/utilities/algorithms.hpp>
+#include <dal/utilities/exceptions.hpp>
+
+namespace Dal::AAD {
+
+    void Checkpoint_::Index(const Vector_<Number_*>& inputs, const Vector_<Number_*>& outputs) {
+        //  arguments are recorded by the address of their adjoints, which depends on the adjoint mode
+        std::map<const double*, size_t> positions;
+        size_t n = 0;
+        for (auto it = tape_.Begin(); it != tape_.End(); ++it, ++n) {
+            positions[&it->adjoint_] = n;
+            if (it->pAdjoints_)
+                positions[it->pAdjoints_] = n;
+        }
+
+        argBegin_.Resize(n + 1);
+        args_.clear();
+        ders_.clear();
+        n = 0;
+        for (auto it = tape_.Begin(); it != tape_.End(); ++it, ++n) {
+            argBegin_[n] = args_.size();
+            for (size_t i = 0; i < it->n_; ++i) {
+                auto arg = positions.find(it->pAdjPtrs_[i]);
+                if (arg != positions.end()) {
+                    args_.push_back(arg->second);
+                    ders_.push_back(it->pDerivatives_[i]);
+                }
+            }
+        }
+        argBegin_[n] = args_.size();
+
+        auto position = [&](Number_* x) {
+            return x->Active() ? positions.at(&x->Adjoint()) : NONE;
+        };
+        inputNodes_ = Apply(position, inputs);
+        outputNodes_ = Apply(position, outputs);
+    }
+
+    void Checkpoint_::Sweep(size_t n_sets, Vector_<>* workspace) const {
+        if (workspace->empty())
+            return;
+        double* adjoints = &(*workspace)[0];
+        for (size_t i = argBegin_.size() - 1; i > 0; --i) {
+            const double* adjoint = adjoints + (i - 1) * n_sets;
+            for (size_t a = argBegin_[i - 1]; a < argBegin_[i]; ++a) {
+                double* dst = adjoints + args_[a] * n_sets;
+                const double der = ders_[a];
+                for (size_t s = 0; s < n_sets; ++s)
+                    dst[s] += der * adjoint[s];
+            }
+        }
+    }
+
+    void Checkpoint_::Restore(const Vector_<Number_*>& outputs) const {
+        REQUIRE(outputs.size() == values_.size(), "outputs do not match the checkpoint");
+        for (size_t i = 0; i < outputs.size(); ++i) {
+            *outputs[i] = values_[i];
+            outputs[i]->PutOnTape();
+        }
+    }
+
+    void Checkpoint_::Differentiate(const Vector_<>& output_adjoints, Vector_<>* input_adjoints, Vector_<>* workspace) const {
+        REQUIRE(output_adjoints.size() == outputNodes_.size(), "output adjoints do not match the checkpoint");
+        REQUIRE(input_adjoints->size() == inputNodes_.size(), "input adjoints do not match the checkpoint");
+        Vector_<> local;
+        if (!workspace)
+            workspace = &local;
+        workspace->Resize(argBegin_.size() - 1);
+        workspace->Fill(0.0);
+        for (size_t k = 0; k < outputNodes_.size(); ++k)
+            if (outputNodes_[k] != NONE)
+                (*workspace)[outputNodes_[k]] += output_adjoints[k];
+        Sweep(1, workspace);
+        for (size_t j = 0; j < inputNodes_.size(); ++j)
+            if (inputNodes_[j] != NONE)
+                (*input_adjoints)[j] += (*workspace)[inputNodes_[j]];
+    }
+
+    void Checkpoint_::Differentiate(const Matrix_<>& output_adjoints, Matrix_<>* input_adjoints, Vector_<>* workspace) const {
+        REQUIRE(output_adjoints.Cols() == static_cast<int>(outputNodes_.size()), "output adjoints do not match the checkpoint");
+        REQUIRE(input_adjoints->Cols() == static_cast<int>(inputNodes_.size()), "input adjoints do not match the checkpoint");
+        REQUIRE(input_adjoints->Rows() == output_adjoints.Rows(), "input and output adjoints do not have the same number of sets");
+        const auto nSets = static_cast<size_t>(output_adjoints.Rows());
+        Vector_<> local;
+        if (!workspace)
+            workspace = &local;
+        //  adjoints of the sets side by side for each node, so that the inner loop of the sweep is contiguous
+        workspace->Resize((argBegin_.size() - 1) * nSets);
+        workspace->Fill(0.0);
+        for (size_t s = 0; s < nSets; ++s)
+            for (size_t k = 0; k < outputNodes_.size(); ++k)
+                if (outputNodes_[k] != NONE)
+                    (*workspace)[outputNodes_[k] * nSets + s] += output_adjoints(static_cast<int>(s), static_cast<int>(k));
+        Sweep(nSets, workspace);
+        for (size_t s = 0; s < nSets; ++s)
+            for (size_t j = 0; j < inputNodes_.size(); ++j)
+                if (inputNodes_[j] != NONE)
+                    (*input_adjoints)(static_cast<int>(s), static_cast<int>(j)) += (*workspace)[inputNodes_[j] * nSets + s];
+    }
+} // namespace Dal::AAD
@@ -0,0 +1,60 @@
+//
+// Created by wegam on 2024/11/2.
+//
+
+#pragma once
+
+#include <dal/math/aad/aad.hpp>
+#include <dal/math/matrix/matrixs.hpp>
+#include <dal/math/vectors.hpp>
+
+namespace Dal::AAD {
+
+    //  A section of the calculation, typically the initialization of a model, recorded once on its own tape:
+    //  working tapes only hold its outputs, as leaves, and the adjoints of the outputs are pulled back to its inputs on demand
+    //  once recorded, the checkpoint is only read: threads differentiate through it concurrently, each with its own adjoints
+    class Checkpoint_ {
+        Tape_ tape_;
+        Vector_<> values_;
+        //  the recorded nodes in tape order: the arguments of node i are args_[argBegin_[i], argBegin_[i + 1]), with derivatives ders_
+        //  passive arguments are left out, as are passive inputs and outputs (at NONE)
+        Vector_<size_t> argBegin_;
+        Vector_<size_t> args_;
+        Vector_<> ders_;
+        Vector_<size_t> inputNodes_;
+        Vector_<size_t> outputNodes_;
+
+        static constexpr size_t NONE = static_cast<size_t>(-1);
+
+        void Index(const Vector_<Number_*>& inputs, const Vector_<Number_*>& outputs);
+        void Sweep(size_t n_sets, Vector_<>* workspace) const;
+
+    public:
+        //  records section(), which computes the outputs from the inputs and returns them
+        template <class F_> Checkpoint_(const Vector_<Number_*>& inputs, F_ section) {
+            TapeScope_ scope(tape_);
+            for (auto* input : inputs)
+                input->PutOnTape();
+            const auto outputs = section();
+            for (const auto* output : outputs)
+                values_.push_back(output->value());
+            Index(inputs, outputs);
+        }
+
+        Checkpoint_(const Checkpoint_&) = delete;
+        Checkpoint_& operator=(const Checkpoint_&) = delete;
+
+        [[nodiscard]] size_t NumInputs() const { return inputNodes_.size(); }
+        [[nodiscard]] size_t NumOutputs() const { return outputNodes_.size(); }
+        [[nodiscard]] TapeStats_ Stats() const { return tape_.Stats(); }
+
+        //  sets the outputs to their recorded values, as leaves of the current tape
+        void Restore(const Vector_<Number_*>& outputs) const;
+
+        //  adds the adjoints of the inputs given those of the outputs
+        //  workspace holds the adjoints of the recorded nodes: one per thread, kept across calls to save the allocations
+        void Differentiate(const Vector_<>& output_adjoints, Vector_<>* input_adjoints, Vector_<>* workspace = nullptr) const;
+        //  same for several sets of adjoints, one per row, pulled back together in a single sweep
+        void Differentiate(const Matrix_<>& output_adjoints, Matrix_<>* input_adjoints, Vector_<>* workspace = nullptr) const;
+    };
+} // namespace Dal::AAD
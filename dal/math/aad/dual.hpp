@@ -0,0 +1,143 @@
+//
+// Created by wegam on 2024/11/9.
+//
+
+#pragma once
+
+#include <array>
+#include <type_traits>
+#include <dal/math/aad/expr.hpp>
+
+namespace Dal::AAD {
+
+    //  Forward mode number: a value with its derivatives to N_ inputs (the tangents), carried along the calculation
+    //  nothing is recorded, so a calculation in Dual_ is as thread-local as one in double
+    //  derivatives come from the same operator definitions as the reverse mode expressions
+    template <size_t N_ = 1> class Dual_ {
+        double value_;
+        std::array<double, N_> tangents_;
+
+    public:
+        enum { numTangents_ = N_ };
+
+        Dual_() : value_(0.0), tangents_{} {}
+
+        Dual_(double val) : value_(val), tangents_{} {}
+
+        [[nodiscard]] FORCE_INLINE double value() const { return value_; }
+        explicit operator double() const { return value_; }
+
+        [[nodiscard]] FORCE_INLINE double Tangent(size_t i) const { return tangents_[i]; }
+        [[nodiscard]] FORCE_INLINE double& Tangent(size_t i) { return tangents_[i]; }
+
+        //  makes this number the i-th input, clearing its other tangents
+        void Seed(size_t i) {
+            tangents_.fill(0.0);
+            tangents_[i] = 1.0;
+        }
+
+        template <class OP_> FORCE_INLINE static Dual_ Binary(const Dual_& lhs, const Dual_& rhs) {
+            Dual_ retval(OP_::Eval(lhs.value_, rhs.value_));
+            const double dl = OP_::LeftDerivative(lhs.value_, rhs.value_, retval.value_);
+            const double dr = OP_::RightDerivative(lhs.value_, rhs.value_, retval.value_);
+            for (size_t i = 0; i < N_; ++i)
+                retval.tangents_[i] = dl * lhs.tangents_[i] + dr * rhs.tangents_[i];
+            return retval;
+        }
+
+        template <class OP_> FORCE_INLINE static Dual_ Unary(const Dual_& arg, double d = 0.0) {
+            Dual_ retval(OP_::Eval(arg.value_, d));
+            const double da = OP_::Derivative(arg.value_, retval.value_, d);
+            for (size_t i = 0; i < N_; ++i)
+                retval.tangents_[i] = da * arg.tangents_[i];
+            return retval;
+        }
+
+        FORCE_INLINE Dual_& operator+=(const Dual_& rhs) { return *this = Binary<OPAdd_>(*this, rhs); }
+        FORCE_INLINE Dual_& operator-=(const Dual_& rhs) { return *this = Binary<OPSub_>(*this, rhs); }
+        FORCE_INLINE Dual_& operator*=(const Dual_& rhs) { return *this = Binary<OPMult_>(*this, rhs); }
+        FORCE_INLINE Dual_& operator/=(const Dual_& rhs) { return *this = Binary<OPDiv_>(*this, rhs); }
+        FORCE_INLINE Dual_& operator+=(double rhs) { return *this = Unary<OPAddD_>(*this, rhs); }
+        FORCE_INLINE Dual_& operator-=(double rhs) { return *this = Unary<OPSubDR_>(*this, rhs); }
+        FORCE_INLINE Dual_& operator*=(double rhs) { return *this = Unary<OPMultD_>(*this, rhs); }
+        FORCE_INLINE Dual_& operator/=(double rhs) { return *this = Unary<OPDivDR_>(*this, rhs); }
+    };
+
+    template <class T_> struct IsDual_ : std::false_type {};
+    template <size_t N_> struct IsDual_<Dual_<N_>> : std::true_type {};
+
+    // binary operators
+
+    template <size_t N_> FORCE_INLINE Dual_<N_> operator+(const Dual_<N_>& lhs, const Dual_<N_>& rhs) {
+        return Dual_<N_>::template Binary<OPAdd_>(lhs, rhs);
+    }
+    template <size_t N_> FORCE_INLINE Dual_<N_> operator-(const Dual_<N_>& lhs, const Dual_<N_>& rhs) {
+        return Dual_<N_>::template Binary<OPSub_>(lhs, rhs);
+    }
+    template <size_t N_> FORCE_INLINE Dual_<N_> operator*(const Dual_<N_>& lhs, const Dual_<N_>& rhs) {
+        return Dual_<N_>::template Binary<OPMult_>(lhs, rhs);
+    }
+    template <size_t N_> FORCE_INLINE Dual_<N_> operator/(const Dual_<N_>& lhs, const Dual_<N_>& rhs) {
+        return Dual_<N_>::template Binary<OPDiv_>(lhs, rhs);
+    }
+    template <size_t N_> FORCE_INLINE Dual_<N_> pow(const Dual_<N_>& lhs, const Dual_<N_>& rhs) {
+        return Dual_<N_>::template Binary<OPPow_>(lhs, rhs);
+    }
+    template <size_t N_> FORCE_INLINE Dual_<N_> max(const Dual_<N_>& lhs, const Dual_<N_>& rhs) {
+        return Dual_<N_>::template Binary<OPMax_>(lhs, rhs);
+    }
+    template <size_t N_> FORCE_INLINE Dual_<N_> min(const Dual_<N_>& lhs, const Dual_<N_>& rhs) {
+        return Dual_<N_>::template Binary<OPMin_>(lhs, rhs);
+    }
+
+    // unary functions
+
+    template <size_t N_> FORCE_INLINE Dual_<N_> exp(const Dual_<N_>& arg) { return Dual_<N_>::template Unary<OPExp_>(arg); }
+    template <size_t N_> FORCE_INLINE Dual_<N_> log(const Dual_<N_>& arg) { return Dual_<N_>::template Unary<OPLog_>(arg); }
+    template <size_t N_> FORCE_INLINE Dual_<N_> sqrt(const Dual_<N_>& arg) { return Dual_<N_>::template Unary<OPSqrt_>(arg); }
+    template <size_t N_> FORCE_INLINE Dual_<N_> fabs(const Dual_<N_>& arg) { return Dual_<N_>::template Unary<OPFabs_>(arg); }
+    template <size_t N_> FORCE_INLINE Dual_<N_> NPDF(const Dual_<N_>& arg) { return Dual_<N_>::template Unary<OPNormalDens_>(arg); }
+    template <size_t N_> FORCE_INLINE Dual_<N_> NCDF(const Dual_<N_>& arg) { return Dual_<N_>::template Unary<OPNormalCdf_>(arg); }
+    template <size_t N_> FORCE_INLINE Dual_<N_> erfc(const Dual_<N_>& arg) { return Dual_<N_>::template Unary<OPErfc_>(arg); }
+
+    // binary operators with a double on one side
+
+    template <size_t N_> FORCE_INLINE Dual_<N_> operator*(double d, const Dual_<N_>& rhs) { return Dual_<N_>::template Unary<OPMultD_>(rhs, d); }
+    template <size_t N_> FORCE_INLINE Dual_<N_> operator*(const Dual_<N_>& lhs, double d) { return Dual_<N_>::template Unary<OPMultD_>(lhs, d); }
+    template <size_t N_> FORCE_INLINE Dual_<N_> operator+(double d, const Dual_<N_>& rhs) { return Dual_<N_>::template Unary<OPAddD_>(rhs, d); }
+    template <size_t N_> FORCE_INLINE Dual_<N_> operator+(const Dual_<N_>& lhs, double d) { return Dual_<N_>::template Unary<OPAddD_>(lhs, d); }
+    template <size_t N_> FORCE_INLINE Dual_<N_> operator-(double d, const Dual_<N_>& rhs) { return Dual_<N_>::template Unary<OPSubDL_>(rhs, d); }
+    template <size_t N_> FORCE_INLINE Dual_<N_> operator-(const Dual_<N_>& lhs, double d) { return Dual_<N_>::template Unary<OPSubDR_>(lhs, d); }
+    template <size_t N_> FORCE_INLINE Dual_<N_> operator/(double d, const Dual_<N_>& rhs) { return Dual_<N_>::template Unary<OPDivDL_>(rhs, d); }
+    template <size_t N_> FORCE_INLINE Dual_<N_> operator/(const Dual_<N_>& lhs, double d) { return Dual_<N_>::template Unary<OPDivDR_>(lhs, d); }
+    template <size_t N_> FORCE_INLINE Dual_<N_> pow(double d, const Dual_<N_>& rhs) { return Dual_<N_>::template Unary<OPPowDL_>(rhs, d); }
+    template <size_t N_> FORCE_INLINE Dual_<N_> pow(const Dual_<N_>& lhs, double d) { return Dual_<N_>::template Unary<OPPowDR_>(lhs, d); }
+    template <size_t N_> FORCE_INLINE Dual_<N_> max(double d, const Dual_<N_>& rhs) { return Dual_<N_>::template Unary<OPMaxD_>(rhs, d); }
+    template <size_t N_> FORCE_INLINE Dual_<N_> max(const Dual_<N_>& lhs, double d) { return Dual_<N_>::template Unary<OPMaxD_>(lhs, d); }
+    template <size_t N_> FORCE_INLINE Dual_<N_> min(double d, const Dual_<N_>& rhs) { return Dual_<N_>::template Unary<OPMinD_>(rhs, d); }
+    template <size_t N_> FORCE_INLINE Dual_<N_> min(const Dual_<N_>& lhs, double d) { return Dual_<N_>::template Unary<OPMinD_>(lhs, d); }
+
+    template <size_t N_> FORCE_INLINE Dual_<N_> operator-(const Dual_<N_>& rhs) { return 0.0 - rhs; }
+    template <size_t N_> FORCE_INLINE Dual_<N_> operator+(const Dual_<N_>& rhs) { return rhs; }
+
+    // comparison on values
+
+    template <size_t N_> FORCE_INLINE bool operator==(const Dual_<N_>& lhs, const Dual_<N_>& rhs) { return lhs.value() == rhs.value(); }
+    template <size_t N_> FORCE_INLINE bool operator==(const Dual_<N_>& lhs, double rhs) { return lhs.value() == rhs; }
+    template <size_t N_> FORCE_INLINE bool operator==(double lhs, const Dual_<N_>& rhs) { return lhs == rhs.value(); }
+    template <size_t N_> FORCE_INLINE bool operator!=(const Dual_<N_>& lhs, const Dual_<N_>& rhs) { return lhs.value() != rhs.value(); }
+    template <size_t N_> FORCE_INLINE bool operator!=(const Dual_<N_>& lhs, double rhs) { return lhs.value() != rhs; }
+    template <size_t N_> FORCE_INLINE bool operator!=(double lhs, const Dual_<N_>& rhs) { return lhs != rhs.value(); }
+    template <size_t N_> FORCE_INLINE bool operator<(const Dual_<N_>& lhs, const Dual_<N_>& rhs) { return lhs.value() < rhs.value(); }
+    template <size_t N_> FORCE_INLINE bool operator<(const Dual_<N_>& lhs, double rhs) { return lhs.value() < rhs; }
+    template <size_t N_> FORCE_INLINE bool operator<(double lhs, const Dual_<N_>& rhs) { return lhs < rhs.value(); }
+    template <size_t N_> FORCE_INLINE bool operator>(const Dual_<N_>& lhs, const Dual_<N_>& rhs) { return lhs.value() > rhs.value(); }
+    template <size_t N_> FORCE_INLINE bool operator>(const Dual_<N_>& lhs, double rhs) { return lhs.value() > rhs; }
+    template <size_t N_> FORCE_INLINE bool operator>(double lhs, const Dual_<N_>& rhs) { return lhs > rhs.value(); }
+    template <size_t N_> FORCE_INLINE bool operator<=(const Dual_<N_>& lhs, const Dual_<N_>& rhs) { return lhs.value() <= rhs.value(); }
+    template <size_t N_> FORCE_INLINE bool operator<=(const Dual_<N_>& lhs, double rhs) { return lhs.value() <= rhs; }
+    template <size_t N_> FORCE_INLINE bool operator<=(double lhs, const Dual_<N_>& rhs) { return lhs <= rhs.value(); }
+    template <size_t N_> FORCE_INLINE bool operator>=(const Dual_<N_>& lhs, const Dual_<N_>& rhs) { return lhs.value() >= rhs.value(); }
+    template <size_t N_> FORCE_INLINE bool operator>=(const Dual_<N_>& lhs, double rhs) { return lhs.value() >= rhs; }
+    template <size_t N_> FORCE_INLINE bool operator>=(double lhs, const Dual_<N_>& rhs) { return lhs >= rhs.value(); }
+} // namespace Dal::AAD
@@ -0,0 +1,199 @@
+//
+// Created by wegam on 2024/11/16.
+//
+
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <dal/math/specialfunctions.hpp>
+#include <dal/platform/host.hpp>
+
+namespace Dal::AAD {
+
+    //  Second order forward mode number: a value with its gradient and its Hessian in N_ inputs
+    //  the Hessian is symmetric and stored as its lower triangle; the cost of an operation grows as N_^2,
+    //  so it suits a small block of inputs, such as spot and volatility for gamma, vanna and volga
+    template <size_t N_ = 2> class Dual2_ {
+        static constexpr size_t SIZE = N_ * (N_ + 1) / 2;
+        static constexpr size_t Index(size_t i, size_t j) { return i >= j ? i * (i + 1) / 2 + j : j * (j + 1) / 2 + i; }
+
+        double value_;
+        std::array<double, N_> tangents_;
+        std::array<double, SIZE> seconds_;
+
+    public:
+        enum { numTangents_ = N_ };
+
+        Dual2_() : value_(0.0), tangents_{}, seconds_{} {}
+
+        Dual2_(double val) : value_(val), tangents_{}, seconds_{} {}
+
+        [[nodiscard]] FORCE_INLINE double value() const { return value_; }
+        explicit operator double() const { return value_; }
+
+        [[nodiscard]] FORCE_INLINE double Tangent(size_t i) const { return tangents_[i]; }
+        [[nodiscard]] FORCE_INLINE double Second(size_t i, size_t j) const { return seconds_[Index(i, j)]; }
+
+        //  makes this number the i-th input, clearing its other derivatives
+        void Seed(size_t i) {
+            tangents_.fill(0.0);
+            seconds_.fill(0.0);
+            tangents_[i] = 1.0;
+        }
+
+        //  f(a) with f' = d1 and f'' = d2 at a
+        FORCE_INLINE static Dual2_ Chain(double v, double d1, double d2, const Dual2_& a) {
+            Dual2_ retval(v);
+            for (size_t i = 0; i < N_; ++i) {
+                retval.tangents_[i] = d1 * a.tangents_[i];
+                for (size_t j = 0; j <= i; ++j)
+                    retval.seconds_[Index(i, j)] = d1 * a.seconds_[Index(i, j)] + d2 * a.tangents_[i] * a.tangents_[j];
+            }
+            return retval;
+        }
+
+        //  f(a, b) with first derivatives da, db and second derivatives daa, dab, dbb at (a, b)
+        FORCE_INLINE static Dual2_ Chain(double v, double da, double db, double daa, double dab, double dbb, const Dual2_& a, const Dual2_& b) {
+            Dual2_ retval(v);
+            for (size_t i = 0; i < N_; ++i) {
+                retval.tangents_[i] = da * a.tangents_[i] + db * b.tangents_[i];
+                for (size_t j = 0; j <= i; ++j)
+                    retval.seconds_[Index(i, j)] = da * a.seconds_[Index(i, j)] + db * b.seconds_[Index(i, j)]
+                                                   + daa * a.tangents_[i] * a.tangents_[j]
+                                                   + dab * (a.tangents_[i] * b.tangents_[j] + b.tangents_[i] * a.tangents_[j])
+                                                   + dbb * b.tangents_[i] * b.tangents_[j];
+            }
+            return retval;
+        }
+
+        FORCE_INLINE Dual2_& operator+=(const Dual2_& rhs) { return *this = *this + rhs; }
+        FORCE_INLINE Dual2_& operator-=(const Dual2_& rhs) { return *this = *this - rhs; }
+        FORCE_INLINE Dual2_& operator*=(const Dual2_& rhs) { return *this = *this * rhs; }
+        FORCE_INLINE Dual2_& operator/=(const Dual2_& rhs) { return *this = *this / rhs; }
+        FORCE_INLINE Dual2_& operator+=(double rhs) { return *this = *this + rhs; }
+        FORCE_INLINE Dual2_& operator-=(double rhs) { return *this = *this - rhs; }
+        FORCE_INLINE Dual2_& operator*=(double rhs) { return *this = *this * rhs; }
+        FORCE_INLINE Dual2_& operator/=(double rhs) { return *this = *this / rhs; }
+    };
+
+    // binary operators
+
+    template <size_t N_> FORCE_INLINE Dual2_<N_> operator+(const Dual2_<N_>& a, const Dual2_<N_>& b) {
+        return Dual2_<N_>::Chain(a.value() + b.value(), 1.0, 1.0, 0.0, 0.0, 0.0, a, b);
+    }
+    template <size_t N_> FORCE_INLINE Dual2_<N_> operator-(const Dual2_<N_>& a, const Dual2_<N_>& b) {
+        return Dual2_<N_>::Chain(a.value() - b.value(), 1.0, -1.0, 0.0, 0.0, 0.0, a, b);
+    }
+    template <size_t N_> FORCE_INLINE Dual2_<N_> operator*(const Dual2_<N_>& a, const Dual2_<N_>& b) {
+        return Dual2_<N_>::Chain(a.value() * b.value(), b.value(), a.value(), 0.0, 1.0, 0.0, a, b);
+    }
+    template <size_t N_> FORCE_INLINE Dual2_<N_> operator/(const Dual2_<N_>& a, const Dual2_<N_>& b) {
+        const double inv = 1.0 / b.value();
+        const double v = a.value() * inv;
+        return Dual2_<N_>::Chain(v, inv, -v * inv, 0.0, -inv * inv, 2.0 * v * inv * inv, a, b);
+    }
+    template <size_t N_> FORCE_INLINE Dual2_<N_> pow(const Dual2_<N_>& a, const Dual2_<N_>& b) {
+        const double v = std::pow(a.value(), b.value());
+        const double l = std::log(a.value());
+        const double e = b.value();
+        const double x = a.value();
+        return Dual2_<N_>::Chain(v, e * v / x, v * l, e * (e - 1.0) * v / x / x, v / x * (1.0 + e * l), v * l * l, a, b);
+    }
+    //  as in reverse mode, a tie has no derivative
+    template <size_t N_> FORCE_INLINE Dual2_<N_> max(const Dual2_<N_>& a, const Dual2_<N_>& b) {
+        return Dual2_<N_>::Chain(std::max(a.value(), b.value()), a > b ? 1.0 : 0.0, b > a ? 1.0 : 0.0, 0.0, 0.0, 0.0, a, b);
+    }
+    template <size_t N_> FORCE_INLINE Dual2_<N_> min(const Dual2_<N_>& a, const Dual2_<N_>& b) {
+        return Dual2_<N_>::Chain(std::min(a.value(), b.value()), a < b ? 1.0 : 0.0, b < a ? 1.0 : 0.0, 0.0, 0.0, 0.0, a, b);
+    }
+
+    // unary functions
+
+    template <size_t N_> FORCE_INLINE Dual2_<N_> exp(const Dual2_<N_>& a) {
+        const double v = std::exp(a.value());
+        return Dual2_<N_>::Chain(v, v, v, a);
+    }
+    template <size_t N_> FORCE_INLINE Dual2_<N_> log(const Dual2_<N_>& a) {
+        const double inv = 1.0 / a.value();
+        return Dual2_<N_>::Chain(std::log(a.value()), inv, -inv * inv, a);
+    }
+    template <size_t N_> FORCE_INLINE Dual2_<N_> sqrt(const Dual2_<N_>& a) {
+        const double v = std::sqrt(a.value());
+        return Dual2_<N_>::Chain(v, 0.5 / v, -0.25 / (v * a.value()), a);
+    }
+    template <size_t N_> FORCE_INLINE Dual2_<N_> fabs(const Dual2_<N_>& a) {
+        return Dual2_<N_>::Chain(std::fabs(a.value()), a.value() > 0.0 ? 1.0 : -1.0, 0.0, a);
+    }
+    template <size_t N_> FORCE_INLINE Dual2_<N_> NPDF(const Dual2_<N_>& a) {
+        const double x = a.value();
+        const double v = Dal::NPDF(x);
+        return Dual2_<N_>::Chain(v, -x * v, (x * x - 1.0) * v, a);
+    }
+    template <size_t N_> FORCE_INLINE Dual2_<N_> NCDF(const Dual2_<N_>& a) {
+        const double x = a.value();
+        const double d = Dal::NPDF(x);
+        return Dual2_<N_>::Chain(Dal::NCDF(x), d, -x * d, a);
+    }
+    template <size_t N_> FORCE_INLINE Dual2_<N_> erfc(const Dual2_<N_>& a) {
+        const double x = a.value();
+        const double d = -1.12837916709551 * std::exp(-x * x);
+        return Dual2_<N_>::Chain(std::erfc(x), d, -2.0 * x * d, a);
+    }
+
+    // binary operators with a double on one side
+
+    template <size_t N_> FORCE_INLINE Dual2_<N_> operator*(double d, const Dual2_<N_>& a) { return Dual2_<N_>::Chain(d * a.value(), d, 0.0, a); }
+    template <size_t N_> FORCE_INLINE Dual2_<N_> operator*(const Dual2_<N_>& a, double d) { return d * a; }
+    template <size_t N_> FORCE_INLINE Dual2_<N_> operator+(double d, const Dual2_<N_>& a) { return Dual2_<N_>::Chain(d + a.value(), 1.0, 0.0, a); }
+    template <size_t N_> FORCE_INLINE Dual2_<N_> operator+(const Dual2_<N_>& a, double d) { return d + a; }
+    template <size_t N_> FORCE_INLINE Dual2_<N_> operator-(double d, const Dual2_<N_>& a) { return Dual2_<N_>::Chain(d - a.value(), -1.0, 0.0, a); }
+    template <size_t N_> FORCE_INLINE Dual2_<N_> operator-(const Dual2_<N_>& a, double d) { return Dual2_<N_>::Chain(a.value() - d, 1.0, 0.0, a); }
+    template <size_t N_> FORCE_INLINE Dual2_<N_> operator/(const Dual2_<N_>& a, double d) { return Dual2_<N_>::Chain(a.value() / d, 1.0 / d, 0.0, a); }
+    template <size_t N_> FORCE_INLINE Dual2_<N_> operator/(double d, const Dual2_<N_>& a) {
+        const double inv = 1.0 / a.value();
+        return Dual2_<N_>::Chain(d * inv, -d * inv * inv, 2.0 * d * inv * inv * inv, a);
+    }
+    template <size_t N_> FORCE_INLINE Dual2_<N_> pow(double d, const Dual2_<N_>& a) {
+        const double v = std::pow(d, a.value());
+        const double l = std::log(d);
+        return Dual2_<N_>::Chain(v, v * l, v * l * l, a);
+    }
+    template <size_t N_> FORCE_INLINE Dual2_<N_> pow(const Dual2_<N_>& a, double d) {
+        const double v = std::pow(a.value(), d);
+        const double x = a.value();
+        return Dual2_<N_>::Chain(v, d * v / x, d * (d - 1.0) * v / x / x, a);
+    }
+    template <size_t N_> FORCE_INLINE Dual2_<N_> max(const Dual2_<N_>& a, double d) {
+        return Dual2_<N_>::Chain(std::max(a.value(), d), a > d ? 1.0 : 0.0, 0.0, a);
+    }
+    template <size_t N_> FORCE_INLINE Dual2_<N_> max(double d, const Dual2_<N_>& a) { return max(a, d); }
+    template <size_t N_> FORCE_INLINE Dual2_<N_> min(const Dual2_<N_>& a, double d) {
+        return Dual2_<N_>::Chain(std::min(a.value(), d), a < d ? 1.0 : 0.0, 0.0, a);
+    }
+    template <size_t N_> FORCE_INLINE Dual2_<N_> min(double d, const Dual2_<N_>& a) { return min(a, d); }
+
+    template <size_t N_> FORCE_INLINE Dual2_<N_> operator-(const Dual2_<N_>& a) { return 0.0 - a; }
+    template <size_t N_> FORCE_INLINE Dual2_<N_> operator+(const Dual2_<N_>& a) { return a; }
+
+    // comparison on values
+
+    template <size_t N_> FORCE_INLINE bool operator==(const Dual2_<N_>& lhs, const Dual2_<N_>& rhs) { return lhs.value() == rhs.value(); }
+    template <size_t N_> FORCE_INLINE bool operator==(const Dual2_<N_>& lhs, double rhs) { return lhs.value() == rhs; }
+    template <size_t N_> FORCE_INLINE bool operator==(double lhs, const Dual2_<N_>& rhs) { return lhs == rhs.value(); }
+    template <size_t N_> FORCE_INLINE bool operator!=(const Dual2_<N_>& lhs, const Dual2_<N_>& rhs) { return lhs.value() != rhs.value(); }
+    template <size_t N_> FORCE_INLINE bool operator!=(const Dual2_<N_>& lhs, double rhs) { return lhs.value() != rhs; }
+    template <size_t N_> FORCE_INLINE bool operator!=(double lhs, const Dual2_<N_>& rhs) { return lhs != rhs.value(); }
+    template <size_t N_> FORCE_INLINE bool operator<(const Dual2_<N_>& lhs, const Dual2_<N_>& rhs) { return lhs.value() < rhs.value(); }
+    template <size_t N_> FORCE_INLINE bool operator<(const Dual2_<N_>& lhs, double rhs) { return lhs.value() < rhs; }
+    template <size_t N_> FORCE_INLINE bool operator<(double lhs, const Dual2_<N_>& rhs) { return lhs < rhs.value(); }
+    template <size_t N_> FORCE_INLINE bool operator>(const Dual2_<N_>& lhs, const Dual2_<N_>& rhs) { return lhs.value() > rhs.value(); }
+    template <size_t N_> FORCE_INLINE bool operator>(const Dual2_<N_>& lhs, double rhs) { return lhs.value() > rhs; }
+    template <size_t N_> FORCE_INLINE bool operator>(double lhs, const Dual2_<N_>& rhs) { return lhs > rhs.value(); }
+    template <size_t N_> FORCE_INLINE bool operator<=(const Dual2_<N_>& lhs, const Dual2_<N_>& rhs) { return lhs.value() <= rhs.value(); }
+    template <size_t N_> FORCE_INLINE bool operator<=(const Dual2_<N_>& lhs, double rhs) { return lhs.value() <= rhs; }
+    template <size_t N_> FORCE_INLINE bool operator<=(double lhs, const Dual2_<N_>& rhs) { return lhs <= rhs.value(); }
+    template <size_t N_> FORCE_INLINE bool operator>=(const Dual2_<N_>& lhs, const Dual2_<N_>& rhs) { return lhs.value() >= rhs.value(); }
+    template <size_t N_> FORCE_INLINE bool operator>=(const Dual2_<N_>& lhs, double rhs) { return lhs.value() >= rhs; }
+    template <size_t N_> FORCE_INLINE bool operator>=(double lhs, const Dual2_<N_>& rhs) { return lhs >= rhs.value(); }
+} // namespace Dal::AAD
@@ -30,6 +30,8 @@ namespace Dal::AAD {
 
         enum { numNumbers_ = LHS_::numNumbers_ + RHS_::numNumbers_ };
 
+        [[nodiscard]] FORCE_INLINE bool Active() const { return lhs_.Active() || rhs_.Active(); }
+
         template <size_t N_, size_t n_> void PushAdjoint(TapNode_& exprNode, double adjoint) const {
             if constexpr (LHS_::numNumbers_ > 0)
                 lhs_.template PushAdjoint<N_, n_>(exprNode, adjoint * OP_::LeftDerivative(lhs_.value(), rhs_.value(), value()));
@@ -154,6 +156,8 @@ namespace Dal::AAD {
 
         enum { numNumbers_ = ARG_::numNumbers_ };
 
+        [[nodiscard]] FORCE_INLINE bool Active() const { return arg_.Active(); }
+
         template <size_t N_, size_t n_>
         FORCE_INLINE void PushAdjoint(TapNode_& exprNode, double adjoint) const {
             if constexpr (ARG_::numNumbers_ > 0)
@@ -456,14 +460,20 @@ namespace Dal::AAD {
 
     // the Number type, also an expression
 
+    //  a Number_ built from a double is passive: it is not on tape, and is only recorded through the expressions
+    //  combining it with active numbers, so constants and resets do not grow the tape; PutOnTape() makes it an active leaf
     class Number_ : public Expression_<Number_> {
         double value_;
-        TapNode_* node_;
+        TapNode_* node_ = nullptr;
 
         template <size_t N_>
         FORCE_INLINE TapNode_* CreateMultiNode() { return tape_->RecordNode<N_>(); }
 
         template <class E_> void FromExpr(const Expression_<E_>& e) {
+            if (!static_cast<const E_&>(e).Active()) {
+                node_ = nullptr;
+                return;
+            }
             auto* node = this->CreateMultiNode<E_::numNumbers_>();
             static_cast<const E_&>(e).template PushAdjoint<E_::numNumbers_, 0>(*node, 1.0);
             node_ = node;
@@ -472,6 +482,12 @@ namespace Dal::AAD {
         static thread_local std::mutex mutex_;
         static thread_local Tape_* tape_;
 
+        static double& Scratch() {
+            static thread_local double scratch;
+            scratch = 0.0;
+            return scratch;
+        }
+
     public:
         static void SetTape(Tape_& tape) {
             std::lock_guard<std::mutex> lock(mutex_);
@@ -486,17 +502,24 @@ namespace Dal::AAD {
 
         template <size_t N_, size_t n_>
         FORCE_INLINE void PushAdjoint(TapNode_& exprNode, double adjoint) const {
-            exprNode.pAdjPtrs_[n_] = Tape_::multi_ ? node_->pAdjoints_ : &node_->adjoint_;
-            exprNode.pDerivatives_[n_] = adjoint;
+            if (node_) {
+                exprNode.pAdjPtrs_[n_] = Tape_::multi_ ? node_->pAdjoints_ : &node_->adjoint_;
+                exprNode.pDerivatives_[n_] = adjoint;
+            } else {
+                exprNode.pAdjPtrs_[n_] = tape_->Sink();
+                exprNode.pDerivatives_[n_] = 0.0;
+            }
         }
 
+        [[nodiscard]] FORCE_INLINE bool Active() const { return node_ != nullptr; }
+
         Number_() = default;
 
-        Number_(double val) : value_(val) { node_ = CreateMultiNode<0>(); }
+        Number_(double val) : value_(val) {}
 
         FORCE_INLINE Number_& operator=(double val) {
             value_ = val;
-            node_ = CreateMultiNode<0>();
+            node_ = nullptr;
             return *this;
         }
 
@@ -517,12 +540,22 @@ namespace Dal::AAD {
         [[nodiscard]] FORCE_INLINE double value() const { return value_; }
         FORCE_INLINE void ResetAdjoints() { tape_->ResetAdjoints(); }
 
+        //  the adjoints of a passive number are zero, and writes to them are discarded:
+        //  the mutable accessors hand out a scratch value zeroed on each call, never shared with the tape
         [[nodiscard]] FORCE_INLINE double Adjoint() const {
-            return node_->Adjoint();
+            return node_ ? node_->Adjoint() : 0.0;
         }
 
         [[nodiscard]] FORCE_INLINE double& Adjoint() {
-            return node_->Adjoint();
+            return node_ ? node_->Adjoint() : Scratch();
+        }
+
+        [[nodiscard]] FORCE_INLINE double Adjoint(size_t n) const {
+            return node_ ? node_->Adjoint(n) : 0.0;
+        }
+
+        [[nodiscard]] FORCE_INLINE double& Adjoint(size_t n) {
+            return node_ ? node_->Adjoint(n) : Scratch();
         }
 
         static void PropagateAdjoints(Tape_::Iterator_ propagateFrom, Tape_::Iterator_ propagateTo) {
@@ -535,6 +568,8 @@ namespace Dal::AAD {
         }
 
         void PropagateAdjoints(Tape_::Iterator_ propagateTo) {
+            if (!node_)
+                return;
             Adjoint() = 1.0;
             auto it = tape_->Find(node_);
             while (it != propagateTo) {
@@ -565,6 +600,16 @@ namespace Dal::AAD {
             it->PropagateAll();
         }
 
+        //  in multi mode, the adjoints seeded on any node after the mark are propagated in one sweep
+        static void PropagateMultiToMark() {
+            if (tape_->End() != tape_->MarkIt())
+                PropagateAdjointsMulti(std::prev(tape_->End()), tape_->MarkIt());
+        }
+
+        static void PropagateMultiMarkToStart() {
+            PropagateAdjointsMulti(std::prev(tape_->MarkIt()), tape_->Begin());
+        }
+
         // unary operators
 
         template <class E_>
@@ -14,11 +14,15 @@
 
 #include <algorithm>
 #include <iostream>
+#include <dal/platform/platform.hpp>
 
 namespace Dal::AAD {
+    class Checkpoint_;
+
     class TapNode_ {
         const size_t n_;
-        static size_t numAdj_;
+        //  adjoints per node in multi mode, a setting of the thread recording and propagating
+        static thread_local size_t numAdj_;
 
         double adjoint_ = 0;
         double* pDerivatives_ = nullptr;
@@ -27,6 +31,7 @@ namespace Dal::AAD {
 
         friend class Tape_;
         friend class Number_;
+        friend class Checkpoint_;
         friend auto SetNumResultsForAAD(bool, size_t);
         friend struct NumResultsResetterForAAD_;
 
@@ -37,23 +42,34 @@ namespace Dal::AAD {
 
         double& Adjoint(size_t n) { return pAdjoints_[n]; }
 
+        //  the common arities are unrolled: most nodes are leaves, unary or binary operations
         void PropagateOne() {
             if (!n_ || fabs(adjoint_) <= Dal::EPSILON)
                 return;
 
-            for (size_t i = 0; i < n_; ++i)
-                *(pAdjPtrs_[i]) += adjoint_ * pDerivatives_[i];
+            switch (n_) {
+            case 1:
+                *(pAdjPtrs_[0]) += adjoint_ * pDerivatives_[0];
+                return;
+            case 2:
+                *(pAdjPtrs_[0]) += adjoint_ * pDerivatives_[0];
+                *(pAdjPtrs_[1]) += adjoint_ * pDerivatives_[1];
+                return;
+            default:
+                for (size_t i = 0; i < n_; ++i)
+                    *(pAdjPtrs_[i]) += adjoint_ * pDerivatives_[i];
+            }
         }
 
+        //  an argument is always recorded before the node: its adjoints never alias the node's, and the inner loop vectorizes
         void PropagateAll() {
-            if (!n_ || std::all_of(pAdjoints_, pAdjoints_ + numAdj_, [](double x) { return fabs(x) <= Dal::EPSILON; }))
-                return;
-
+            const size_t numAdj = numAdj_;
+            const double* RESTRICT adjoints = pAdjoints_;
             for (size_t i = 0; i < n_; ++i) {
-                double* adjPtr = pAdjPtrs_[i];
-                double ders = pDerivatives_[i];
-                for (size_t j = 0; j < numAdj_; ++j)
-                    adjPtr[j] += ders * pAdjoints_[j];
+                double* RESTRICT adjPtr = pAdjPtrs_[i];
+                const double ders = pDerivatives_[i];
+                for (size_t j = 0; j < numAdj; ++j)
+                    adjPtr[j] += ders * adjoints[j];
             }
         }
 
@@ -64,4 +64,47 @@ namespace Dal::AAD {
         for (auto& s : path)
             s.Initialize();
     }
+
+    /*
+     * Batch of scenarios in structure-of-arrays layout:
+     * for each event date, one contiguous lane per simulated quantity, indexed by path in the batch
+     */
+
+    struct BatchSample_ {
+        Vector_<> spot_;
+        Vector_<> numeraire_;
+
+        void Allocate(size_t width) {
+            spot_.Resize(width);
+            numeraire_.Resize(width);
+        }
+
+        void Initialize() {
+            spot_.Fill(0.0);
+            numeraire_.Fill(1.0);
+        }
+
+        [[nodiscard]] size_t Width() const { return spot_.size(); }
+    };
+
+    using BatchScenario_ = Vector_<BatchSample_>;
+
+    inline void AllocateBatchPath(const Vector_<SampleDef_>& defLine, size_t width, BatchScenario_& path) {
+        path.Resize(defLine.size());
+        for (auto& s : path)
+            s.Allocate(width);
+    }
+
+    inline void InitializeBatchPath(BatchScenario_& path) {
+        for (auto& s : path)
+            s.Initialize();
+    }
+
+    //  Copy a single path into lane `lane` of a batch
+    template <class T_> inline void ScatterPath(const Scenario_<T_>& path, size_t lane, BatchScenario_* batch) {
+        for (size_t i = 0; i < path.size(); ++i) {
+            (*batch)[i].spot_[lane] = static_cast<double>(path[i].spot_);
+            (*batch)[i].numeraire_[lane] = static_cast<double>(path[i].numeraire_);
+        }
+    }
 } // namespace Dal
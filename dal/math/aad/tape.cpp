@@ -2,10 +2,13 @@
 // Created by wegam on 2023/2/18.
 //
 
+#include <mutex>
+#include <set>
 #include <dal/platform/platform.hpp>
 
 #include <dal/math/aad/expr.hpp>
 #include <dal/math/aad/tape.hpp>
+#include <dal/utilities/exceptions.hpp>
 
 namespace Dal::AAD {
 
@@ -18,11 +21,63 @@ namespace Dal::AAD {
         }
     }
 
+    void Tape_::ResetAdjointsToMark() {
+        const auto mark = nodes_.Mark();
+        for (auto it = nodes_.Begin(); it != mark; ++it) {
+            it->adjoint_ = 0.;
+            if (multi_)
+                std::fill(it->pAdjoints_, it->pAdjoints_ + TapNode_::numAdj_, 0.);
+        }
+    }
+
     void Tape_::Clear() {
-        adjointsMulti_.Clear();
-        ders_.Clear();
-        argPtrs_.Clear();
-        nodes_.Clear();
+        adjointsMulti_.SetBlockSize(2 * blockSize_);
+        ders_.SetBlockSize(4 * blockSize_);
+        argPtrs_.SetBlockSize(4 * blockSize_);
+        nodes_.SetBlockSize(blockSize_);
+    }
+
+    void Tape_::Trim() {
+        adjointsMulti_.Trim();
+        ders_.Trim();
+        argPtrs_.Trim();
+        nodes_.Trim();
+    }
+
+    void Tape_::SetBlockSize(size_t nodes_per_block) {
+        //  a block takes the largest node, including its adjoints in multi mode
+        REQUIRE(nodes_per_block >= 256, "tape blocks should hold at least 256 nodes");
+        REQUIRE(2 * nodes_per_block >= TapNode_::numAdj_, "tape blocks should hold the adjoints of a node");
+        blockSize_ = nodes_per_block;
+    }
+
+    TapeStats_ Tape_::Stats() const {
+        TapeStats_ retval;
+        retval.nodes_ = nodes_.Size();
+        retval.derivatives_ = ders_.Size();
+        retval.blocks_ = nodes_.NumBlocks() + ders_.NumBlocks() + argPtrs_.NumBlocks() + adjointsMulti_.NumBlocks();
+        retval.bytes_ = nodes_.Bytes() + ders_.Bytes() + argPtrs_.Bytes() + adjointsMulti_.Bytes();
+        retval.nodeBlocks_ = nodes_.HighWater();
+        retval.derBlocks_ = ders_.HighWater();
+        retval.argBlocks_ = argPtrs_.HighWater();
+        retval.adjBlocks_ = adjointsMulti_.HighWater();
+        return retval;
+    }
+
+    void Tape_::Reserve(const TapeStats_& high_water) {
+        nodes_.Reserve(high_water.nodeBlocks_);
+        ders_.Reserve(high_water.derBlocks_);
+        argPtrs_.Reserve(high_water.argBlocks_);
+        if (multi_)
+            adjointsMulti_.Reserve(high_water.adjBlocks_);
+    }
+
+    void Tape_::ReserveAhead(const TapeSize_& size) {
+        nodes_.ReserveAhead(size.nodes_);
+        ders_.ReserveAhead(size.derivatives_);
+        argPtrs_.ReserveAhead(size.derivatives_);
+        if (multi_)
+            adjointsMulti_.ReserveAhead(size.nodes_ * TapNode_::numAdj_);
     }
 
     void Tape_::Mark() {
@@ -34,6 +89,10 @@ namespace Dal::AAD {
     }
 
     void Tape_::Rewind()  {
+        if (trimRequested_.exchange(false, std::memory_order_relaxed)) {
+            Trim();
+            return;
+        }
         if (multi_)
             adjointsMulti_.Rewind();
         ders_.Rewind();
@@ -53,5 +112,41 @@ namespace Dal::AAD {
         return nodes_.Mark();
     }
 
+    namespace {
+        //  the thread tapes alive, registered and removed by their threads
+        std::mutex& RegistryMutex() {
+            static std::mutex theMutex;
+            return theMutex;
+        }
+
+        std::set<Tape_*>& Registry() {
+            static std::set<Tape_*> theRegistry;
+            return theRegistry;
+        }
+
+        struct ThreadTape_ {
+            Tape_ tape_;
+            ThreadTape_() {
+                std::lock_guard<std::mutex> lock(RegistryMutex());
+                Registry().insert(&tape_);
+            }
+            ~ThreadTape_() {
+                std::lock_guard<std::mutex> lock(RegistryMutex());
+                Registry().erase(&tape_);
+            }
+        };
+    } // namespace
+
+    Tape_* ThreadTape() {
+        static thread_local ThreadTape_ theTape;
+        return &theTape.tape_;
+    }
+
+    void TrimThreadTapes() {
+        std::lock_guard<std::mutex> lock(RegistryMutex());
+        for (auto* tape : Registry())
+            tape->RequestTrim();
+    }
+
 
 } // namespace Dal::AAD
\ No newline at end of file
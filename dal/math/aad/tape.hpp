@@ -12,24 +12,64 @@
 
 #pragma once
 
+#include <atomic>
 #include <dal/math/aad/blocklist.hpp>
 #include <dal/math/aad/node.hpp>
 
 
 namespace Dal::AAD {
     class Number_;
+    //  default entries per block: nodes, multi-mode adjoints and derivatives (or argument pointers)
     constexpr size_t BLOCK_SIZE = 16384;
     constexpr size_t ADJ_SIZE = 32768;
     constexpr size_t DATA_SIZE = 65536;
 
+    //  Memory footprint of a tape: the block high-water marks of a run can be given to Reserve() before the next one
+    struct TapeStats_ {
+        size_t nodes_ = 0;
+        size_t derivatives_ = 0;
+        size_t blocks_ = 0;
+        size_t bytes_ = 0;
+        size_t nodeBlocks_ = 0;
+        size_t derBlocks_ = 0;
+        size_t argBlocks_ = 0;
+        size_t adjBlocks_ = 0;
+    };
+
+    //  Upper bound of what a calculation records: nodes, and derivatives (one per argument of a node)
+    struct TapeSize_ {
+        size_t nodes_ = 0;
+        size_t derivatives_ = 0;
+
+        TapeSize_& operator+=(const TapeSize_& rhs) {
+            nodes_ += rhs.nodes_;
+            derivatives_ += rhs.derivatives_;
+            return *this;
+        }
+        //  memory taken on the tape, multi-mode adjoints aside
+        [[nodiscard]] size_t Bytes() const { return nodes_ * sizeof(TapNode_) + derivatives_ * (sizeof(double) + sizeof(double*)); }
+    };
+
     class Tape_ {
-        static bool multi_;
-        BlockList_<double, ADJ_SIZE> adjointsMulti_;
-        BlockList_<double, DATA_SIZE> ders_;
-        BlockList_<double*, DATA_SIZE> argPtrs_;
-        BlockList_<TapNode_, BLOCK_SIZE> nodes_;
+        //  multi mode is a setting of the recording thread, see SetNumResultsForAAD
+        static thread_local bool multi_;
+        static size_t blockSize_;
+        BlockList_<double, ADJ_SIZE> adjointsMulti_{2 * blockSize_};
+        BlockList_<double, DATA_SIZE> ders_{4 * blockSize_};
+        BlockList_<double*, DATA_SIZE> argPtrs_{4 * blockSize_};
+        BlockList_<TapNode_, BLOCK_SIZE> nodes_{blockSize_};
+        //  passive arguments of recorded nodes point their adjoints here, with a zero derivative
+        std::vector<double> sink_ = std::vector<double>(1, 0.0);
+        //  set by TrimThreadTapes from any thread, acted on by the owner at its next Rewind()
+        std::atomic<bool> trimRequested_{false};
         char pad_[64];
 
+        double* Sink() {
+            if (multi_ && sink_.size() < TapNode_::numAdj_)
+                sink_.resize(TapNode_::numAdj_, 0.0);
+            return sink_.data();
+        }
+
         friend auto SetNumResultsForAAD(bool, size_t);
         friend struct NumResultsResetterForAAD_;
         friend class Number_;
@@ -50,7 +90,20 @@ namespace Dal::AAD {
         }
 
         void ResetAdjoints();
+        void ResetAdjointsToMark();
+        //  also applies the current block size
         void Clear();
+        //  discards the content, releasing the memory beyond the first chunk of every list
+        void Trim();
+
+        //  nodes per block of the tapes constructed or cleared from now on, the other blocks keep their proportions to it
+        static void SetBlockSize(size_t nodes_per_block);
+        [[nodiscard]] static size_t BlockSize() { return blockSize_; }
+
+        [[nodiscard]] TapeStats_ Stats() const;
+        void Reserve(const TapeStats_& high_water);
+        //  pre-allocates room for size after the current position, typically a bound on one path after the mark
+        void ReserveAhead(const TapeSize_& size);
 
         using Iterator_ = typename BlockList_<TapNode_, BLOCK_SIZE>::Iterator_;
         Iterator_ Begin() { return nodes_.Begin(); }
@@ -59,7 +112,16 @@ namespace Dal::AAD {
 
         void Mark();
         void RewindToMark();
+        //  trims instead when a trim was requested since the last rewind
         void Rewind();
+        void RequestTrim() { trimRequested_.store(true, std::memory_order_relaxed); }
         Iterator_ MarkIt();
     };
+
+    //  The tape of the calling thread, constructed by the thread itself on first use so that its memory is first touched there,
+    //  and kept until the thread exits
+    Tape_* ThreadTape();
+    //  asks every thread tape to release its memory beyond the first chunks; each owner does so at its next Rewind(),
+    //  so that no tape is trimmed while it is recording
+    void TrimThreadTapes();
 } // namespace Dal::AAD
@@ -43,6 +43,10 @@ namespace Dal {
         inline CI_ begin() const { return First(); }
         CI_ Last() const { return vals_.end() - cols_; }
         inline CI_ end() const { return Last(); }
+        I_ First() { return vals_.begin(); }
+        inline I_ begin() { return First(); }
+        I_ Last() { return vals_.end() - cols_; }
+        inline I_ end() { return Last(); }
 
         CR_ operator()(int row, int col) const { return hooks_[row][col]; }
         R_ operator()(int row, int col) { return hooks_[row][col]; }
@@ -12,7 +12,9 @@ namespace Dal {
         virtual ~Random_() = default;
         virtual void FillUniform(Vector_<>* deviates) = 0;
         virtual void FillNormal(Vector_<>* deviates) = 0;
-        virtual void SkipTo(size_t n_points) = 0;
+        //  positions the generator as if n_paths calls to FillNormal had been made from the start
+        //  pseudo random uniform draws come in mirrored pairs, so outside antithetic mode that is 2 * n_paths calls to FillUniform
+        virtual void SkipTo(size_t n_paths) = 0;
         [[nodiscard]] virtual Random_* Clone() const = 0;
         [[nodiscard]] virtual size_t NDim() const = 0;
     };
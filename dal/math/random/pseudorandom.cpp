@@ -24,6 +24,12 @@ namespace Dal {
         }
     }
 
+    void PseudoRandom_::SkipHalfPair() {
+        for (auto& u : cache_)
+            u = NextUniform();
+        anti_ = true;
+    }
+
     namespace {
         namespace RWT {
             template <class SRC_>
@@ -36,7 +42,20 @@ namespace Dal {
         } // namespace RWT
     }     // namespace
 
-    void PseudoRandom_::FillNormal(Vector_<>* deviates) { RWT::Fill(this, deviates->begin(), deviates->end()); }
+    void PseudoRandom_::FillNormal(Vector_<>* deviates) {
+        if (!antithetic_)
+            RWT::Fill(this, deviates->begin(), deviates->end());
+        else if (anti_) {
+            //  InverseNCDF is odd, so the mirror of u gives exactly -z
+            for (size_t i = 0; i < deviates->size(); ++i)
+                (*deviates)[i] = -InverseNCDF(cache_[i], precise_, precise_);
+            anti_ = false;
+        } else {
+            for (size_t i = 0; i < deviates->size(); ++i)
+                (*deviates)[i] = InverseNCDF(cache_[i] = NextUniform(), precise_, precise_);
+            anti_ = true;
+        }
+    }
 
     namespace {
         // Generators similar to Knuth's IRN55, with shuffling
@@ -64,8 +83,8 @@ namespace Dal {
                 return MUL * (2 * ret_val + 1); // avoid 0.0 and 1.0
             }
 
-            explicit ShuffledIRN_(int seed, size_t n_dim = 1, bool precise = false)
-                : PseudoRandom_(n_dim, precise), seed_(seed), irn_(M_), shuffle_(S_), irl_(0) {
+            explicit ShuffledIRN_(int seed, size_t n_dim = 1, bool precise = false, bool antithetic = false)
+                : PseudoRandom_(n_dim, precise, antithetic), seed_(seed), irn_(M_), shuffle_(S_), irl_(0) {
                 const unsigned MASK = 0x1F2E3D4C;
                 const unsigned MUL = 17;
                 // initialize IRN_
@@ -81,7 +100,7 @@ namespace Dal {
                 return new ShuffledIRN_<M_, L_, S_>(irn_[0] ^ irn_[1]);
             }
 
-            [[nodiscard]] PseudoRandom_* Clone() const override { return new ShuffledIRN_(seed_, cache_.size()); }
+            [[nodiscard]] PseudoRandom_* Clone() const override { return new ShuffledIRN_(seed_, cache_.size(), precise_, antithetic_); }
 
             void SkipTo(size_t n_paths) override {}
         };
@@ -98,8 +117,8 @@ namespace Dal {
             const double a_, b_;
             double xn_, xn1_, xn2_, yn_, yn1_, yn2_;
 
-            explicit MRG32k32a_(const unsigned& a = 12345, const unsigned& b = 12346, size_t n_dim = 1, bool precise = false)
-                : PseudoRandom_(n_dim, precise), a_(a), b_(b) {
+            explicit MRG32k32a_(const unsigned& a = 12345, const unsigned& b = 12346, size_t n_dim = 1, bool precise = false, bool antithetic = false)
+                : PseudoRandom_(n_dim, precise, antithetic), a_(a), b_(b) {
                 Reset();
             }
 
@@ -137,17 +156,15 @@ namespace Dal {
             [[nodiscard]] PseudoRandom_* Branch(int i_child) const override { return new MRG32k32a_(); }
 
             [[nodiscard]] PseudoRandom_* Clone() const override {
-                return new MRG32k32a_(static_cast<unsigned>(a_), static_cast<unsigned>(b_), cache_.size());
+                return new MRG32k32a_(static_cast<unsigned>(a_), static_cast<unsigned>(b_), cache_.size(), precise_, antithetic_);
             }
 
             void SkipTo(size_t n_paths) override {
-                size_t n_points = n_paths * NDim();
+                //  paths of normal draws: each one consumes NDim uniforms, or only the first of each pair in antithetic mode
+                //  uniform draws are always mirrored in pairs, so 2n uniform paths span the same stream as n normal paths
+                size_t n_points = antithetic_ ? n_paths / 2 * NDim() : n_paths * NDim();
                 Reset();
-
-                if (n_points & 1)
-                    n_points = (n_points - 1) / 2;
-                else
-                    n_points /= 2;
+                anti_ = false;
 
                 static constexpr size_t m1l = static_cast<size_t>(m1_);
                 static constexpr size_t m2l = static_cast<size_t>(m2_);
@@ -185,6 +202,9 @@ namespace Dal {
                 yn_ = static_cast<double>(temp[0]);
                 yn1_ = static_cast<double>(temp[1]);
                 yn2_ = static_cast<double>(temp[2]);
+
+                if (antithetic_ && (n_paths & 1))
+                    SkipHalfPair();
             }
 
         private:
@@ -236,12 +256,12 @@ namespace Dal {
 
 #include <dal/auto/MG_RNGType_enum.inc>
 
-    PseudoRandom_* New(const RNGType_& type, int seed, size_t n_dim, bool precise) {
+    PseudoRandom_* New(const RNGType_& type, int seed, size_t n_dim, bool precise, bool antithetic) {
         PseudoRandom_* ret;
         if (type == RNGType_("IRN"))
-            ret = new ShuffledIRN_<55, 31, 128>(seed, n_dim, precise);
+            ret = new ShuffledIRN_<55, 31, 128>(seed, n_dim, precise, antithetic);
         else if (type == RNGType_("MRG32"))
-            ret = new MRG32k32a_(seed, seed + 1, n_dim, precise);
+            ret = new MRG32k32a_(seed, seed + 1, n_dim, precise, antithetic);
         else
             THROW("RNG type is not recognized");
         return ret;
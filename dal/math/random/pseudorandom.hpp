@@ -30,13 +30,19 @@ precise is boolean
 
 namespace Dal {
     class PseudoRandom_ : public Random_ {
-        bool anti_ = false;
-
     protected:
+        //  uniform draws always come in pairs: the first draw is kept in cache_ and anti_ is set until its mirror 1 - u is served
+        //  in antithetic mode normal draws are paired the same way, the mirror of z being -z
+        bool antithetic_;
+        bool anti_ = false;
         Vector_<> cache_;
 
+        //  after skipping an odd number of paths in antithetic mode, the next draw is the mirror of a fresh one
+        void SkipHalfPair();
+
     public:
-        explicit PseudoRandom_(size_t n_dim, bool precise = false) : cache_(n_dim), precise_(precise) {}
+        explicit PseudoRandom_(size_t n_dim, bool precise = false, bool antithetic = false)
+            : antithetic_(antithetic), cache_(n_dim), precise_(precise) {}
         ~PseudoRandom_() override = default;
         virtual double NextUniform() = 0;
         void FillUniform(Vector_<>* deviates) override;
@@ -48,7 +54,7 @@ namespace Dal {
     };
 
 #include <dal/auto/MG_RNGType_enum.hpp>
-    PseudoRandom_* New(const RNGType_& type, int seed, size_t n_dim = 1, bool precise = false);
+    PseudoRandom_* New(const RNGType_& type, int seed, size_t n_dim = 1, bool precise = false, bool antithetic = false);
 
     class BASE_EXPORT PseudoRSG_: public Storable_ {
         std::unique_ptr<PseudoRandom_> rsg_;
@@ -31,6 +31,21 @@ namespace Dal {
 
             virtual void GeneratePath(const Vector_<>& gaussVec, Scenario_<T_>* path) const = 0;
 
+            //  Upper bound of what GeneratePath() records on the tape once allocated, to size the tapes of AAD simulations
+            [[nodiscard]] virtual TapeSize_ PathTapeSize() const = 0;
+
+            //  Generate the first n_paths paths of a batch in structure-of-arrays layout, one path per gaussian vector
+            //  default goes path by path through GeneratePath, using `workspace` as scratch scenario
+            virtual void GeneratePaths(const Vector_<Vector_<>>& gaussVecs,
+                                       size_t n_paths,
+                                       Scenario_<T_>* workspace,
+                                       BatchScenario_* paths) const {
+                for (size_t k = 0; k < n_paths; ++k) {
+                    GeneratePath(gaussVecs[k], workspace);
+                    ScatterPath(*workspace, k, paths);
+                }
+            }
+
             virtual std::unique_ptr<Model_<T_>> Clone() const = 0;
 
             virtual ~Model_() = default;
@@ -38,6 +53,10 @@ namespace Dal {
             [[nodiscard]] virtual const Vector_<T_*>& Parameters() const = 0;
             [[nodiscard]] virtual const Vector_<String_>& ParameterLabels() const = 0;
 
+            //  Values computed by Init() from the parameters, once allocated: a model exposing them has its initialization
+            //  checkpointed in AAD simulations (see AAD::Checkpoint_), the default exposes none
+            [[nodiscard]] virtual Vector_<T_*> InitOutputs() { return Vector_<T_*>(); }
+
             [[nodiscard]] size_t NumParams() const { return const_cast<Model_*>(this)->Parameters().size(); }
         };
     }
@@ -124,6 +124,9 @@ namespace Dal {
 
             [[nodiscard]] size_t SimDim() const override { return timeLine_.size() - 1; }
 
+            //  log of the spot, then per step the log spot increment (3 arguments) and its exponential
+            [[nodiscard]] TapeSize_ PathTapeSize() const override { return TapeSize_{1 + 2 * SimDim(), 1 + 4 * SimDim()}; }
+
             void GeneratePath(const Vector_<>& gaussVec, Scenario_<T_>* path) const override {
                 T_ spot = spot_;
                 size_t idx = 0;
@@ -140,6 +143,47 @@ namespace Dal {
                     ++idx;
                 }
             }
+
+            void GeneratePaths(const Vector_<Vector_<>>& gaussVecs,
+                               size_t n_paths,
+                               Scenario_<T_>* workspace,
+                               BatchScenario_* paths) const override {
+                if constexpr (!std::is_same_v<T_, double>)
+                    Model_<T_>::GeneratePaths(gaussVecs, n_paths, workspace, paths);
+                else {
+                    size_t idx = 0;
+                    if (todayOnTimeLine_) {
+                        BatchSample_& sample = (*paths)[idx];
+                        for (size_t k = 0; k < n_paths; ++k) {
+                            if ((*defLine_)[idx].numeraire_)
+                                sample.numeraire_[k] = numeraires_[idx];
+                            sample.spot_[k] = spot_;
+                        }
+                        ++idx;
+                    }
+
+                    //  First pass accumulates log spots step by step in the spot lanes, second pass exponentiates
+                    const size_t first = idx;
+                    const double logSpot0 = Dal::log(spot_);
+                    const size_t n = timeLine_.size() - 1;
+                    for (size_t i = 0; i < n; ++i, ++idx) {
+                        double* logSpot = &(*paths)[idx].spot_[0];
+                        const double* prev = i == 0 ? nullptr : &(*paths)[idx - 1].spot_[0];
+                        for (size_t k = 0; k < n_paths; ++k)
+                            logSpot[k] = (prev ? prev[k] : logSpot0) + (drifts_[i] + stds_[i] * gaussVecs[k][i]);
+                    }
+
+                    for (size_t j = first; j < idx; ++j) {
+                        BatchSample_& sample = (*paths)[j];
+                        const bool numeraire = (*defLine_)[j].numeraire_;
+                        for (size_t k = 0; k < n_paths; ++k) {
+                            sample.spot_[k] = Dal::exp(sample.spot_[k]);
+                            if (numeraire)
+                                sample.numeraire_[k] = numeraires_[j];
+                        }
+                    }
+                }
+            }
         };
     }
 
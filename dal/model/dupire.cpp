@@ -5,8 +5,67 @@
 #include <dal/platform/platform.hpp>
 #include <dal/platform/strict.hpp>
 #include <dal/model/dupire.hpp>
+#include <dal/utilities/exceptions.hpp>
 
 namespace Dal {
+    namespace AAD {
+        Matrix_<> DupireCalibJacobian_::Chain(const Vector_<>& risks, size_t first) const {
+            REQUIRE(risks.size() >= first + rows_.size(), "risks do not cover the local volatilities");
+            const size_t nMats = mats_.size();
+            Matrix_<> retval(strikes_.size(), nMats, 0.0);
+            for (size_t r = 0; r < rows_.size(); ++r)
+                for (const auto& [k, d] : rows_[r])
+                    retval(k / nMats, k % nMats) += d * risks[first + r];
+            return retval;
+        }
+
+        DupireCalibJacobian_ DupireCalibWithJacobian(const IVS_& ivs,
+                                                     const Vector_<>& inclSpots,
+                                                     double maxDs,
+                                                     const Vector_<>& inclTimes,
+                                                     double maxDt,
+                                                     const Vector_<>& strikes,
+                                                     const Vector_<>& mats) {
+            auto calib = DupireCalib(ivs, inclSpots, maxDs, inclTimes, maxDt);
+            DupireCalibJacobian_ retval{calib.spots_, calib.times_, calib.lVols_, strikes, mats};
+            const size_t nSpots = retval.spots_.size();
+            const size_t nTimes = retval.times_.size();
+            retval.rows_.Resize(nSpots * nTimes);
+
+            //  the spreads are the leaves before the mark, each local volatility is recorded after it and propagated to it
+            Tape_ tape;
+            TapeScope_ scope(tape);
+            RiskView_<Number_> riskView(strikes, mats);
+            PutOnTape(riskView.begin(), riskView.end());
+            tape.Mark();
+
+            for (size_t j = 0; j < nTimes; ++j) {
+                const double maturity = retval.times_[j];
+                const auto [il, ih] = DupireCalibRange(ivs, maturity, retval.spots_.begin(), nSpots);
+                for (int i = il; i <= ih; ++i) {
+                    tape.RewindToMark();
+                    Number_ lVol = ivs.LocalVol(retval.spots_[i], maturity, &riskView);
+                    lVol.PropagateToMark();
+                    auto& row = retval.rows_[i * nTimes + j];
+                    size_t k = 0;
+                    for (auto& spread : riskView) {
+                        double& adjoint = spread.Adjoint();
+                        if (adjoint != 0.0) {
+                            row.emplace_back(k, adjoint);
+                            adjoint = 0.0;
+                        }
+                        ++k;
+                    }
+                }
+                for (int i = 0; i < il; ++i)
+                    retval.rows_[i * nTimes + j] = retval.rows_[il * nTimes + j];
+                for (int i = ih + 1; i < static_cast<int>(nSpots); ++i)
+                    retval.rows_[i * nTimes + j] = retval.rows_[ih * nTimes + j];
+            }
+            return retval;
+        }
+    } // namespace AAD
+
 #include <dal/auto/MG_DupireModelData_v1_Read.inc>
 #include <dal/auto/MG_DupireModelData_v1_Write.inc>
 
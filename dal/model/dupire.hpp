@@ -138,8 +138,28 @@ namespace Dal {
                 }
             }
 
+            [[nodiscard]] Vector_<T_*> InitOutputs() override {
+                Vector_<T_*> retval;
+                for (auto& drift : drifts_)
+                    retval.push_back(&drift);
+                for (int i = 0; i < interpVols_.Rows(); ++i)
+                    for (int j = 0; j < interpVols_.Cols(); ++j)
+                        retval.push_back(&interpVols_(i, j));
+                for (size_t i = 0; i < numeraires_.size(); ++i) {
+                    if ((*defLine_)[i].numeraire_)
+                        retval.push_back(&numeraires_[i]);
+                    for (auto& df : discounts_[i])
+                        retval.push_back(&df);
+                }
+                return retval;
+            }
+
             [[nodiscard]] size_t SimDim() const override { return timeLine_.size() - 1; }
 
+            //  log and exponential of the spot, then per step the interpolated volatility (3 arguments),
+            //  the log spot increment (4 arguments) and its exponential
+            [[nodiscard]] TapeSize_ PathTapeSize() const override { return TapeSize_{2 + 3 * SimDim(), 2 + 8 * SimDim()}; }
+
             void GeneratePath(const Vector_<>& gaussVec, Scenario_<T_>* path) const override {
                 T_ logSpot = Dal::log(spot_);
                 size_t idx = 0;
@@ -184,17 +204,8 @@ namespace Dal {
             }
         };
 
-        template <class IT_, class OT_, class T_ = double>
-        void DupireCalibMaturity(const IVS_& ivs,
-                                 double maturity,
-                                 IT_ spotsBegin,
-                                 IT_ spotsEnd,
-                                 OT_ lVolsBegin,
-                                 const RiskView_<T_>& riskView = RiskView_<double>()) {
-            // Number of spots
-            IT_ spots = spotsBegin;
-            const size_t nSpots = distance(spotsBegin, spotsEnd);
-
+        //  Spots calibrated at a maturity, first and last: local volatilities are extrapolated flat outside
+        template <class IT_> std::pair<int, int> DupireCalibRange(const IVS_& ivs, double maturity, IT_ spots, size_t nSpots) {
             // Estimate ATM, and we cut the grid 2 stdevs away to avoid instabilities
             const auto atmCall = static_cast<double>(ivs.Call(ivs.Spot(), maturity));
             // Standard deviation, approx. atm call * sqrt(2pi)
@@ -207,6 +218,20 @@ namespace Dal {
             int ih = nSpots - 1;
             while (ih >= 0 && spots[ih] > ivs.Spot() + 2.5 * std)
                 --ih;
+            return std::make_pair(il, ih);
+        }
+
+        template <class IT_, class OT_, class T_ = double>
+        void DupireCalibMaturity(const IVS_& ivs,
+                                 double maturity,
+                                 IT_ spotsBegin,
+                                 IT_ spotsEnd,
+                                 OT_ lVolsBegin,
+                                 const RiskView_<T_>& riskView = RiskView_<double>()) {
+            // Number of spots
+            IT_ spots = spotsBegin;
+            const size_t nSpots = distance(spotsBegin, spotsEnd);
+            const auto [il, ih] = DupireCalibRange(ivs, maturity, spots, nSpots);
 
             // Loop on spots
             for (int i = il; i <= ih; ++i) {
@@ -244,6 +269,32 @@ namespace Dal {
             results.lVols_ = Dal::Matrix::MakeTranspose(lVolsT);
             return results;
         }
+
+        //  DupireCalib() with the sensitivities of its local volatilities to the spreads of a risk view on the implied volatilities
+        //  a local volatility only depends on the few spreads around its seven calls: they are differentiated once per calibration,
+        //  on a small tape reused for every grid point, and kept sparse
+        struct DupireCalibJacobian_ {
+            Vector_<> spots_;
+            Vector_<> times_;
+            Matrix_<> lVols_;
+            Vector_<> strikes_;
+            Vector_<> mats_;
+            //  row i * times_.size() + j for the local volatility at spots_[i] and times_[j], as the Dupire_ parameters:
+            //  pairs of spread index (strike-major, as in RiskView_) and derivative
+            Vector_<Vector_<std::pair<size_t, double>>> rows_;
+
+            //  implied volatility risks (strikes x maturities) from the risks to the local volatilities, starting at risks[first]
+            //  in the order of the Dupire_ parameters: 3 for the results of a simulation, after spot, rate and repo
+            [[nodiscard]] Matrix_<> Chain(const Vector_<>& risks, size_t first = 0) const;
+        };
+
+        DupireCalibJacobian_ DupireCalibWithJacobian(const IVS_& ivs,
+                                                     const Vector_<>& inclSpots,
+                                                     double maxDs,
+                                                     const Vector_<>& inclTimes,
+                                                     double maxDt,
+                                                     const Vector_<>& strikes,
+                                                     const Vector_<>& mats);
     }
 
     struct DupireModelData_: ModelData_ {
@@ -13,4 +13,9 @@ namespace Dal::Host {
 #define FORCE_INLINE __forceinline
 #else
 #define FORCE_INLINE __attribute__((always_inline)) inline
-#endif
\ No newline at end of file
+#endif
+#ifdef WIN32
+#define RESTRICT __restrict
+#else
+#define RESTRICT __restrict__
+#endif
@@ -0,0 +1,53 @@
+//
+// Created by wegam on 2024/10/27.
+//
+
+#include <dal/platform/platform.hpp>
+#include <dal/platform/strict.hpp>
+#include <dal/math/matrix/cholesky.hpp>
+#include <dal/math/matrix/squarematrix.hpp>
+#include <dal/script/control.hpp>
+#include <dal/utilities/numerics.hpp>
+
+namespace Dal::Script {
+    namespace {
+        //  relative to the mean control variance, keeps collinear controls (e.g. a duplicate, or the spot and a deep ITM call) solvable
+        constexpr double RIDGE = 1.0e-8;
+    } // namespace
+
+    Vector_<> ControlBetas(const Vector_<>& payoffs, const Matrix_<>& values) {
+        const auto nPaths = payoffs.size();
+        const auto nControls = values.Cols();
+        REQUIRE(values.Rows() == nPaths, "control values and payoffs should have the same number of paths");
+        REQUIRE(nPaths > 1, "at least two paths are needed to estimate the control coefficients");
+
+        const double payoffMean = Accumulate(payoffs) / static_cast<double>(nPaths);
+        Vector_<> means(nControls, 0.0);
+        for (int i = 0; i < values.Rows(); ++i)
+            for (int k = 0; k < nControls; ++k)
+                means[k] += values(i, k) / static_cast<double>(nPaths);
+
+        SquareMatrix_<> cov(nControls, 0.0);
+        Vector_<Vector_<>> betas(1, Vector_<>(nControls, 0.0));
+        for (int i = 0; i < values.Rows(); ++i) {
+            const double y = payoffs[i] - payoffMean;
+            for (int k = 0; k < nControls; ++k) {
+                const double ck = values(i, k) - means[k];
+                betas[0][k] += ck * y;
+                for (int l = 0; l < nControls; ++l)
+                    cov(k, l) += ck * (values(i, l) - means[l]);
+            }
+        }
+        double meanVar = 0.0, meanSquare = 0.0;
+        for (int k = 0; k < nControls; ++k) {
+            meanVar += cov(k, k) / static_cast<double>(nControls);
+            //  cov holds sums over the paths
+            meanSquare += Square(means[k]) * static_cast<double>(nPaths) / static_cast<double>(nControls);
+        }
+        REQUIRE(meanVar > Dal::EPSILON * (meanVar + meanSquare), "control values do not vary on the pilot paths");
+        for (int k = 0; k < nControls; ++k)
+            cov(k, k) += RIDGE * meanVar;
+        CholeskySolve(&cov, &betas);
+        return betas[0];
+    }
+} // namespace Dal::Script
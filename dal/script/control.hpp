@@ -0,0 +1,87 @@
+//
+// Created by wegam on 2024/10/27.
+//
+
+#pragma once
+
+#include <dal/math/aad/aad.hpp>
+#include <dal/math/aad/sample.hpp>
+#include <dal/math/matrix/matrixs.hpp>
+#include <dal/math/operators.hpp>
+#include <dal/math/specialfunctions.hpp>
+#include <dal/model/blackscholes.hpp>
+#include <dal/utilities/exceptions.hpp>
+
+namespace Dal::Script {
+
+    //  Control payoff paid on one of the product event dates, in numeraire units:
+    //  a call on the spot when strike_ > 0, the spot itself otherwise
+    struct ControlVariate_ {
+        //  index of the event date among the product (future) event dates
+        size_t event_;
+        double strike_;
+    };
+
+    //  Controls applied by the simulation: each path payoff is replaced by payoff - sum_k betas_[k] * (c_k - E[c_k])
+    struct ControlVariates_ {
+        Vector_<ControlVariate_> controls_;
+        Vector_<> betas_;
+        //  when set, receives the control values c_k of each path in the row of the path
+        Matrix_<>* pathValues_ = nullptr;
+    };
+
+    template <class T_> FORCE_INLINE T_ ControlPayoff(const ControlVariate_& control, const T_& spot, const T_& numeraire) {
+        if (control.strike_ > 0.0)
+            return (spot > control.strike_ ? T_(spot - control.strike_) : T_(0.0)) / numeraire;
+        return spot / numeraire;
+    }
+
+    //  Expectations of the controls under the model, on the tape in AAD mode so that their sensitivities flow to the model parameters
+    template <class T_> Vector_<T_> ControlExpectations(const ControlVariates_& controls, const AAD::Model_<T_>& model, const Vector_<>& time_line) {
+        const auto* bs = dynamic_cast<const AAD::BlackScholes_<T_>*>(&model);
+        REQUIRE(bs, "control variates are only supported with the Black - Scholes model");
+        Vector_<T_> retval;
+        for (const auto& control : controls.controls_) {
+            REQUIRE(control.event_ < time_line.size(), "control event index is out of the product time line");
+            const double mat = time_line[control.event_];
+            REQUIRE(mat > 0.0, "control event should be in the future");
+            //  discounted forward
+            const T_ fwd = bs->Spot() * Dal::exp(-bs->Div() * mat);
+            if (control.strike_ > 0.0) {
+                const T_ stdev = bs->Vol() * std::sqrt(mat);
+                const T_ df = Dal::exp(-bs->Rate() * mat);
+                const T_ dMinus = Dal::log(fwd / (control.strike_ * df)) / stdev - 0.5 * stdev;
+                const T_ dPlus = dMinus + stdev;
+                retval.push_back(fwd * NCDF(dPlus) - control.strike_ * df * NCDF(dMinus));
+            } else
+                retval.push_back(fwd);
+        }
+        return retval;
+    }
+
+    //  sum_k beta_k * (c_k - E[c_k]) on one path, sample(j) gives the spot and numeraire at event j
+    //  the control values are written to values when given
+    template <class T_, class S_>
+    T_ ControlAdjustment(const ControlVariates_& controls, const Vector_<T_>& expectations, S_ sample, double* values = nullptr) {
+        T_ retval(0.0);
+        for (size_t k = 0; k < controls.controls_.size(); ++k) {
+            const auto sn = sample(controls.controls_[k].event_);
+            const T_ c = ControlPayoff<T_>(controls.controls_[k], sn.first, sn.second);
+            if constexpr (std::is_same_v<T_, double>) {
+                if (values)
+                    values[k] = c;
+            }
+            retval += controls.betas_[k] * (c - expectations[k]);
+        }
+        return retval;
+    }
+
+    //  Upper bound of what ControlAdjustment() and its subtraction from the payoff record on the tape
+    inline AAD::TapeSize_ ControlTapeSize(const ControlVariates_& controls) {
+        const size_t n = controls.controls_.size();
+        return AAD::TapeSize_{3 * n + 1, 9 * n + 2};
+    }
+
+    //  Optimal coefficients from the path payoffs and control values of a pilot run: Cov(c)^-1 Cov(c, payoff)
+    Vector_<> ControlBetas(const Vector_<>& payoffs, const Matrix_<>& values);
+} // namespace Dal::Script
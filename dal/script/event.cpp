@@ -2,6 +2,9 @@
 // Created by wegam on 2022/11/5.
 //
 
+#include <algorithm>
+#include <cstdio>
+#include <set>
 #include <dal/platform/platform.hpp>
 #include <dal/platform/strict.hpp>
 #include <dal/script/event.hpp>
@@ -11,11 +14,33 @@
 #include <dal/script/event/schedule.hpp>
 
 namespace Dal::Script {
+    namespace {
+        using Tokens_ = Vector_<String_>;
+
+        //  Appends the tokens, with each macro name replaced by its already expanded body
+        void Expand(const Tokens_& tokens, const std::map<String_, Tokens_>& macros, Tokens_* dst) {
+            for (const auto& token : tokens) {
+                auto pm = macros.find(token);
+                if (pm == macros.end())
+                    dst->push_back(token);
+                else
+                    Append(dst, pm->second);
+            }
+        }
+
+        //  Position of the PeriodBegin and PeriodEnd placeholders of a schedule statement
+        struct Placeholder_ {
+            size_t pos_;
+            bool begin_;
+        };
+    } // namespace
+
     void ScriptProduct_::ParseEvents(const Vector_<std::pair<Cell_, String_>> &events) {
-        std::map<String_, String_> macros;
+        //  Macros are tokenized once, and expanded token by token, so a name never matches inside a longer word
+        //  String_ compares without case, so macro names, like PeriodBegin and PeriodEnd, match in any case
+        std::map<String_, Tokens_> macros;
         std::map<String_, double> constVariables;
-        std::map<Date_, String_> processedEvents;
-        std::map<Date_, String_> pastProcessedEvents;
+        std::map<Date_, Tokens_> processedEvents;
 
         for (const auto & event : events) {
             Cell_ cell = event.first;
@@ -25,49 +50,44 @@ namespace Dal::Script {
                 if (desc.find(":") < desc.size()) {
                     // find a schedule
                     auto schedule = ParseSchedule(Tokenize(desc));
-                    String_ replaced = event.second;
-                    for (const auto &macro: macros)
-                        replaced = std::regex_replace(replaced,
-                                                      std::regex(macro.first,std::regex_constants::icase),
-                                                      macro.second);
+                    Tokens_ replaced;
+                    Expand(Tokenize(event.second), macros, &replaced);
+
+                    // Bind `PeriodBegin` and `PeriodEnd` as parameters of the statement, filled for each period
+                    Vector_<Placeholder_> placeholders;
+                    for (size_t i = 0; i < replaced.size(); ++i) {
+                        if (replaced[i] == "PeriodBegin")
+                            placeholders.push_back(Placeholder_{i, true});
+                        else if (replaced[i] == "PeriodEnd")
+                            placeholders.push_back(Placeholder_{i, false});
+                    }
 
                     for (const auto& s: schedule) {
-                        auto startDate = std::get<0>(s);
-                        auto endDate = std::get<1>(s);
-                        auto fixDate = std::get<2>(s);
-                        // Replace placeholder of `PeriodBegin` and `PeriodEnd`
-                        auto final_statement = std::regex_replace(replaced,
-                                                                  std::regex("PeriodBegin", std::regex_constants::icase),
-                                                                  Date::ToString(startDate));
-                        final_statement = std::regex_replace(final_statement,
-                                                             std::regex("PeriodEnd", std::regex_constants::icase),
-                                                             Date::ToString(endDate));
-
-                        if (processedEvents.find(fixDate) != processedEvents.end())
-                            processedEvents[fixDate] += "\n" + final_statement;
-                        else
-                            processedEvents[fixDate] = final_statement;
+                        const auto begin = Tokenize(Date::ToString(std::get<0>(s)));
+                        const auto end = Tokenize(Date::ToString(std::get<1>(s)));
+                        auto& dst = processedEvents[std::get<2>(s)];
+                        size_t from = 0;
+                        for (const auto& p : placeholders) {
+                            dst.Append(replaced.begin() + from, replaced.begin() + p.pos_);
+                            Append(&dst, p.begin_ ? begin : end);
+                            from = p.pos_ + 1;
+                        }
+                        dst.Append(replaced.begin() + from, replaced.end());
                     }
                 } else {
                     REQUIRE2(macros.find(desc) == macros.end(), "macro name has already registered", ScriptError_);
                     REQUIRE2(constVariables.find(desc) == constVariables.end(), "const macro name has already registered", ScriptError_);
                     REQUIRE2(processedEvents.empty(), "macros should always at the front", ScriptError_);
+                    const auto name = Tokenize(desc);
+                    REQUIRE2(name.size() == 1 && name[0] == desc, "macro name should be a single word", ScriptError_);
 
                     if (String::IsNumber(event.second))
                         constVariables[desc] = String::ToDouble(event.second);
                     else
-                        macros[desc] = event.second;
+                        Expand(Tokenize(event.second), macros, &macros[desc]);
                 }
             } else if (Cell::IsDate(cell)) {
-                String_ replaced = event.second;
-                for (const auto &macro: macros)
-                    replaced = std::regex_replace(replaced, std::regex(macro.first, std::regex_constants::icase),
-                                                  macro.second);
-                auto d = Cell::ToDate(cell);
-                if (processedEvents.find(d) != processedEvents.end())
-                    processedEvents[d] += "\n" + replaced;
-                else
-                    processedEvents[d] = replaced;
+                Expand(Tokenize(event.second), macros, &processedEvents[Cell::ToDate(cell)]);
             }
         }
 
@@ -137,6 +157,7 @@ namespace Dal::Script {
         variableValues_ = PastEvaluate();
 
         size_t maxNestedIfs = 0;
+        fuzzy_ = fuzzy;
         if (fuzzy || !skip_domain) {
             maxNestedIfs = IFProcess();
             DomainProcess(fuzzy);
@@ -158,6 +179,104 @@ namespace Dal::Script {
         return maxNestedIfs;
     }
 
+    namespace {
+        //  a node records at most one tape node, of at most 4 arguments (the blend dt * x + (1 - dt) * y of a fuzzy if has the most),
+        //  and a fuzzy if one blend per affected variable
+        void AddTapeSize(const Node_& node, AAD::TapeSize_* size) {
+            size_t n = 1;
+            if (auto pIf = dynamic_cast<const NodeIf_*>(&node))
+                n += pIf->affectedVars_.size();
+            size->nodes_ += n;
+            size->derivatives_ += 4 * n;
+            for (const auto& arg : node.arguments_)
+                AddTapeSize(*arg, size);
+        }
+    } // namespace
+
+    AAD::TapeSize_ ScriptProduct_::PathTapeSize() const {
+        AAD::TapeSize_ retval;
+        for (const auto& evt : events_)
+            for (const auto& stat : evt)
+                AddTapeSize(*stat, &retval);
+        return retval;
+    }
+
+    namespace {
+        //  Renumbers the variables of a tree, and the variables affected by its ifs, dropping the ones removed
+        void RenumberVariables(Node_& node, const Vector_<int>& newIdx) {
+            if (auto pVar = dynamic_cast<NodeVar_*>(&node))
+                pVar->index_ = newIdx[pVar->index_];
+            else if (auto pIf = dynamic_cast<NodeIf_*>(&node)) {
+                Vector_<size_t> affected;
+                for (auto idx : pIf->affectedVars_)
+                    if (newIdx[idx] >= 0)
+                        affected.push_back(static_cast<size_t>(newIdx[idx]));
+                pIf->affectedVars_ = affected;
+            }
+            for (auto& arg : node.arguments_)
+                RenumberVariables(*arg, newIdx);
+        }
+
+        void CollectVariables(const Node_& node, Vector_<bool>* used) {
+            if (auto pVar = dynamic_cast<const NodeVar_*>(&node))
+                (*used)[pVar->index_] = true;
+            for (const auto& arg : node.arguments_)
+                CollectVariables(*arg, used);
+        }
+    } // namespace
+
+    size_t ScriptProduct_::EliminateDeadCode(const Vector_<String_>& reported) {
+        REQUIRE(payoffIdx_ < variables_.size(), "product must be preprocessed before dead code elimination");
+        REQUIRE(!IsCompiled(), "dead code must be eliminated before compilation");
+
+        //  The payoff and the reported variables are live at the end of the script
+        std::set<size_t> roots = {payoffIdx_};
+        for (const auto& v : reported) {
+            auto pv = std::find(variables_.begin(), variables_.end(), v);
+            REQUIRE(pv != variables_.end(), "unknown variable " + v);
+            roots.insert(static_cast<size_t>(pv - variables_.begin()));
+        }
+
+        //  Sweep backward, future events then past events
+        LivenessProcessor_ proc(roots);
+        for (auto evt = events_.rbegin(); evt != events_.rend(); ++evt)
+            proc.ProcessEvent(*evt);
+        for (auto evt = pastEvents_.rbegin(); evt != pastEvents_.rend(); ++evt)
+            proc.ProcessEvent(*evt);
+
+        //  Keep the variables still referenced, in their original order
+        Vector_<bool> used(variables_.size(), false);
+        for (auto idx : roots)
+            used[idx] = true;
+        for (const auto* evts : {&pastEvents_, &events_})
+            for (const auto& evt : *evts)
+                for (const auto& stat : evt)
+                    CollectVariables(*stat, &used);
+        Vector_<int> newIdx(variables_.size(), -1);
+        Vector_<String_> variables;
+        Vector_<> variableValues;
+        for (size_t i = 0; i < variables_.size(); ++i) {
+            if (!used[i]) {
+                deadVariables_.push_back(variables_[i]);
+                continue;
+            }
+            newIdx[i] = static_cast<int>(variables.size());
+            variables.push_back(variables_[i]);
+            if (i < variableValues_.size())
+                variableValues.push_back(variableValues_[i]);
+        }
+
+        for (auto* evts : {&pastEvents_, &events_})
+            for (auto& evt : *evts)
+                for (auto& stat : evt)
+                    RenumberVariables(*stat, newIdx);
+        payoffIdx_ = newIdx[payoffIdx_];
+        variables_ = variables;
+        variableValues_ = variableValues;
+        deadStatements_.Append(proc.Removed());
+        return proc.Removed().size();
+    }
+
     //	Debug whole product
     void ScriptProduct_::Debug(std::ostream& ost) const {
         size_t v = 0;
@@ -176,16 +295,25 @@ namespace Dal::Script {
                 ost << d.String() << std::endl;
             }
         }
+
+        for (const auto& variable : deadVariables_)
+            ost << "Removed variable: " << variable << std::endl;
+        for (const auto& stat : deadStatements_)
+            ost << "Removed statement:" << std::endl << stat << std::endl;
     }
 
-    void ScriptProduct_::Compile() {
+    void ScriptProduct_::Compile(bool fuzzy, bool registers) {
+        REQUIRE(!fuzzy || fuzzy_, "fuzzy compilation requires a product preprocessed in fuzzy mode");
         //  First, identify constants
         ConstProcess();
+        compiledFuzzy_ = fuzzy;
+        generated_ = nullptr;
 
         //  Clear
         nodeStreams_.clear();
         constStreams_.clear();
         dataStreams_.clear();
+        regPrograms_.clear();
 
         //  One per event date
         nodeStreams_.reserve(events_.size());
@@ -195,7 +323,7 @@ namespace Dal::Script {
         //	Visit
         for (auto& evt : events_) {
             //	The compiler
-            Compiler_ comp;
+            Compiler_ comp(fuzzy);
 
             //	Loop over statements in event
             for (auto& stat : evt)
@@ -205,13 +333,159 @@ namespace Dal::Script {
             nodeStreams_.push_back(comp.NodeStream());
             constStreams_.push_back(comp.ConstStream());
             dataStreams_.push_back(comp.DataStream());
+            if (registers)
+                regPrograms_.push_back(ToRegisters(comp.NodeStream(), comp.ConstStream()));
         }
     }
 
 
+    namespace {
+        //  One function per event, the fingerprinted part of the generated source
+        String_ GeneratedEvents(const Vector_<Event_>& events) {
+            String_ retval;
+            for (size_t i = 0; i < events.size(); ++i) {
+                CodeGenerator_ gen("            ");
+                for (const auto& stat : events[i])
+                    stat->Accept(gen);
+                retval += "        template <class T_> void Event" + String_(std::to_string(i)) +
+                          "([[maybe_unused]] const AAD::Sample_<T_>& s, EvalState_<T_>& state) {\n"
+                          "            [[maybe_unused]] auto& v = state.variables_;\n" +
+                          gen.Code() + "        }\n\n";
+            }
+            return retval;
+        }
+
+        String_ EventPointers(size_t n, const String_& type) {
+            String_ retval("{");
+            for (size_t i = 0; i < n; ++i)
+                retval += String_(i ? ", " : "") + "&Event" + String_(std::to_string(i)) + "<" + type + ">";
+            return retval + "}";
+        }
+    } // namespace
+
+    String_ ScriptProduct_::GenerateCpp(const String_& name) const {
+        REQUIRE(IsCompiled() && !compiledFuzzy_, "code is generated from a product compiled in non-fuzzy mode");
+        REQUIRE(!name.empty() && name.find_first_of("\"\\\n") == String_::npos, "invalid name for generated product");
+        const String_ events = GeneratedEvents(events_);
+        char fingerprint[32];
+        std::snprintf(fingerprint, sizeof(fingerprint), "0x%016llxULL", static_cast<unsigned long long>(Generated::Fingerprint(events)));
+
+        String_ retval;
+        retval += "//\n//  Generated from script product " + name + ", do not edit\n//\n\n";
+        retval += "#include <dal/platform/platform.hpp>\n#include <dal/script/generated.hpp>\n\n";
+        retval += "namespace Dal::Script::Generated {\n    namespace {\n";
+        retval += events;
+        retval += "        [[maybe_unused]] const bool registered_ = Register(GeneratedProduct_{\"" + name + "\",\n";
+        retval += "                                                                  " + String_(fingerprint) + ",\n";
+        retval += "                                                                  " + EventPointers(events_.size(), "double") + ",\n";
+        retval += "                                                                  " + EventPointers(events_.size(), "AAD::Number_") + "});\n";
+        retval += "    } // namespace\n} // namespace Dal::Script::Generated\n";
+        return retval;
+    }
+
+    bool ScriptProduct_::BindGenerated(const String_& name) {
+        REQUIRE(IsCompiled(), "product must be compiled before binding generated code");
+        generated_ = nullptr;
+        const GeneratedProduct_* generated = Generated::Find(name);
+        if (!generated || compiledFuzzy_ || generated->doubleEvents_.size() != events_.size())
+            return false;
+        if (generated->fingerprint_ != Generated::Fingerprint(GeneratedEvents(events_)))
+            return false;
+        generated_ = generated;
+        return true;
+    }
+
 #include <dal/auto/MG_ScriptProductData_v1_Read.inc>
 #include <dal/auto/MG_ScriptProductData_v1_Write.inc>
 
+    namespace {
+        //  Products preprocessed from script product data
+        //  keyed by content hash, evaluation date, fuzzy, skip_domain and compiled flags, the event table resolves hash collisions
+        struct PreProcessed_ {
+            Vector_<Cell_> eventDates_;
+            Vector_<String_> eventDesc_;
+            //  Name of the generated code the product is bound to, if any
+            String_ generated_;
+            std::shared_ptr<const ScriptProduct_> product_;
+            size_t maxNestedIfs_;
+        };
+        using PreProcessedKey_ = std::tuple<std::uint64_t, Date_, bool, bool, bool>;
+
+        //  Past that size the cache starts again from empty
+        constexpr size_t MAX_PREPROCESSED = 4096;
+
+        std::multimap<PreProcessedKey_, PreProcessed_>& ThePreProcessed() { RETURN_STATIC(std::multimap<PreProcessedKey_, PreProcessed_>); }
+        std::mutex& ThePreProcessedMutex() { RETURN_STATIC(std::mutex); }
+
+        const PreProcessed_* FindPreProcessed(const PreProcessedKey_& key,
+                                              const Vector_<Cell_>& dates,
+                                              const Vector_<String_>& events,
+                                              const String_& generated) {
+            auto range = ThePreProcessed().equal_range(key);
+            for (auto it = range.first; it != range.second; ++it)
+                if (it->second.generated_ == generated && it->second.eventDesc_ == events &&
+                    std::equal(dates.begin(), dates.end(), it->second.eventDates_.begin(), it->second.eventDates_.end()))
+                    return &it->second;
+            return nullptr;
+        }
+    } // namespace
+
+    ScriptProductData_::ScriptProductData_(const String_& name, const Vector_<Cell_>& dates, const Vector_<String_>& events)
+        : Storable_("ScriptProduct", name), eventDates_(dates), eventDesc_(events) {
+        String_ content;
+        for (const auto& date : eventDates_)
+            content += Cell::ToString(date) + '\n';
+        for (const auto& event : eventDesc_)
+            content += event + '\n';
+        contentHash_ = Generated::Fingerprint(content);
+    }
+
+    std::shared_ptr<const ScriptProduct_> ScriptProductData_::PreProcessed(bool fuzzy, bool skip_domain, bool compiled, size_t* max_nested_ifs) const {
+        const auto key = std::make_tuple(contentHash_, Global::Dates_::EvaluationDate(), fuzzy, skip_domain, compiled);
+        //  hot products may have been generated as C++ under the name of their data
+        const String_ generated = compiled && !fuzzy && Generated::Find(name_) ? name_ : String_();
+        {
+            std::lock_guard<std::mutex> lock(ThePreProcessedMutex());
+            if (const auto* found = FindPreProcessed(key, eventDates_, eventDesc_, generated)) {
+                if (max_nested_ifs)
+                    *max_nested_ifs = found->maxNestedIfs_;
+                return found->product_;
+            }
+        }
+
+        //  built out of the lock, another thread building the same product concurrently is harmless
+        auto product = std::make_shared<ScriptProduct_>(eventDates_, eventDesc_, "");
+        const size_t maxNestedIfs = product->PreProcess(fuzzy, skip_domain);
+        if (compiled) {
+            //  only the payoff is read from shared products
+            product->EliminateDeadCode();
+            product->Compile(fuzzy);
+            if (!generated.empty())
+                product->BindGenerated(generated);
+        }
+
+        std::lock_guard<std::mutex> lock(ThePreProcessedMutex());
+        const auto* found = FindPreProcessed(key, eventDates_, eventDesc_, generated);
+        if (!found) {
+            if (ThePreProcessed().size() >= MAX_PREPROCESSED)
+                ThePreProcessed().clear();
+            found = &ThePreProcessed().emplace(key, PreProcessed_{eventDates_, eventDesc_, generated, product, maxNestedIfs})->second;
+        }
+        if (max_nested_ifs)
+            *max_nested_ifs = found->maxNestedIfs_;
+        return found->product_;
+    }
+
+    void ClearPreProcessedProducts() {
+        std::lock_guard<std::mutex> lock(ThePreProcessedMutex());
+        ThePreProcessed().clear();
+    }
+
+    size_t NumPreProcessedProducts() {
+        std::lock_guard<std::mutex> lock(ThePreProcessedMutex());
+        return ThePreProcessed().size();
+    }
+
     void ScriptProductData_::Write(Archive::Store_& dst) const {
         ScriptProductData_v1::XWrite(dst, name_, eventDates_, eventDesc_);
     }
@@ -4,10 +4,15 @@
 
 #pragma once
 
+#include <map>
+#include <memory>
+#include <mutex>
 #include <regex>
+#include <tuple>
 #include <utility>
 #include <dal/math/aad/sample.hpp>
 #include <dal/math/vectors.hpp>
+#include <dal/script/generated.hpp>
 #include <dal/script/node.hpp>
 #include <dal/script/visitor/all.hpp>
 #include <dal/storage/archive.hpp>
@@ -45,10 +50,35 @@ namespace Dal::Script {
         Vector_<> timeLine_;
         Vector_<AAD::SampleDef_> defLine_;
 
+        //  Preprocessed with fuzzy domain information
+        bool fuzzy_ = false;
+
+        //  Removed by dead code elimination, the statements in debugger form
+        Vector_<String_> deadVariables_;
+        Vector_<String_> deadStatements_;
+
         //  Compiled form
         Vector_<Vector_<int>> nodeStreams_;
         Vector_<Vector_<>> constStreams_;
         Vector_<Vector_<const void*>> dataStreams_;
+        bool compiledFuzzy_ = false;
+        //  Register form of each event, invalid where the stack stream is evaluated
+        Vector_<RegProgram_> regPrograms_;
+        //  Generated C++ bound to the compiled form, evaluated in its place for double and Number_
+        const GeneratedProduct_* generated_ = nullptr;
+
+        template <class T_> void EvaluateCompiledEvent(size_t i, const AAD::Sample_<T_>& sample, EvalState_<T_>& state) const {
+            if constexpr (IsGeneratedType_<T_>) {
+                if (generated_) {
+                    generated_->Events<T_>()[i](sample, state);
+                    return;
+                }
+            }
+            if (i < regPrograms_.size() && regPrograms_[i].IsValid())
+                EvalRegisters(regPrograms_[i], sample, state);
+            else
+                EvalCompiled(nodeStreams_[i], constStreams_[i], dataStreams_[i], sample, state);
+        }
 
     public:
         ScriptProduct_(const Vector_<Cell_>& dates, const Vector_<String_>& events, String_ payoff = "")
@@ -85,6 +115,10 @@ namespace Dal::Script {
                                   Apply([](double x) {return T_(x);}, consVariablesValues_));
         }
 
+        [[nodiscard]] BatchEvalState_ BuildBatchEvalState(size_t width) const {
+            return BatchEvalState_(variableValues_, width);
+        }
+
         template <class T_> std::unique_ptr<Scenario_<T_>> BuildScenario() const {
             return std::unique_ptr<Scenario_<T_>>(new Scenario_<T_>(eventDates_.size()));
         }
@@ -133,11 +167,26 @@ namespace Dal::Script {
             // Loop over events
             for (size_t i = 0; i < events_.size(); ++i)
                 // Evaluate the compiled events
-                EvalCompiled(nodeStreams_[i],
-                             constStreams_[i],
-                             dataStreams_[i],
-                             scenario[i],
-                             state);
+                EvaluateCompiledEvent(i, scenario[i], state);
+        }
+
+        //  Same on a scenario shared with other products, indices give the position of each event on it
+        template <class T_> void EvaluateCompiled(const Scenario_<T_>& scenario, const Vector_<size_t>& indices, EvalState_<T_>& state) const {
+            state.Init();
+            for (size_t i = 0; i < events_.size(); ++i)
+                EvaluateCompiledEvent(i, scenario[indices[i]], state);
+        }
+
+        void EvaluateCompiledBatch(const AAD::BatchScenario_& scenario, BatchEvalState_& state) const {
+            // Initialize state
+            state.Init();
+
+            // Loop over events
+            for (size_t i = 0; i < events_.size(); ++i)
+                EvalCompiledBatch(nodeStreams_[i],
+                                  constStreams_[i],
+                                  scenario[i],
+                                  state);
         }
 
         void IndexVariables();
@@ -148,20 +197,48 @@ namespace Dal::Script {
         void ConstCondProcess();
 
         size_t PreProcess(bool fuzzy, bool skip_domain);
+        //  Removes the statements whose result never reaches the payoff or a reported variable, and the variables left unused
+        //  to run after preprocessing and before compilation, what was removed is listed by Debug()
+        //  returns the number of statements removed
+        size_t EliminateDeadCode(const Vector_<String_>& reported = Vector_<String_>());
         void Debug(std::ostream& ost = std::cout) const;
-        void Compile();
+        //  fuzzy compilation smooths the conditions like FuzzyEvaluator_, the product must be preprocessed in fuzzy mode
+        //  registers adds the register form of the events, evaluated in place of the stack streams where it exists
+        void Compile(bool fuzzy = false, bool registers = true);
+
+        //  C++ source of the compiled (non-fuzzy) form: a T_ templated function per event, registered under name when loaded
+        [[nodiscard]] String_ GenerateCpp(const String_& name) const;
+        //  Evaluates the compiled form with the generated code registered under name, if it was generated from the same script
+        //  returns false, and keeps the interpreted compiled form, otherwise
+        bool BindGenerated(const String_& name);
+        [[nodiscard]] bool IsGenerated() const { return generated_ != nullptr; }
+
+        //  Upper bound of what the evaluation of a path records on the tape, whichever branches it takes
+        [[nodiscard]] AAD::TapeSize_ PathTapeSize() const;
 
         [[nodiscard]] auto PayOffIdx() const { return payoffIdx_; }
+        [[nodiscard]] bool IsCompiled() const { return !events_.empty() && nodeStreams_.size() == events_.size(); }
+        [[nodiscard]] bool IsCompiledFuzzy() const { return IsCompiled() && compiledFuzzy_; }
     };
 
     class ScriptProductData_ : public Storable_ {
         Vector_<Cell_> eventDates_;
         Vector_<String_> eventDesc_;
+        //  Fingerprint of the event table, keys the process-wide cache of preprocessed products
+        std::uint64_t contentHash_;
 
     public:
-        ScriptProductData_(const String_& name, const Vector_<Cell_>& dates, const Vector_<String_>& events)
-            : Storable_("ScriptProduct", name), eventDates_(dates), eventDesc_(events) {}
+        ScriptProductData_(const String_& name, const Vector_<Cell_>& dates, const Vector_<String_>& events);
         void Write(Archive::Store_& dst) const override;
         [[nodiscard]] ScriptProduct_ Product() const { return {eventDates_, eventDesc_, ""}; }
+
+        //  Product preprocessed at the global evaluation date, and compiled if requested
+        //  built on first request then shared, across threads, by every data with the same event table
+        //  compiled products have their dead code eliminated first, code generated for them must come from such a product
+        std::shared_ptr<const ScriptProduct_> PreProcessed(bool fuzzy, bool skip_domain, bool compiled, size_t* max_nested_ifs = nullptr) const;
     };
+
+    //  Drops the preprocessed products shared by script product data, the ones handed out stay valid
+    void ClearPreProcessedProducts();
+    [[nodiscard]] size_t NumPreProcessedProducts();
 } // namespace Dal::Script
@@ -0,0 +1,37 @@
+//
+// Created by wegam on 2024/11/18.
+//
+
+#include <map>
+#include <mutex>
+#include <dal/platform/platform.hpp>
+#include <dal/platform/strict.hpp>
+#include <dal/script/generated.hpp>
+
+namespace Dal::Script::Generated {
+    namespace {
+        std::map<String_, GeneratedProduct_>& TheGeneratedProducts() { RETURN_STATIC(std::map<String_, GeneratedProduct_>); }
+        std::mutex& TheGeneratedMutex() { RETURN_STATIC(std::mutex); }
+    } // namespace
+
+    bool Register(GeneratedProduct_ product) {
+        std::lock_guard<std::mutex> l(TheGeneratedMutex());
+        const String_ name = product.name_;
+        return TheGeneratedProducts().emplace(name, std::move(product)).second;
+    }
+
+    const GeneratedProduct_* Find(const String_& name) {
+        std::lock_guard<std::mutex> l(TheGeneratedMutex());
+        auto it = TheGeneratedProducts().find(name);
+        return it == TheGeneratedProducts().end() ? nullptr : &it->second;
+    }
+
+    std::uint64_t Fingerprint(const String_& code) {
+        std::uint64_t retval = 14695981039346656037ULL;
+        for (const char c : code) {
+            retval ^= static_cast<unsigned char>(c);
+            retval *= 1099511628211ULL;
+        }
+        return retval;
+    }
+} // namespace Dal::Script::Generated
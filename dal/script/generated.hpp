@@ -0,0 +1,59 @@
+//
+// Created by wegam on 2024/11/18.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+#include <dal/math/aad/aad.hpp>
+#include <dal/math/aad/sample.hpp>
+#include <dal/math/vectors.hpp>
+#include <dal/platform/platform.hpp>
+#include <dal/script/visitor/all.hpp>
+
+namespace Dal::Script {
+    //  Evaluation of one event by C++ generated from a script and compiled with the application
+    template <class T_> using GeneratedEvent_ = void (*)(const AAD::Sample_<T_>&, EvalState_<T_>&);
+
+    //  Number types the generated products are instantiated on
+    template <class T_> inline constexpr bool IsGeneratedType_ = std::is_same_v<T_, double> || std::is_same_v<T_, AAD::Number_>;
+
+    struct GeneratedProduct_ {
+        String_ name_;
+        //  Fingerprint of the generated code, a product binds it only if it generates the same code
+        std::uint64_t fingerprint_;
+        Vector_<GeneratedEvent_<double>> doubleEvents_;
+        Vector_<GeneratedEvent_<AAD::Number_>> numberEvents_;
+
+        template <class T_> [[nodiscard]] const Vector_<GeneratedEvent_<T_>>& Events() const {
+            static_assert(IsGeneratedType_<T_>, "generated products are only instantiated on double and Number_");
+            if constexpr (std::is_same_v<T_, double>)
+                return doubleEvents_;
+            else
+                return numberEvents_;
+        }
+    };
+
+    namespace Generated {
+        //  Called at load time by the generated sources, returns false if the name is already taken
+        bool Register(GeneratedProduct_ product);
+        [[nodiscard]] const GeneratedProduct_* Find(const String_& name);
+
+        //  64 bits FNV-1a, the same on every platform
+        [[nodiscard]] std::uint64_t Fingerprint(const String_& code);
+
+        //  Max and min select one of their arguments, like the compiled stream
+        template <class T_, class L_, class R_> FORCE_INLINE T_ Max2(const L_& lhs, const R_& rhs) {
+            const T_ l(lhs);
+            const T_ r(rhs);
+            return r > l ? r : l;
+        }
+
+        template <class T_, class L_, class R_> FORCE_INLINE T_ Min2(const L_& lhs, const R_& rhs) {
+            const T_ l(lhs);
+            const T_ r(rhs);
+            return r < l ? r : l;
+        }
+    } // namespace Generated
+} // namespace Dal::Script
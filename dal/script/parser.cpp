@@ -364,8 +364,11 @@ namespace Dal::Script {
     }
 
     Event_ Parser_::Parse(const String_& event) {
+        return Parse(Tokenize(event));
+    }
+
+    Event_ Parser_::Parse(const Vector_<String_>& tokens) {
         Event_ e;
-        auto tokens = Tokenize(event);
         Vector_<String_>::const_iterator it = tokens.begin();
         while (it != tokens.end())
             e.push_back(ParseStatement(it, tokens.end()));
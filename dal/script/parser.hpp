@@ -96,6 +96,8 @@ namespace Dal::Script {
         explicit Parser_(const std::map<String_, double>& const_variables = std::map<String_, double>()): constVariables_(const_variables) {}
         Statement_ ParseStatement(TokIt_& cur, const TokIt_& end);
         Event_ Parse(const String_& event);
+        //  Statements already tokenized, e.g. after macro expansion
+        Event_ Parse(const Vector_<String_>& tokens);
     };
 
     Vector_<String_> Tokenize(const String_& str);
@@ -0,0 +1,59 @@
+//
+// Created by wegam on 2024/10/20.
+//
+
+#include <dal/platform/platform.hpp>
+#include <dal/platform/strict.hpp>
+#include <dal/script/portfolio.hpp>
+
+namespace Dal::Script {
+
+    namespace {
+        template <class T_> void AppendUnique(Vector_<T_>* dst, const T_& val) {
+            if (std::find(dst->begin(), dst->end(), val) == dst->end())
+                dst->push_back(val);
+        }
+
+        void MergeSampleDef(AAD::SampleDef_* dst, const AAD::SampleDef_& src) {
+            dst->numeraire_ = dst->numeraire_ || src.numeraire_;
+            for (const auto& mat : src.discountMats_)
+                AppendUnique(&dst->discountMats_, mat);
+            for (const auto& mats : src.forwardMats_)
+                AppendUnique(&dst->forwardMats_, mats);
+            for (const auto& def : src.liborDefs_) {
+                auto same = [&def](const AAD::SampleDef_::RateDef_& d) {
+                    return d.start_ == def.start_ && d.end_ == def.end_ && d.curve_ == def.curve_;
+                };
+                if (std::find_if(dst->liborDefs_.begin(), dst->liborDefs_.end(), same) == dst->liborDefs_.end())
+                    dst->liborDefs_.push_back(def);
+            }
+        }
+    } // namespace
+
+    PortfolioTimeLine_ MergeTimeLines(const Vector_<const ScriptProduct_*>& products) {
+        REQUIRE(!products.empty(), "portfolio should have at least one product");
+        PortfolioTimeLine_ retval;
+        for (const auto& p : products) {
+            REQUIRE(p->TimeLine().size() == p->DefLine().size(), "product time line and definition line do not match");
+            for (const auto& t : p->TimeLine())
+                AppendUnique(&retval.timeLine_, t);
+        }
+        std::sort(retval.timeLine_.begin(), retval.timeLine_.end());
+
+        retval.defLine_.Resize(retval.timeLine_.size());
+        for (auto& def : retval.defLine_)
+            def.numeraire_ = false;
+
+        for (const auto& p : products) {
+            Vector_<size_t> indices;
+            for (size_t i = 0; i < p->TimeLine().size(); ++i) {
+                const auto pos = std::lower_bound(retval.timeLine_.begin(), retval.timeLine_.end(), p->TimeLine()[i]);
+                const auto idx = static_cast<size_t>(pos - retval.timeLine_.begin());
+                MergeSampleDef(&retval.defLine_[idx], p->DefLine()[i]);
+                indices.push_back(idx);
+            }
+            retval.indices_.push_back(indices);
+        }
+        return retval;
+    }
+} // namespace Dal::Script
@@ -0,0 +1,303 @@
+//
+// Created by wegam on 2024/10/20.
+//
+
+#pragma once
+
+#include <dal/script/simulation.hpp>
+
+namespace Dal::Script {
+
+    //  Time line and sample definitions covering the event dates of several products
+    struct PortfolioTimeLine_ {
+        Vector_<> timeLine_;
+        Vector_<AAD::SampleDef_> defLine_;
+        //  for each product, position of each of its event dates on the merged time line
+        Vector_<Vector_<size_t>> indices_;
+    };
+
+    PortfolioTimeLine_ MergeTimeLines(const Vector_<const ScriptProduct_*>& products);
+
+    struct PortfolioResults_ {
+        //  whole portfolio, with the model parameter risks in AAD mode
+        SimResults_ total_;
+        //  one per product, with its constant variable risks in AAD mode
+        Vector_<SimResults_> products_;
+
+        PortfolioResults_(const Vector_<String_>& names, const Vector_<const ScriptProduct_*>& products) : total_(names) {
+            for (const auto& p : products)
+                products_.emplace_back(p->ConstVarNames());
+        }
+    };
+
+    //  Prices several compiled products on the same set of paths: the model is built once and each path is generated once
+    //  risk_group_size groups the adjoint propagations in AAD mode, as in MCSimulation
+    template <class T_>
+    PortfolioResults_ MCPortfolioSimulation(const Vector_<const ScriptProduct_*>& products,
+                                            const Handle_<ModelData_>& model_data,
+                                            size_t n_paths,
+                                            const String_& rsg = "sobol",
+                                            bool use_bb = false,
+                                            size_t risk_group_size = 0) {
+        THROW("not implemented");
+    }
+
+    template <>
+    inline PortfolioResults_ MCPortfolioSimulation<double>(const Vector_<const ScriptProduct_*>& products,
+                                                           const Handle_<ModelData_>& model_data,
+                                                           size_t n_paths,
+                                                           const String_& rsg,
+                                                           bool use_bb,
+                                                           size_t risk_group_size) {
+        for (const auto& p : products)
+            REQUIRE(p->IsCompiled(), "products should be compiled for portfolio simulation");
+        const size_t nProducts = products.size();
+        const PortfolioTimeLine_ merged = MergeTimeLines(products);
+
+        std::unique_ptr<AAD::Model_<double>> mdl = CreateModel<double>(model_data);
+        mdl->Allocate(merged.timeLine_, merged.defLine_);
+        mdl->Init(merged.timeLine_, merged.defLine_);
+
+        ThreadPool_* pool = ThreadPool_::GetInstance();
+        const size_t nThreads = pool->NumThreads();
+
+        Vector_<std::unique_ptr<Random_>> rngVector(nThreads);
+        for (auto& random : rngVector)
+            random = CreateRNG(rsg, mdl->SimDim(), use_bb);
+
+        Vector_<Vector_<>> gaussVectors(nThreads, Vector_<>(mdl->SimDim()));
+        Vector_<Scenario_<>> paths(nThreads);
+        for (auto& path : paths) {
+            AllocatePath(merged.defLine_, path);
+            InitializePath(path);
+        }
+
+        Vector_<Vector_<EvalState_<double>>> evalStateVector(nThreads);
+        for (auto& states : evalStateVector)
+            for (const auto& p : products)
+                states.push_back(p->BuildEvalState<double>());
+
+        Vector_<TaskHandle_> futures;
+        const int batch_size = BATCH_SIZE;
+        futures.reserve(n_paths / batch_size + 1);
+        //  per task sums and sums of squares, by product and for the whole portfolio in last position
+        Vector_<Vector_<>> simResults;
+        simResults.reserve(n_paths / batch_size + 1);
+        Vector_<Vector_<>> simSquares;
+        simSquares.reserve(n_paths / batch_size + 1);
+
+        int firstPath = 0;
+        int pathsLeft = static_cast<int>(n_paths);
+        size_t loopIndex = 0;
+
+        while (pathsLeft > 0) {
+            auto pathsInTask = std::min(pathsLeft, batch_size);
+            simResults.emplace_back(nProducts + 1, 0.0);
+            simSquares.emplace_back(nProducts + 1, 0.0);
+            auto& simResult = simResults[loopIndex];
+            auto& simSquare = simSquares[loopIndex];
+            loopIndex += 1;
+            futures.push_back(pool->SpawnTask([&, firstPath, pathsInTask]() {
+                const size_t threadNum = ThreadPool_::ThreadNum();
+                Vector_<>& gaussVec = gaussVectors[threadNum];
+                Scenario_<>& path = paths[threadNum];
+                Vector_<EvalState_<double>>& evalStates = evalStateVector[threadNum];
+                auto& random = rngVector[threadNum];
+                random->SkipTo(firstPath);
+                for (size_t i = 0; i < pathsInTask; ++i) {
+                    random->FillNormal(&gaussVec);
+                    mdl->GeneratePath(gaussVec, &path);
+                    double total = 0.0;
+                    for (size_t p = 0; p < nProducts; ++p) {
+                        products[p]->EvaluateCompiled(path, merged.indices_[p], evalStates[p]);
+                        const double payoff = evalStates[p].VarVals()[products[p]->PayOffIdx()];
+                        simResult[p] += payoff;
+                        simSquare[p] += payoff * payoff;
+                        total += payoff;
+                    }
+                    simResult[nProducts] += total;
+                    simSquare[nProducts] += total * total;
+                }
+                return true;
+            }));
+            pathsLeft -= pathsInTask;
+            firstPath += pathsInTask;
+        }
+
+        for (auto& future : futures)
+            pool->ActiveWait(future);
+        //  the first error of the tasks is rethrown once none of them is left running on this frame
+        for (auto& future : futures)
+            future.get();
+
+        PortfolioResults_ results(mdl->ParameterLabels(), products);
+        for (size_t t = 0; t < simResults.size(); ++t) {
+            for (size_t p = 0; p < nProducts; ++p) {
+                results.products_[p].aggregated_ += simResults[t][p];
+                results.products_[p].squared_ += simSquares[t][p];
+            }
+            results.total_.aggregated_ += simResults[t][nProducts];
+            results.total_.squared_ += simSquares[t][nProducts];
+        }
+        for (auto& r : results.products_)
+            r.nPaths_ = r.nSamples_ = r.nGroups_ = n_paths;
+        results.total_.nPaths_ = results.total_.nSamples_ = results.total_.nGroups_ = n_paths;
+        return results;
+    }
+
+    template <>
+    inline PortfolioResults_ MCPortfolioSimulation<AAD::Number_>(const Vector_<const ScriptProduct_*>& products,
+                                                                 const Handle_<ModelData_>& model_data,
+                                                                 size_t n_paths,
+                                                                 const String_& rsg,
+                                                                 bool use_bb,
+                                                                 size_t risk_group_size) {
+        for (const auto& p : products)
+            REQUIRE(p->IsCompiled(), "products should be compiled for portfolio simulation");
+        const size_t nProducts = products.size();
+        const PortfolioTimeLine_ merged = MergeTimeLines(products);
+
+        std::unique_ptr<AAD::Model_<Number_>> mdl = CreateModel<Number_>(model_data);
+        mdl->Allocate(merged.timeLine_, merged.defLine_);
+        const auto nParams = mdl->Parameters().size();
+        //  built here, so that an unknown generator or invalid options are reported to the caller, then cloned by each thread
+        const std::unique_ptr<Random_> rng = CreateRNG(rsg, mdl->SimDim(), use_bb);
+
+        ThreadPool_* pool = ThreadPool_::GetInstance();
+        const size_t nThreads = pool->NumThreads();
+
+        Vector_<TaskHandle_> futures;
+        const int batchSize = BATCH_SIZE;
+        //  per batch results, by product and for the whole portfolio in last position
+        Vector_<Vector_<BatchResults_>> simResults((n_paths + batchSize - 1) / batchSize);
+
+        int firstPath = 0;
+        int pathsLeft = static_cast<int>(n_paths);
+        size_t loopIndex = 0;
+        //  the tasks run by this thread while it waits record on its thread tape, the caller's tape is restored on exit
+        AAD::TapeScope_ callerTape(*AAD::ThreadTape());
+
+        //  per thread workspace, built and initialized by the first task running on each thread
+        Vector_<std::unique_ptr<AAD::Model_<AAD::Number_>>> models(nThreads);
+        Vector_<std::unique_ptr<Random_>> rngVector(nThreads);
+        Vector_<Vector_<>> gaussVectors(nThreads);
+        Vector_<Scenario_<AAD::Number_>> paths(nThreads);
+        Vector_<Vector_<EvalState_<AAD::Number_>>> evalStateVector(nThreads);
+
+        while (pathsLeft > 0) {
+            auto pathsInTask = std::min(pathsLeft, batchSize);
+            auto& results = simResults[loopIndex];
+            loopIndex += 1;
+            futures.push_back(pool->SpawnTask([&, firstPath, pathsInTask]() {
+                const size_t threadNum = ThreadPool_::ThreadNum();
+                Number_::SetTape(*AAD::ThreadTape());
+                auto& model = models[threadNum];
+                Scenario_<AAD::Number_>& path = paths[threadNum];
+                Vector_<EvalState_<AAD::Number_>>& evalStates = evalStateVector[threadNum];
+                if (!model) {
+                    //  model parameters, constant variables of all the products and model initialization are recorded once per thread, before the mark
+                    //  the workspace is built aside and only kept once complete, a throw leaves the next task to build it again
+                    Number_::Tape()->Rewind();
+                    std::unique_ptr<AAD::Model_<Number_>> newModel = mdl->Clone();
+                    newModel->Allocate(merged.timeLine_, merged.defLine_);
+                    std::unique_ptr<Random_> newRandom(rng->Clone());
+                    gaussVectors[threadNum].Resize(newModel->SimDim());
+                    AllocatePath(merged.defLine_, path);
+                    Vector_<EvalState_<AAD::Number_>> newEvalStates;
+                    for (const auto& p : products)
+                        newEvalStates.push_back(p->BuildEvalState<AAD::Number_>());
+
+                    for (Number_* param : newModel->Parameters())
+                        param->PutOnTape();
+                    for (auto& state : newEvalStates)
+                        for (Number_& param : state.ConstVarVals())
+                            param.PutOnTape();
+                    newModel->Init(merged.timeLine_, merged.defLine_);
+                    InitializePath(path);
+                    Number_::Tape()->Mark();
+                    //  room for the largest path, with the running sum of the payoffs
+                    AAD::TapeSize_ pathSize = newModel->PathTapeSize();
+                    for (const auto& p : products)
+                        pathSize += p->PathTapeSize();
+                    pathSize += AAD::TapeSize_{nProducts, 2 * nProducts};
+                    Number_::Tape()->ReserveAhead(pathSize);
+
+                    rngVector[threadNum] = std::move(newRandom);
+                    evalStates = std::move(newEvalStates);
+                    model = std::move(newModel);
+                }
+                auto& random = rngVector[threadNum];
+                Vector_<>& gVec = gaussVectors[threadNum];
+                random->SkipTo(firstPath);
+
+                for (size_t p = 0; p < nProducts; ++p)
+                    results.emplace_back(products[p]->ConstVarNames().size());
+                results.emplace_back(nParams);
+                BatchResults_& total = results[nProducts];
+                const size_t pathsPerGroup = risk_group_size > 0 ? risk_group_size : static_cast<size_t>(pathsInTask);
+                auto addGroup = [&](size_t groupSize) {
+                    Number_::PropagateMarkToStart();
+                    for (size_t j = 0; j < nParams; ++j) {
+                        const double risk = model->Parameters()[j]->Adjoint();
+                        total.risks_[j] += risk;
+                        total.risksSquared_[j] += risk * risk / static_cast<double>(groupSize);
+                    }
+                    ++total.nGroups_;
+                    for (size_t p = 0; p < nProducts; ++p) {
+                        BatchResults_& res = results[p];
+                        for (size_t j = 0; j < res.risks_.size(); ++j) {
+                            const double risk = evalStates[p].ConstVarVals()[j].Adjoint();
+                            res.risks_[j] += risk;
+                            res.risksSquared_[j] += risk * risk / static_cast<double>(groupSize);
+                        }
+                        ++res.nGroups_;
+                    }
+                    Number_::Tape()->ResetAdjointsToMark();
+                };
+
+                for (size_t i = 0; i < pathsInTask; i++) {
+                    Number_::Tape()->RewindToMark();
+                    random->FillNormal(&gVec);
+                    model->GeneratePath(gVec, &path);
+                    //  one reverse sweep for the whole portfolio: each product's constant variables only see its own payoff
+                    Number_ sum(0.0);
+                    for (size_t p = 0; p < nProducts; ++p) {
+                        products[p]->EvaluateCompiled(path, merged.indices_[p], evalStates[p]);
+                        const Number_& payoff = evalStates[p].VarVals()[products[p]->PayOffIdx()];
+                        results[p].sum_ += payoff.value();
+                        results[p].squared_ += payoff.value() * payoff.value();
+                        sum += payoff;
+                    }
+                    total.sum_ += sum.value();
+                    total.squared_ += sum.value() * sum.value();
+                    sum.PropagateToMark();
+                    if ((i + 1) % pathsPerGroup == 0 || i + 1 == pathsInTask)
+                        addGroup(i % pathsPerGroup + 1);
+                }
+                return true;
+            }));
+            pathsLeft -= pathsInTask;
+            firstPath += pathsInTask;
+        }
+
+        PortfolioResults_ rtn(mdl->ParameterLabels(), products);
+        for (size_t i = 0; i < futures.size(); ++i) {
+            pool->ActiveWait(futures[i]);
+            for (size_t p = 0; p < nProducts; ++p)
+                simResults[i][p].AddTo(&rtn.products_[p]);
+            simResults[i][nProducts].AddTo(&rtn.total_);
+            simResults[i].clear();
+        }
+        //  the first error of the tasks is rethrown once none of them is left running on this frame
+        for (auto& future : futures)
+            future.get();
+
+        for (auto& r : rtn.products_) {
+            r.Close(n_paths);
+            r.nSamples_ = n_paths;
+        }
+        rtn.total_.Close(n_paths);
+        rtn.total_.nSamples_ = n_paths;
+        return rtn;
+    }
+} // namespace Dal::Script
@@ -8,14 +8,15 @@
 
 namespace Dal::Script {
 
-    std::unique_ptr<Random_> CreateRNG(const String_& method, size_t n_dim, bool use_bb) {
+    std::unique_ptr<Random_> CreateRNG(const String_& method, size_t n_dim, bool use_bb, bool antithetic) {
         std::unique_ptr<Random_> rsg;
-        if (method == "sobol")
+        if (method == "sobol") {
+            REQUIRE(!antithetic, "antithetic sampling is only supported with pseudo random generators");
             rsg = std::unique_ptr<Random_>(NewSobol(static_cast<int>(n_dim), 2048));
-        else if (method == "mrg32")
-            rsg = std::unique_ptr<Random_>(New(RNGType_("MRG32"), 1024, n_dim));
+        } else if (method == "mrg32")
+            rsg = std::unique_ptr<Random_>(New(RNGType_("MRG32"), 1024, n_dim, false, antithetic));
         else if (method == "irn")
-            rsg = std::unique_ptr<Random_>(New(RNGType_("IRN"), 1024, n_dim));
+            rsg = std::unique_ptr<Random_>(New(RNGType_("IRN"), 1024, n_dim, false, antithetic));
         else
             THROW("rng method is not known");
 
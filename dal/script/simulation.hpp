@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <dal/script/control.hpp>
 #include <dal/script/event.hpp>
 #include <dal/model/base.hpp>
 #include <dal/math/random/brownianbridge.hpp>
@@ -12,34 +13,165 @@
 #include <dal/utilities/dictionary.hpp>
 #include <dal/concurrency/threadpool.hpp>
 #include <dal/math/aad/aad.hpp>
+#include <dal/math/aad/checkpoint.hpp>
 #include <dal/model/factory.hpp>
 #include <dal/utilities/numerics.hpp>
+#include <dal/utilities/timer.hpp>
 
 
 namespace Dal::Script {
 
+    //  Standard error of the mean of n_paths path values, estimated from n_samples i.i.d. samples:
+    //  sum is the sum of all the path values, squared the sum over samples of squared sample sums over sample size
+    FORCE_INLINE double StdErr(double sum, double squared, size_t n_samples, size_t n_paths) {
+        if (n_samples < 2)
+            return 0.0;
+        const double mean = sum / static_cast<double>(n_paths);
+        const double variance = (squared - static_cast<double>(n_paths) * mean * mean) / static_cast<double>(n_samples - 1);
+        return std::sqrt(std::max(variance, 0.0) / static_cast<double>(n_paths));
+    }
+
     struct SimResults_ {
-        explicit SimResults_(const Vector_<String_>& names) : aggregated_(0.0), risks_(names.size(), 0.0), names_(names) {
+        explicit SimResults_(const Vector_<String_>& names)
+            : aggregated_(0.0), squared_(0.0), nPaths_(0), nSamples_(0), risks_(names.size(), 0.0), risksSquared_(names.size(), 0.0),
+              nGroups_(0), names_(names) {
             for(auto i = 0; i < names.size(); ++i)
                 results_[names[i]] = &risks_[i];
         }
+        //  sum of the path payoffs, and sum of squares of the payoff samples (see PayoffSamples_)
         double aggregated_;
+        double squared_;
+        size_t nPaths_;
+        size_t nSamples_;
+        //  risks are averaged over paths; their squares are collected on groups of paths (see risk_group_size in MCSimulation)
         Vector_<> risks_;
+        Vector_<> risksSquared_;
+        size_t nGroups_;
         Vector_<String_> names_;
         std::map<String_, const double*> results_;
 
         FORCE_INLINE double operator[](const String_& name) {
             return *results_[name];
         }
+
+        //  batches sum the risks over their paths, they are averaged once all the batches of the n_paths paths are reduced
+        void Close(size_t n_paths) {
+            nPaths_ = n_paths;
+            for (auto& risk : risks_)
+                risk /= static_cast<double>(n_paths);
+        }
+
+        //  Combine with the results of another, disjoint, set of paths
+        void Merge(const SimResults_& other) {
+            const auto n = static_cast<double>(nPaths_ + other.nPaths_);
+            for (size_t j = 0; j < risks_.size(); ++j) {
+                risks_[j] = (risks_[j] * static_cast<double>(nPaths_) + other.risks_[j] * static_cast<double>(other.nPaths_)) / n;
+                risksSquared_[j] += other.risksSquared_[j];
+            }
+            aggregated_ += other.aggregated_;
+            squared_ += other.squared_;
+            nPaths_ += other.nPaths_;
+            nSamples_ += other.nSamples_;
+            nGroups_ += other.nGroups_;
+        }
+
+        [[nodiscard]] double Mean() const { return aggregated_ / static_cast<double>(nPaths_); }
+        [[nodiscard]] double StdErr() const { return Script::StdErr(aggregated_, squared_, nSamples_, nPaths_); }
+        [[nodiscard]] double RiskStdErr(size_t i) const {
+            return Script::StdErr(risks_[i] * static_cast<double>(nPaths_), risksSquared_[i], nGroups_, nPaths_);
+        }
     };
 
+    //  Accumulates the payoffs of consecutive paths into i.i.d. samples for the standard error:
+    //  one sample per path, or one per antithetic pair (2k, 2k + 1), the two paths of a pair being dependent
+    struct PayoffSamples_ {
+        bool antithetic_;
+        double sum_ = 0.0;
+        double squared_ = 0.0;
+        size_t nSamples_ = 0;
+        bool open_ = false;
+        double pending_ = 0.0;
+
+        explicit PayoffSamples_(bool antithetic = false) : antithetic_(antithetic) {}
+
+        FORCE_INLINE void Add(size_t path, double payoff) {
+            sum_ += payoff;
+            if (!antithetic_) {
+                squared_ += payoff * payoff;
+                ++nSamples_;
+            } else if (!(path & 1)) {
+                Close();
+                pending_ = payoff;
+                open_ = true;
+            } else if (open_) {
+                const double pair = pending_ + payoff;
+                squared_ += 0.5 * pair * pair;
+                ++nSamples_;
+                open_ = false;
+            } else {
+                //  second half of a pair started before the first path of the run
+                squared_ += payoff * payoff;
+                ++nSamples_;
+            }
+        }
+
+        //  a pair cut by the end of the run counts as a sample of one path
+        void Close() {
+            if (open_) {
+                squared_ += pending_ * pending_;
+                ++nSamples_;
+                open_ = false;
+            }
+        }
+    };
+
+    //  Partial results of one batch of paths, with the risks summed over the paths
+    //  batches have a fixed size and are reduced in batch order, so the results do not depend on the number of threads
+    struct BatchResults_ {
+        double sum_ = 0.0;
+        double squared_ = 0.0;
+        size_t nSamples_ = 0;
+        Vector_<> risks_;
+        Vector_<> risksSquared_;
+        size_t nGroups_ = 0;
+
+        explicit BatchResults_(size_t n_risks = 0) : risks_(n_risks, 0.0), risksSquared_(n_risks, 0.0) {}
+
+        void AddTo(SimResults_* dst) const {
+            dst->aggregated_ += sum_;
+            dst->squared_ += squared_;
+            dst->nSamples_ += nSamples_;
+            dst->nGroups_ += nGroups_;
+            for (size_t j = 0; j < risks_.size(); ++j) {
+                dst->risks_[j] += risks_[j];
+                dst->risksSquared_[j] += risksSquared_[j];
+            }
+        }
+    };
+
+    //  Reduces batches of n_paths paths in their order
+    inline SimResults_ ReduceBatches(const Vector_<String_>& names, const Vector_<BatchResults_>& batches, size_t n_paths) {
+        SimResults_ retval(names);
+        for (const auto& batch : batches)
+            batch.AddTo(&retval);
+        retval.Close(n_paths);
+        return retval;
+    }
+
+    //  even, so that antithetic pairs are never split between batches and are evaluated back to back
     constexpr int BATCH_SIZE = 1024;
+    //  smallest round of MCSimulationAdaptive, in whole batches and independent of the number of threads, so is the path count it stops at
+    constexpr int ADAPTIVE_ROUND = 16 * BATCH_SIZE;
+    //  Number of paths generated and evaluated together in batched mode
+    constexpr int BATCH_WIDTH = 64;
 
+    //  with a checkpoint, the results of the model initialization are restored as leaves instead of being recorded
     template<class E_>
     void InitModel4ParallelAAD(const ScriptProduct_& prd,
                                AAD::Model_<AAD::Number_>& model,
                                Scenario_<AAD::Number_>& path,
-                               E_& evaluator) {
+                               E_& evaluator,
+                               const AAD::Checkpoint_* checkpoint = nullptr) {
         Number_::Tape()->Rewind();
         for (Number_* param : model.Parameters())
             param->PutOnTape();
@@ -47,13 +179,163 @@ namespace Dal::Script {
         for (Number_& param : evaluator.ConstVarVals())
             param.PutOnTape();
 
-        model.Init(prd.TimeLine(), prd.DefLine());
+        if (checkpoint)
+            checkpoint->Restore(model.InitOutputs());
+        else
+            model.Init(prd.TimeLine(), prd.DefLine());
         InitializePath(path);
         Number_::Tape()->Mark();
     }
 
-    std::unique_ptr<Random_> CreateRNG(const String_& method, size_t n_dim, bool use_bb);
+    //  in antithetic mode, paths come in pairs driven by opposite gaussians: 2k and 2k + 1 from the start of the sequence
+    std::unique_ptr<Random_> CreateRNG(const String_& method, size_t n_dim, bool use_bb, bool antithetic = false);
+
+    //  Forward mode simulation with T_ = AAD::Dual_<N_>: the model parameters and constant variables are seeded N_ at a time,
+    //  each round simulating the same paths; nothing is recorded, so the threads only share the results
+    //  the compiled form takes any width, the interpreted form the widths registered in visitorlist.hpp
+    template <class T_>
+    SimResults_ MCSimulationForward(const ScriptProduct_& product,
+                                    const Handle_<ModelData_>& model_data,
+                                    size_t n_paths,
+                                    const String_& rsg,
+                                    bool use_bb,
+                                    bool compiled,
+                                    int max_nested_ifs,
+                                    double eps,
+                                    Vector_<>* path_payoffs,
+                                    size_t first_path,
+                                    const ControlVariates_* controls,
+                                    bool antithetic,
+                                    Vector_<BatchResults_>* batches) {
+        constexpr size_t width = T_::numTangents_;
+        std::unique_ptr<AAD::Model_<T_>> mdl = CreateModel<T_>(model_data);
+        mdl->Allocate(product.TimeLine(), product.DefLine());
+        const size_t nParams = mdl->Parameters().size();
+        const size_t nRisks = nParams + product.ConstVarNames().size();
+        const size_t nRounds = std::max<size_t>((nRisks + width - 1) / width, 1);
+        if (controls)
+            REQUIRE(controls->betas_.size() == controls->controls_.size(), "control coefficients and controls do not match");
+
+        ThreadPool_* pool = ThreadPool_::GetInstance();
+        const size_t nThreads = pool->NumThreads();
+
+        Vector_<std::unique_ptr<Random_>> rngVector(nThreads);
+        for (auto& random : rngVector)
+            random = CreateRNG(rsg, mdl->SimDim(), use_bb, antithetic);
+        Vector_<Vector_<>> gaussVectors(nThreads, Vector_<>(mdl->SimDim()));
+        Vector_<Scenario_<T_>> paths(nThreads);
+        for (auto& path : paths) {
+            AllocatePath(product.DefLine(), path);
+            InitializePath(path);
+        }
+        Vector_<FuzzyEvaluator_<T_>> evalVector;
+        Vector_<EvalState_<T_>> evalStateVector;
+        if (compiled) {
+            evalStateVector = Vector_<EvalState_<T_>>(nThreads, product.BuildEvalState<T_>());
+            for (auto& evalState : evalStateVector)
+                evalState.SetDefEps(eps);
+        } else
+            evalVector = Vector_<FuzzyEvaluator_<T_>>(nThreads, product.BuildFuzzyEvaluator<T_>(max_nested_ifs, eps));
+
+        if (path_payoffs)
+            path_payoffs->Resize(n_paths);
+        auto payoffIndex = product.PayOffIdx();
+        //  each round fills the risks of its inputs, the payoffs are the same in every round and only counted in the first one
+        const int batchSize = BATCH_SIZE;
+        Vector_<BatchResults_> simResults((n_paths + batchSize - 1) / batchSize, BatchResults_(nRisks));
+
+        for (size_t round = 0; round < nRounds; ++round) {
+            //  inputs firstRisk to firstRisk + width - 1 carry the tangents of this round
+            const size_t firstRisk = round * width;
+            auto seed = [&](T_& input, size_t j) {
+                if (j >= firstRisk && j < firstRisk + width)
+                    input.Seed(j - firstRisk);
+                else
+                    input = T_(input.value());
+            };
+            std::unique_ptr<AAD::Model_<T_>> model = mdl->Clone();
+            for (size_t j = 0; j < nParams; ++j)
+                seed(*model->Parameters()[j], j);
+            model->Init(product.TimeLine(), product.DefLine());
+            for (size_t t = 0; t < nThreads; ++t) {
+                auto& constVarVals = compiled ? evalStateVector[t].ConstVarVals() : evalVector[t].ConstVarVals();
+                for (size_t j = nParams; j < nRisks; ++j)
+                    seed(constVarVals[j - nParams], j);
+            }
+            Vector_<T_> expectations;
+            if (controls)
+                expectations = ControlExpectations(*controls, *model, product.TimeLine());
+
+            Vector_<TaskHandle_> futures;
+            int firstPath = static_cast<int>(first_path);
+            int pathsLeft = static_cast<int>(n_paths);
+            size_t loopIndex = 0;
+            while (pathsLeft > 0) {
+                auto pathsInTask = std::min(pathsLeft, batchSize);
+                auto& batch = simResults[loopIndex];
+                loopIndex += 1;
+                futures.push_back(pool->SpawnTask([&, firstPath, pathsInTask]() {
+                    const size_t threadNum = ThreadPool_::ThreadNum();
+                    Vector_<>& gaussVec = gaussVectors[threadNum];
+                    Scenario_<T_>& path = paths[threadNum];
+                    auto& random = rngVector[threadNum];
+                    random->SkipTo(firstPath);
+
+                    PayoffSamples_ samples(antithetic);
+                    for (size_t i = 0; i < pathsInTask; ++i) {
+                        random->FillNormal(&gaussVec);
+                        model->GeneratePath(gaussVec, &path);
+                        T_ payoff;
+                        if (compiled) {
+                            product.EvaluateCompiled(path, evalStateVector[threadNum]);
+                            payoff = evalStateVector[threadNum].VarVals()[payoffIndex];
+                        } else {
+                            product.Evaluate(path, evalVector[threadNum]);
+                            payoff = evalVector[threadNum].VarVals()[payoffIndex];
+                        }
+                        if (controls)
+                            payoff -= ControlAdjustment(*controls, expectations, [&path](size_t j) {
+                                return std::make_pair(path[j].spot_, path[j].numeraire_);
+                            });
+                        samples.Add(firstPath + i, payoff.value());
+                        if (path_payoffs && round == 0)
+                            (*path_payoffs)[firstPath - first_path + i] = payoff.value();
+                        for (size_t j = firstRisk; j < std::min(firstRisk + width, nRisks); ++j) {
+                            const double risk = payoff.Tangent(j - firstRisk);
+                            batch.risks_[j] += risk;
+                            batch.risksSquared_[j] += risk * risk;
+                        }
+                    }
+                    if (round == 0) {
+                        samples.Close();
+                        batch.sum_ = samples.sum_;
+                        batch.squared_ = samples.squared_;
+                        batch.nSamples_ = samples.nSamples_;
+                        batch.nGroups_ = pathsInTask;
+                    }
+                    return true;
+                }));
+                pathsLeft -= pathsInTask;
+                firstPath += pathsInTask;
+            }
+
+            for (auto& future : futures)
+                pool->ActiveWait(future);
+            //  the first error of the tasks is rethrown once none of them is left running on this frame
+            for (auto& future : futures)
+                future.get();
+        }
+
+        SimResults_ results = ReduceBatches(Vector::Join(mdl->ParameterLabels(), product.ConstVarNames()), simResults, n_paths);
+        if (batches)
+            batches->Append(simResults);
+        return results;
+    }
 
+    //  double and AAD::Number_ have their own specializations, AAD::Dual_<N_> runs in forward mode
+    //  batched is only honored by double, on the non-fuzzy compiled form, and risk_group_size only by AAD::Number_; other modes reject them
+    //  in AAD mode, the adjoints are propagated to the model parameters once per group of risk_group_size paths, or once per batch if 0:
+    //  risk standard errors are estimated from the spread of these groups, at the cost of one propagation for each
     template <class T_>
     SimResults_ MCSimulation(const ScriptProduct_& product,
                              const Handle_<ModelData_>& model_data,
@@ -62,8 +344,20 @@ namespace Dal::Script {
                              bool use_bb = false,
                              bool compiled = false,
                              int max_nested_ifs = -1,
-                             double eps = 0.01) {
-        THROW("not implemented");
+                             double eps = 0.01,
+                             bool batched = false,
+                             Vector_<>* path_payoffs = nullptr,
+                             size_t first_path = 0,
+                             const ControlVariates_* controls = nullptr,
+                             bool antithetic = false,
+                             size_t risk_group_size = 0,
+                             Vector_<BatchResults_>* batches = nullptr) {
+        REQUIRE(!batched, "batched mode is only implemented for double simulations");
+        REQUIRE(risk_group_size == 0, "risk groups are only implemented for AAD simulations");
+        if constexpr (AAD::IsDual_<T_>::value)
+            return MCSimulationForward<T_>(product, model_data, n_paths, rsg, use_bb, compiled, max_nested_ifs, eps, path_payoffs, first_path, controls, antithetic, batches);
+        else
+            THROW("not implemented");
     }
 
     template <>
@@ -74,7 +368,18 @@ namespace Dal::Script {
                              bool use_bb,
                              bool compiled,
                              int max_nested_ifs,
-                             double eps) {
+                             double eps,
+                             bool batched,
+                             Vector_<>* path_payoffs,
+                             size_t first_path,
+                             const ControlVariates_* controls,
+                             bool antithetic,
+                             size_t risk_group_size,
+                             Vector_<BatchResults_>* batches) {
+        REQUIRE(risk_group_size == 0, "risk groups are only implemented for AAD simulations");
+        //  batched mode works on the non-fuzzy compiled form only
+        REQUIRE(!batched || compiled, "batched mode requires compiled evaluation");
+        REQUIRE(!batched || !product.IsCompiledFuzzy(), "batched mode does not support fuzzy compiled products");
         std::unique_ptr<AAD::Model_<double>> mdl = CreateModel<double>(model_data);
 
         mdl->Allocate(product.TimeLine(), product.DefLine());
@@ -85,7 +390,7 @@ namespace Dal::Script {
 
         Vector_<std::unique_ptr<Random_>> rngVector(nThreads);
         for (auto& random : rngVector)
-            random = CreateRNG(rsg, mdl->SimDim(), use_bb);
+            random = CreateRNG(rsg, mdl->SimDim(), use_bb, antithetic);
 
         Vector_<Vector_<>> gaussVectors(nThreads);
         Vector_<Scenario_<>> paths(nThreads);
@@ -100,23 +405,48 @@ namespace Dal::Script {
 
         Vector_<Evaluator_<double>> evalVector(nThreads, product.BuildEvaluator<double>());
         Vector_<EvalState_<double>> evalStateVector(nThreads, product.BuildEvalState<double>());
+        for (auto& evalState : evalStateVector)
+            evalState.SetDefEps(eps);
+
+        Vector_<> expectations;
+        if (controls) {
+            REQUIRE(controls->betas_.size() == controls->controls_.size(), "control coefficients and controls do not match");
+            expectations = ControlExpectations(*controls, *mdl, product.TimeLine());
+            if (controls->pathValues_)
+                controls->pathValues_->Resize(static_cast<int>(n_paths), static_cast<int>(controls->controls_.size()));
+        }
+
+        Vector_<Vector_<Vector_<>>> batchGaussVectors;
+        Vector_<AAD::BatchScenario_> batchPaths;
+        Vector_<BatchEvalState_> batchEvalStateVector;
+        if (batched) {
+            batchGaussVectors = Vector_<Vector_<Vector_<>>>(nThreads, Vector_<Vector_<>>(BATCH_WIDTH, Vector_<>(mdl->SimDim())));
+            batchPaths.Resize(nThreads);
+            for (auto& path : batchPaths) {
+                AllocateBatchPath(product.DefLine(), BATCH_WIDTH, path);
+                InitializeBatchPath(path);
+            }
+            batchEvalStateVector = Vector_<BatchEvalState_>(nThreads, product.BuildBatchEvalState(BATCH_WIDTH));
+        }
 
         SimResults_ results(Vector::Join(mdl->ParameterLabels(), product.ConstVarNames()));
 
         Vector_<TaskHandle_> futures;
-        const int batch_size = std::max(BATCH_SIZE, static_cast<int>(n_paths / nThreads) + 1);
+        const int batch_size = BATCH_SIZE;
         futures.reserve(n_paths / batch_size + 1);
-        Vector_<> simResults;
+        Vector_<PayoffSamples_> simResults;
         simResults.reserve(n_paths / batch_size + 1);
+        if (path_payoffs)
+            path_payoffs->Resize(n_paths);
 
-        int firstPath = 0;
+        int firstPath = static_cast<int>(first_path);
         int pathsLeft = static_cast<int>(n_paths);
         size_t loopIndex = 0;
         auto payoffIndex = product.PayOffIdx();
 
         while (pathsLeft > 0) {
             auto pathsInTask = std::min(pathsLeft, batch_size);
-            simResults.emplace_back(0.0);
+            simResults.emplace_back(antithetic);
             auto& simResult = simResults[loopIndex];
             loopIndex += 1;
             futures.push_back(pool->SpawnTask([&, firstPath, pathsInTask]() {
@@ -125,13 +455,44 @@ namespace Dal::Script {
                 Scenario_<>& path = paths[threadNum];
                 auto& random = rngVector[threadNum];
                 random->SkipTo(firstPath);
-                if (compiled) {
+                auto addPath = [&, firstPath](size_t i, double payoff) {
+                    simResult.Add(firstPath + i, payoff);
+                    if (path_payoffs)
+                        (*path_payoffs)[firstPath - first_path + i] = payoff;
+                };
+                auto controlled = [&, firstPath](size_t i, double payoff, auto sample) {
+                    if (!controls)
+                        return payoff;
+                    double* values = controls->pathValues_ ? &(*controls->pathValues_)(static_cast<int>(firstPath - first_path + i), 0) : nullptr;
+                    return payoff - ControlAdjustment(*controls, expectations, sample, values);
+                };
+                auto sampleOf = [](const Scenario_<>& p) {
+                    return [&p](size_t j) { return std::make_pair(p[j].spot_, p[j].numeraire_); };
+                };
+                if (batched) {
+                    Vector_<Vector_<>>& gaussVecs = batchGaussVectors[threadNum];
+                    AAD::BatchScenario_& batchPath = batchPaths[threadNum];
+                    BatchEvalState_& evalState = batchEvalStateVector[threadNum];
+                    for (size_t i = 0; i < pathsInTask; i += BATCH_WIDTH) {
+                        const size_t n = std::min<size_t>(BATCH_WIDTH, pathsInTask - i);
+                        for (size_t k = 0; k < n; ++k)
+                            random->FillNormal(&gaussVecs[k]);
+                        mdl->GeneratePaths(gaussVecs, n, &path, &batchPath);
+                        product.EvaluateCompiledBatch(batchPath, evalState);
+                        //  summed path by path, in the same order as the scalar loop
+                        const double* payoffs = evalState.Var(payoffIndex);
+                        for (size_t k = 0; k < n; ++k)
+                            addPath(i + k, controlled(i + k, payoffs[k], [&batchPath, k](size_t j) {
+                                return std::make_pair(batchPath[j].spot_[k], batchPath[j].numeraire_[k]);
+                            }));
+                    }
+                } else if (compiled) {
                     EvalState_<double>& evalState = evalStateVector[threadNum];
                     for (size_t i = 0; i < pathsInTask; ++i) {
                         random->FillNormal(&gaussVec);
                         mdl->GeneratePath(gaussVec, &path);
                         product.EvaluateCompiled(path, evalState);
-                        simResult += evalState.VarVals()[payoffIndex];
+                        addPath(i, controlled(i, evalState.VarVals()[payoffIndex], sampleOf(path)));
                     }
                 } else {
                     Evaluator_<double>& eval = evalVector[threadNum];
@@ -139,9 +500,10 @@ namespace Dal::Script {
                         random->FillNormal(&gaussVec);
                         mdl->GeneratePath(gaussVec, &path);
                         product.Evaluate(path, eval);
-                        simResult += eval.VarVals()[payoffIndex];
+                        addPath(i, controlled(i, eval.VarVals()[payoffIndex], sampleOf(path)));
                     }
                 }
+                simResult.Close();
                 return true;
             }));
             pathsLeft -= pathsInTask;
@@ -150,9 +512,28 @@ namespace Dal::Script {
 
         for (auto& future : futures)
             pool->ActiveWait(future);
+        //  the first error of the tasks is rethrown once none of them is left running on this frame
+        for (auto& future : futures)
+            future.get();
 
-        // aggregate all the results
-        results.aggregated_ = Accumulate(simResults);
+        // aggregate all the results, in batch order
+        for (const auto& simResult : simResults) {
+            results.aggregated_ += simResult.sum_;
+            results.squared_ += simResult.squared_;
+            results.nSamples_ += simResult.nSamples_;
+        }
+        results.nPaths_ = n_paths;
+        results.nGroups_ = n_paths;
+        if (batches) {
+            for (size_t i = 0; i < simResults.size(); ++i) {
+                BatchResults_ batch(results.risks_.size());
+                batch.sum_ = simResults[i].sum_;
+                batch.squared_ = simResults[i].squared_;
+                batch.nSamples_ = simResults[i].nSamples_;
+                batch.nGroups_ = std::min<size_t>(n_paths - i * batch_size, batch_size);
+                batches->push_back(batch);
+            }
+        }
         return results;
     }
 
@@ -164,7 +545,15 @@ namespace Dal::Script {
                              bool use_bb,
                              bool compiled,
                              int max_nested_ifs,
-                             double eps) {
+                             double eps,
+                             bool batched,
+                             Vector_<>* path_payoffs,
+                             size_t first_path,
+                             const ControlVariates_* controls,
+                             bool antithetic,
+                             size_t risk_group_size,
+                             Vector_<BatchResults_>* batches) {
+        REQUIRE(!batched, "batched mode is only implemented for double simulations");
         std::unique_ptr<AAD::Model_<Number_>> mdl = CreateModel<Number_>(model_data);
         const auto nParams = mdl->Parameters().size();
         const auto nConstVars = product.ConstVarNames().size();
@@ -173,96 +562,612 @@ namespace Dal::Script {
         const size_t nThreads = pool->NumThreads();
 
         Vector_<TaskHandle_> futures;
-        const int batchSize = std::max(BATCH_SIZE, static_cast<int>(n_paths / nThreads) + 1);
+        const int batchSize = BATCH_SIZE;
+        Vector_<BatchResults_> simResults((n_paths + batchSize - 1) / batchSize);
 
-        int firstPath = 0;
+        int firstPath = static_cast<int>(first_path);
         int pathsLeft = static_cast<int>(n_paths);
+        size_t loopIndex = 0;
         auto payoffIndex = product.PayOffIdx();
-        Vector_<AAD::Tape_> tapes(nThreads);
-        AAD::Tape_* mainThreadPtr = Number_::Tape();
+        //  the tasks run by this thread while it waits record on its thread tape, the caller's tape is restored on exit
+        AAD::TapeScope_ callerTape(*AAD::ThreadTape());
 
-        SimResults_ values(Vector::Join(mdl->ParameterLabels(), product.ConstVarNames()));
-        Vector_<SimResults_> simResults(nThreads, values);
+        if (path_payoffs)
+            path_payoffs->Resize(n_paths);
+
+        //  per thread workspace, built and initialized by the first task running on each thread
+        Vector_<std::unique_ptr<AAD::Model_<AAD::Number_>>> models(nThreads);
+        Vector_<std::unique_ptr<Random_>> rngVector(nThreads);
+        Vector_<Vector_<>> gaussVectors(nThreads);
+        Vector_<Scenario_<AAD::Number_>> paths(nThreads);
+        Vector_<std::unique_ptr<EvalState_<AAD::Number_>>> evalStateVector(nThreads);
+        Vector_<std::unique_ptr<FuzzyEvaluator_<AAD::Number_>>> evalVector(nThreads);
+        Vector_<Vector_<Number_>> expectationVector(nThreads);
+        if (controls)
+            REQUIRE(controls->betas_.size() == controls->controls_.size(), "control coefficients and controls do not match");
+        //  groups made of whole antithetic pairs, the two paths of a pair being dependent
+        REQUIRE(!antithetic || risk_group_size % 2 == 0, "risk group size should be even in antithetic mode");
+
+        //  models exposing the results of their initialization have it recorded once, on the checkpoint tape:
+        //  thread tapes then only hold these results as leaves and scale with one path, not with the model parameters
+        std::unique_ptr<AAD::Model_<Number_>> initModel = mdl->Clone();
+        initModel->Allocate(product.TimeLine(), product.DefLine());
+        std::unique_ptr<AAD::Checkpoint_> checkpoint;
+        if (!initModel->InitOutputs().empty())
+            checkpoint = std::make_unique<AAD::Checkpoint_>(initModel->Parameters(), [&]() {
+                initModel->Init(product.TimeLine(), product.DefLine());
+                return initModel->InitOutputs();
+            });
+        Vector_<Vector_<Number_*>> initOutputs(nThreads);
+        //  the checkpoint is shared read only, each thread sweeps it with its own adjoints
+        Vector_<Vector_<>> checkpointAdjoints(nThreads);
+        //  built here, so that an unknown generator or invalid options are reported to the caller, then cloned by each thread
+        const std::unique_ptr<Random_> rng = CreateRNG(rsg, initModel->SimDim(), use_bb, antithetic);
 
         while (pathsLeft > 0) {
             auto pathsInTask = std::min(pathsLeft, batchSize);
+            auto& results = simResults[loopIndex];
+            loopIndex += 1;
             futures.push_back(pool->SpawnTask([&, firstPath, pathsInTask]() {
                 const size_t threadNum = ThreadPool_::ThreadNum();
-                Number_::SetTape(tapes[threadNum]);
-                Number_::Tape()->Rewind();
-                std::unique_ptr<AAD::Model_<AAD::Number_>> model = mdl->Clone();
-                model->Allocate(product.TimeLine(), product.DefLine());
+                Number_::SetTape(*AAD::ThreadTape());
+                auto& model = models[threadNum];
+                Scenario_<AAD::Number_>& path = paths[threadNum];
+                if (!model) {
+                    //  model parameters and initialization are recorded once per thread, before the tape mark
+                    //  the workspace is built aside and only kept once complete, a throw leaves the next task to build it again
+                    Number_::Tape()->Rewind();
+                    std::unique_ptr<AAD::Model_<Number_>> newModel = mdl->Clone();
+                    newModel->Allocate(product.TimeLine(), product.DefLine());
+                    std::unique_ptr<Random_> newRandom(rng->Clone());
+                    gaussVectors[threadNum].Resize(newModel->SimDim());
+                    AllocatePath(product.DefLine(), path);
+                    std::unique_ptr<EvalState_<AAD::Number_>> newEvalState;
+                    std::unique_ptr<FuzzyEvaluator_<AAD::Number_>> newEval;
+                    if (compiled) {
+                        newEvalState = std::make_unique<EvalState_<AAD::Number_>>(product.BuildEvalState<AAD::Number_>());
+                        newEvalState->SetDefEps(eps);
+                        InitModel4ParallelAAD(product, *newModel, path, *newEvalState, checkpoint.get());
+                    } else {
+                        newEval = std::make_unique<FuzzyEvaluator_<AAD::Number_>>(product.BuildFuzzyEvaluator<AAD::Number_>(max_nested_ifs, eps));
+                        InitModel4ParallelAAD(product, *newModel, path, *newEval, checkpoint.get());
+                    }
+                    if (checkpoint)
+                        initOutputs[threadNum] = newModel->InitOutputs();
+                    //  the control expectations are recorded before the mark too, their sensitivities are added by the adjoint propagation
+                    if (controls) {
+                        expectationVector[threadNum] = ControlExpectations(*controls, *newModel, product.TimeLine());
+                        Number_::Tape()->Mark();
+                    }
+                    //  room for the largest path is taken now, so that the tape does not grow during the batches
+                    AAD::TapeSize_ pathSize = product.PathTapeSize();
+                    pathSize += newModel->PathTapeSize();
+                    if (controls)
+                        pathSize += ControlTapeSize(*controls);
+                    Number_::Tape()->ReserveAhead(pathSize);
 
-                std::unique_ptr<Random_> random = CreateRNG(rsg, model->SimDim(), use_bb);
-                Vector_<> gVec(model->SimDim());
+                    rngVector[threadNum] = std::move(newRandom);
+                    evalStateVector[threadNum] = std::move(newEvalState);
+                    evalVector[threadNum] = std::move(newEval);
+                    model = std::move(newModel);
+                }
+                const Vector_<Number_>& expectations = expectationVector[threadNum];
+                auto controlled = [&](Number_& payoff) {
+                    if (controls)
+                        payoff -= ControlAdjustment(*controls, expectations, [&path](size_t j) {
+                            return std::make_pair(path[j].spot_, path[j].numeraire_);
+                        });
+                };
 
-                Scenario_<AAD::Number_> path;
-                AllocatePath(product.DefLine(), path);
-                InitializePath(path);
+                auto& random = rngVector[threadNum];
+                Vector_<>& gVec = gaussVectors[threadNum];
                 random->SkipTo(firstPath);
 
-                double sumValue = 0.0;
-                auto& results = simResults(threadNum);
-                if (compiled) {
-                    EvalState_<AAD::Number_> evalState = product.BuildEvalState<AAD::Number_>();
-                    InitModel4ParallelAAD(product, *model, path, evalState);
+                PayoffSamples_ samples(antithetic);
+                results = BatchResults_(nParams + nConstVars);
+                auto addPath = [&, firstPath](size_t i, double payoff) {
+                    samples.Add(firstPath + i, payoff);
+                    if (path_payoffs)
+                        (*path_payoffs)[firstPath - first_path + i] = payoff;
+                };
+                //  adjoints are pulled back to the parameters once per group of paths, then cleared for the next group
+                const size_t pathsPerGroup = risk_group_size > 0 ? risk_group_size : static_cast<size_t>(pathsInTask);
+                const size_t nGroups = (pathsInTask + pathsPerGroup - 1) / pathsPerGroup;
+                Matrix_<> groupRisks(static_cast<int>(nGroups), static_cast<int>(nParams + nConstVars), 0.0);
+                //  the adjoints of the checkpointed initialization results are kept by group,
+                //  and pulled back to the parameters through the checkpoint at the end of the batch, all the groups in one sweep
+                const auto& outputs = initOutputs[threadNum];
+                Matrix_<> outputAdjoints(static_cast<int>(nGroups), static_cast<int>(outputs.size()), 0.0);
+                int group = 0;
+                auto addGroup = [&](const Vector_<Number_>& constVarVals) {
+                    Number_::PropagateMarkToStart();
+                    for (size_t j = 0; j < nParams + nConstVars; ++j)
+                        groupRisks(group, static_cast<int>(j)) = j < nParams ? model->Parameters()[j]->Adjoint() : constVarVals[j - nParams].Adjoint();
+                    for (size_t k = 0; k < outputs.size(); ++k)
+                        outputAdjoints(group, static_cast<int>(k)) = outputs[k]->Adjoint();
+                    ++group;
+                    Number_::Tape()->ResetAdjointsToMark();
+                };
+                auto closeGroups = [&]() {
+                    Matrix_<> initRisks(static_cast<int>(nGroups), static_cast<int>(nParams), 0.0);
+                    if (checkpoint)
+                        checkpoint->Differentiate(outputAdjoints, &initRisks, &checkpointAdjoints[threadNum]);
+                    for (int g = 0; g < group; ++g) {
+                        const auto groupSize = static_cast<double>(std::min(pathsPerGroup, pathsInTask - static_cast<size_t>(g) * pathsPerGroup));
+                        for (size_t j = 0; j < nParams + nConstVars; ++j) {
+                            double risk = groupRisks(g, static_cast<int>(j));
+                            if (j < nParams)
+                                risk += initRisks(g, static_cast<int>(j));
+                            results.risks_[j] += risk;
+                            results.risksSquared_[j] += risk * risk / groupSize;
+                        }
+                    }
+                    results.nGroups_ = group;
+                };
 
+                if (compiled) {
+                    EvalState_<AAD::Number_>& evalState = *evalStateVector[threadNum];
                     for (size_t i = 0; i < pathsInTask; i++) {
                         Number_::Tape()->RewindToMark();
                         random->FillNormal(&gVec);
                         model->GeneratePath(gVec, &path);
                         product.EvaluateCompiled(path, evalState);
                         Number_ res = evalState.VarVals()[payoffIndex];
+                        controlled(res);
                         res.PropagateToMark();
-                        sumValue += res.value();
+                        addPath(i, res.value());
+                        if ((i + 1) % pathsPerGroup == 0 || i + 1 == pathsInTask)
+                            addGroup(evalState.ConstVarVals());
                     }
-
-                    Number_::PropagateMarkToStart();
-                    for (size_t j = 0; j < nParams; ++j)
-                        results.risks_[j] += model->Parameters()[j]->Adjoint() / static_cast<double>(n_paths);
-
-                    for (size_t j = 0; j < nConstVars; ++j)
-                        results.risks_[j + nParams] +=  evalState.ConstVarVals()[j].Adjoint() / static_cast<double>(n_paths);
                 }
                 else {
-                    FuzzyEvaluator_<AAD::Number_> eval = product.BuildFuzzyEvaluator<AAD::Number_>(max_nested_ifs, eps);
-                    InitModel4ParallelAAD(product, *model, path, eval);
-
+                    FuzzyEvaluator_<AAD::Number_>& eval = *evalVector[threadNum];
                     for (size_t i = 0; i < pathsInTask; i++) {
                         Number_::Tape()->RewindToMark();
                         random->FillNormal(&gVec);
                         model->GeneratePath(gVec, &path);
                         product.Evaluate(path, eval);
                         Number_ res = eval.VarVals()[payoffIndex];
+                        controlled(res);
                         res.PropagateToMark();
-                        sumValue += res.value();
+                        addPath(i, res.value());
+                        if ((i + 1) % pathsPerGroup == 0 || i + 1 == pathsInTask)
+                            addGroup(eval.ConstVarVals());
                     }
+                }
+                closeGroups();
+                samples.Close();
+                results.sum_ = samples.sum_;
+                results.squared_ = samples.squared_;
+                results.nSamples_ = samples.nSamples_;
+                return true;
+            }));
+            pathsLeft -= pathsInTask;
+            firstPath += pathsInTask;
+        }
 
-                    Number_::PropagateMarkToStart();
-                    for (size_t j = 0; j < nParams; ++j)
-                        results.risks_[j] += model->Parameters()[j]->Adjoint() / static_cast<double>(n_paths);
+        //  reduced in batch order as the batches complete
+        SimResults_ rtn(Dal::Vector::Join(mdl->ParameterLabels(), product.ConstVarNames()));
+        for (size_t i = 0; i < futures.size(); ++i) {
+            pool->ActiveWait(futures[i]);
+            simResults[i].AddTo(&rtn);
+            if (batches)
+                batches->push_back(std::move(simResults[i]));
+            simResults[i] = BatchResults_();
+        }
+        //  the first error of the tasks is rethrown once none of them is left running on this frame
+        for (auto& future : futures)
+            future.get();
+
+        rtn.Close(n_paths);
+        return rtn;
+    }
 
-                    for (size_t j = 0; j < nConstVars; ++j)
-                        results.risks_[j + nParams] +=  eval.ConstVarVals()[j].Adjoint() / static_cast<double>(n_paths);
+    //  Runs rounds of paths until the standard error of the PV reaches abs_tol or rel_tol * |PV|, or the path or time budget is spent
+    //  each round starts where the previous one stopped in the random sequence, so the paths are those of a fixed run with the final path count
+    template <class T_>
+    SimResults_ MCSimulationAdaptive(const ScriptProduct_& product,
+                                     const Handle_<ModelData_>& model_data,
+                                     double abs_tol,
+                                     double rel_tol,
+                                     size_t max_paths,
+                                     double max_seconds = 0.0,
+                                     const String_& rsg = "sobol",
+                                     bool use_bb = false,
+                                     bool compiled = false,
+                                     int max_nested_ifs = -1,
+                                     double eps = 0.01,
+                                     bool antithetic = false) {
+        REQUIRE(abs_tol > 0.0 || rel_tol > 0.0, "at least one of absolute or relative tolerance should be positive");
+        REQUIRE(max_paths > 0, "path budget should be positive");
+        Timer_ timer;
+
+        //  the batches of all the rounds are kept and reduced together in their order, as a fixed run of the same paths would
+        Vector_<BatchResults_> batches;
+        SimResults_ results = MCSimulation<T_>(product, model_data, std::min<size_t>(ADAPTIVE_ROUND, max_paths), rsg, use_bb, compiled, max_nested_ifs, eps, false,
+                                               nullptr, 0, nullptr, antithetic, 0, &batches);
+        while (results.nPaths_ < max_paths) {
+            if (max_seconds > 0.0 && static_cast<double>(timer.Elapsed<milliseconds>()) >= 1000.0 * max_seconds)
+                break;
+            const double target = std::max(abs_tol, rel_tol * std::fabs(results.Mean()));
+            const double err = results.StdErr();
+            if (err <= target)
+                break;
+
+            //  standard error decreases as 1 / sqrt(n): aim at the estimated path count, but never more than double in one round
+            size_t next = results.nPaths_;
+            if (target > 0.0)
+                next = std::min(next, static_cast<size_t>(std::ceil(static_cast<double>(results.nPaths_) * Square(err / target))) - results.nPaths_);
+            next = std::max<size_t>(next, ADAPTIVE_ROUND);
+            next = (next + BATCH_SIZE - 1) / BATCH_SIZE * BATCH_SIZE;
+            next = std::min(next, max_paths - results.nPaths_);
+            MCSimulation<T_>(product, model_data, next, rsg, use_bb, compiled, max_nested_ifs, eps, false, nullptr, results.nPaths_, nullptr, antithetic, 0, &batches);
+            results = ReduceBatches(results.names_, batches, results.nPaths_ + next);
+        }
+        return results;
+    }
 
+    //  Control variate simulation: the coefficients of the controls are estimated by regression on a pilot run of n_pilot paths,
+    //  then applied to the next n_paths paths of the sequence, which keeps the estimates unbiased
+    //  the generator must skip the pilot paths, which the irn generator cannot do
+    template <class T_>
+    SimResults_ MCSimulationControlled(const ScriptProduct_& product,
+                                       const Handle_<ModelData_>& model_data,
+                                       const Vector_<ControlVariate_>& controls,
+                                       size_t n_paths,
+                                       size_t n_pilot = 4096,
+                                       const String_& rsg = "sobol",
+                                       bool use_bb = false,
+                                       bool compiled = false,
+                                       int max_nested_ifs = -1,
+                                       double eps = 0.01,
+                                       bool antithetic = false) {
+        REQUIRE(rsg != "irn", "control variates need a generator that skips the pilot paths");
+        Vector_<> payoffs;
+        Matrix_<> values;
+        const ControlVariates_ pilot{controls, Vector_<>(controls.size(), 0.0), &values};
+        MCSimulation<double>(product, model_data, n_pilot, rsg, use_bb, compiled, max_nested_ifs, eps, false, &payoffs, 0, &pilot, antithetic);
+        const ControlVariates_ applied{controls, ControlBetas(payoffs, values)};
+        return MCSimulation<T_>(product, model_data, n_paths, rsg, use_bb, compiled, max_nested_ifs, eps, false, nullptr, n_pilot, &applied, antithetic);
+    }
+
+    //  Results of a simulation differentiating several script variables at once, see MCSimulationMulti
+    struct MultiSimResults_ {
+        Vector_<String_> variables_;
+        Vector_<String_> names_;
+        Vector_<> aggregated_;
+        Vector_<> squared_;
+        //  risks_(k, j) is the sensitivity of the mean of variable k to the j-th model parameter or constant variable
+        Matrix_<> risks_;
+        size_t nPaths_ = 0;
+        size_t nSamples_ = 0;
+
+        MultiSimResults_(const Vector_<String_>& variables, const Vector_<String_>& names)
+            : variables_(variables), names_(names), aggregated_(variables.size(), 0.0), squared_(variables.size(), 0.0),
+              risks_(static_cast<int>(variables.size()), static_cast<int>(names.size()), 0.0) {}
+
+        [[nodiscard]] double Mean(size_t k) const { return aggregated_[k] / static_cast<double>(nPaths_); }
+        [[nodiscard]] double StdErr(size_t k) const { return Script::StdErr(aggregated_[k], squared_[k], nSamples_, nPaths_); }
+    };
+
+    //  Vector mode AAD: the variables are seeded together on each path and their adjoints propagated in a single reverse sweep,
+    //  which costs one sweep per path for the whole Jacobian instead of one simulation per variable
+    //  the tasks record with one adjoint per variable, a setting of their thread they restore when done, so other AAD runs are not affected
+    inline MultiSimResults_ MCSimulationMulti(const ScriptProduct_& product,
+                                              const Handle_<ModelData_>& model_data,
+                                              const Vector_<String_>& variables,
+                                              size_t n_paths,
+                                              const String_& rsg = "sobol",
+                                              bool use_bb = false,
+                                              bool compiled = false,
+                                              int max_nested_ifs = -1,
+                                              double eps = 0.01,
+                                              size_t first_path = 0,
+                                              bool antithetic = false) {
+        REQUIRE(!variables.empty(), "no variable to differentiate");
+        const size_t nVars = variables.size();
+        Vector_<size_t> varIndices;
+        for (const auto& v : variables) {
+            auto pv = std::find(product.VarNames().begin(), product.VarNames().end(), v);
+            REQUIRE(pv != product.VarNames().end(), "unknown variable " + v);
+            varIndices.push_back(static_cast<size_t>(pv - product.VarNames().begin()));
+        }
+
+        std::unique_ptr<AAD::Model_<Number_>> mdl = CreateModel<Number_>(model_data);
+        mdl->Allocate(product.TimeLine(), product.DefLine());
+        const auto nParams = mdl->Parameters().size();
+        const auto nConstVars = product.ConstVarNames().size();
+        //  built here, so that an unknown generator or invalid options are reported to the caller, then cloned by each thread
+        const std::unique_ptr<Random_> rng = CreateRNG(rsg, mdl->SimDim(), use_bb, antithetic);
+
+        ThreadPool_* pool = ThreadPool_::GetInstance();
+        const size_t nThreads = pool->NumThreads();
+
+        Vector_<TaskHandle_> futures;
+        const int batchSize = BATCH_SIZE;
+        Vector_<MultiSimResults_> simResults((n_paths + batchSize - 1) / batchSize, MultiSimResults_(variables, Vector_<String_>(nParams + nConstVars)));
+
+        int firstPath = static_cast<int>(first_path);
+        int pathsLeft = static_cast<int>(n_paths);
+        size_t loopIndex = 0;
+        //  the tasks run by this thread while it waits record on its thread tape, the caller's tape is restored on exit
+        AAD::TapeScope_ callerTape(*AAD::ThreadTape());
+
+        Vector_<std::unique_ptr<AAD::Model_<AAD::Number_>>> models(nThreads);
+        Vector_<std::unique_ptr<Random_>> rngVector(nThreads);
+        Vector_<Vector_<>> gaussVectors(nThreads);
+        Vector_<Scenario_<AAD::Number_>> paths(nThreads);
+        Vector_<std::unique_ptr<EvalState_<AAD::Number_>>> evalStateVector(nThreads);
+        Vector_<std::unique_ptr<FuzzyEvaluator_<AAD::Number_>>> evalVector(nThreads);
+
+        while (pathsLeft > 0) {
+            auto pathsInTask = std::min(pathsLeft, batchSize);
+            auto& results = simResults[loopIndex];
+            loopIndex += 1;
+            futures.push_back(pool->SpawnTask([&, firstPath, pathsInTask]() {
+                const size_t threadNum = ThreadPool_::ThreadNum();
+                const auto resetter = AAD::SetNumResultsForAAD(true, nVars);
+                Number_::SetTape(*AAD::ThreadTape());
+                auto& model = models[threadNum];
+                Scenario_<AAD::Number_>& path = paths[threadNum];
+                if (!model) {
+                    //  built aside and only kept once complete, as in MCSimulation
+                    Number_::Tape()->Rewind();
+                    std::unique_ptr<AAD::Model_<Number_>> newModel = mdl->Clone();
+                    newModel->Allocate(product.TimeLine(), product.DefLine());
+                    std::unique_ptr<Random_> newRandom(rng->Clone());
+                    gaussVectors[threadNum].Resize(newModel->SimDim());
+                    AllocatePath(product.DefLine(), path);
+                    std::unique_ptr<EvalState_<AAD::Number_>> newEvalState;
+                    std::unique_ptr<FuzzyEvaluator_<AAD::Number_>> newEval;
+                    if (compiled) {
+                        newEvalState = std::make_unique<EvalState_<AAD::Number_>>(product.BuildEvalState<AAD::Number_>());
+                        newEvalState->SetDefEps(eps);
+                        InitModel4ParallelAAD(product, *newModel, path, *newEvalState);
+                    } else {
+                        newEval = std::make_unique<FuzzyEvaluator_<AAD::Number_>>(product.BuildFuzzyEvaluator<AAD::Number_>(max_nested_ifs, eps));
+                        InitModel4ParallelAAD(product, *newModel, path, *newEval);
+                    }
+                    AAD::TapeSize_ pathSize = product.PathTapeSize();
+                    pathSize += newModel->PathTapeSize();
+                    Number_::Tape()->ReserveAhead(pathSize);
+
+                    rngVector[threadNum] = std::move(newRandom);
+                    evalStateVector[threadNum] = std::move(newEvalState);
+                    evalVector[threadNum] = std::move(newEval);
+                    model = std::move(newModel);
+                }
+
+                auto& random = rngVector[threadNum];
+                Vector_<>& gVec = gaussVectors[threadNum];
+                random->SkipTo(firstPath);
+
+                Vector_<PayoffSamples_> samples(nVars, PayoffSamples_(antithetic));
+                auto addPath = [&, firstPath](size_t i, const Vector_<Number_>& varVals) {
+                    for (size_t k = 0; k < nVars; ++k) {
+                        Number_ var = varVals[varIndices[k]];
+                        var.Adjoint(k) += 1.0;
+                        samples[k].Add(firstPath + i, var.value());
+                    }
+                    Number_::PropagateMultiToMark();
+                };
+                for (size_t i = 0; i < pathsInTask; i++) {
+                    Number_::Tape()->RewindToMark();
+                    random->FillNormal(&gVec);
+                    model->GeneratePath(gVec, &path);
+                    if (compiled) {
+                        product.EvaluateCompiled(path, *evalStateVector[threadNum]);
+                        addPath(i, evalStateVector[threadNum]->VarVals());
+                    } else {
+                        product.Evaluate(path, *evalVector[threadNum]);
+                        addPath(i, evalVector[threadNum]->VarVals());
+                    }
                 }
-                results.aggregated_ += sumValue;
+                for (size_t k = 0; k < nVars; ++k) {
+                    samples[k].Close();
+                    results.aggregated_[k] = samples[k].sum_;
+                    results.squared_[k] = samples[k].squared_;
+                }
+                results.nSamples_ = samples[0].nSamples_;
+
+                //  the adjoints accumulated on the mark over the batch are pulled back to the parameters at once
+                Number_::PropagateMultiMarkToStart();
+                const Vector_<Number_>& constVarVals = compiled ? evalStateVector[threadNum]->ConstVarVals() : evalVector[threadNum]->ConstVarVals();
+                for (size_t k = 0; k < nVars; ++k)
+                    for (size_t j = 0; j < nParams + nConstVars; ++j) {
+                        const double risk = j < nParams ? model->Parameters()[j]->Adjoint(k) : constVarVals[j - nParams].Adjoint(k);
+                        results.risks_(static_cast<int>(k), static_cast<int>(j)) = risk / static_cast<double>(n_paths);
+                    }
+                results.nPaths_ = pathsInTask;
+                Number_::Tape()->ResetAdjoints();
                 return true;
             }));
             pathsLeft -= pathsInTask;
             firstPath += pathsInTask;
         }
 
+        //  reduced in batch order as the batches complete
+        MultiSimResults_ rtn(variables, Dal::Vector::Join(mdl->ParameterLabels(), product.ConstVarNames()));
+        for (size_t i = 0; i < futures.size(); ++i) {
+            pool->ActiveWait(futures[i]);
+            const auto& batch = simResults[i];
+            for (size_t k = 0; k < nVars; ++k) {
+                rtn.aggregated_[k] += batch.aggregated_[k];
+                rtn.squared_[k] += batch.squared_[k];
+                for (size_t j = 0; j < nParams + nConstVars; ++j)
+                    rtn.risks_(static_cast<int>(k), static_cast<int>(j)) += batch.risks_(static_cast<int>(k), static_cast<int>(j));
+            }
+            rtn.nPaths_ += batch.nPaths_;
+            rtn.nSamples_ += batch.nSamples_;
+        }
+        //  the first error of the tasks is rethrown once none of them is left running on this frame
         for (auto& future : futures)
-            pool->ActiveWait(future);
+            future.get();
 
-        Number_::SetTape(*mainThreadPtr);
-        SimResults_ rtn(Dal::Vector::Join(mdl->ParameterLabels(), product.ConstVarNames()));
-        for (auto& res: simResults) {
-            rtn.aggregated_ += res.aggregated_;
-            for (size_t j = 0; j < rtn.risks_.size(); ++j)
-                rtn.risks_[j] += res.risks_[j];
+        return rtn;
+    }
+
+    //  Results of a second order simulation, see MCSimulationHessian
+    struct HessianResults_ {
+        Vector_<String_> names_;
+        double aggregated_ = 0.0;
+        double squared_ = 0.0;
+        size_t nPaths_ = 0;
+        //  sensitivities of the mean to the inputs, and the matrix of its second order sensitivities
+        Vector_<> risks_;
+        Matrix_<> hessian_;
+
+        explicit HessianResults_(const Vector_<String_>& names)
+            : names_(names), risks_(names.size(), 0.0), hessian_(static_cast<int>(names.size()), static_cast<int>(names.size()), 0.0) {}
+
+        [[nodiscard]] double Mean() const { return aggregated_ / static_cast<double>(nPaths_); }
+        [[nodiscard]] double StdErr() const { return Script::StdErr(aggregated_, squared_, nPaths_, nPaths_); }
+        [[nodiscard]] double Hessian(const String_& lhs, const String_& rhs) const {
+            auto pl = std::find(names_.begin(), names_.end(), lhs);
+            auto pr = std::find(names_.begin(), names_.end(), rhs);
+            REQUIRE(pl != names_.end() && pr != names_.end(), "unknown input " + (pl == names_.end() ? lhs : rhs));
+            return hessian_(static_cast<int>(pl - names_.begin()), static_cast<int>(pr - names_.begin()));
+        }
+    };
+
+    //  Second order forward mode simulation with T_ = AAD::Dual2_<N_>: the inputs at input_indices, counted over the model parameters
+    //  then the constant variables, are seeded once and every path carries the gradient and the Hessian of the payoff in them
+    template <class T_>
+    HessianResults_ MCSimulationHessianT(const ScriptProduct_& product,
+                                         const Handle_<ModelData_>& model_data,
+                                         const Vector_<String_>& inputs,
+                                         const Vector_<size_t>& input_indices,
+                                         size_t n_paths,
+                                         const String_& rsg,
+                                         bool use_bb,
+                                         bool compiled,
+                                         int max_nested_ifs,
+                                         double eps) {
+        const size_t nInputs = inputs.size();
+        std::unique_ptr<AAD::Model_<T_>> model = CreateModel<T_>(model_data);
+        model->Allocate(product.TimeLine(), product.DefLine());
+        const size_t nParams = model->Parameters().size();
+
+        ThreadPool_* pool = ThreadPool_::GetInstance();
+        const size_t nThreads = pool->NumThreads();
+
+        Vector_<std::unique_ptr<Random_>> rngVector(nThreads);
+        for (auto& random : rngVector)
+            random = CreateRNG(rsg, model->SimDim(), use_bb);
+        Vector_<Vector_<>> gaussVectors(nThreads, Vector_<>(model->SimDim()));
+        Vector_<Scenario_<T_>> paths(nThreads);
+        for (auto& path : paths) {
+            AllocatePath(product.DefLine(), path);
+            InitializePath(path);
+        }
+        Vector_<FuzzyEvaluator_<T_>> evalVector;
+        Vector_<EvalState_<T_>> evalStateVector;
+        if (compiled) {
+            evalStateVector = Vector_<EvalState_<T_>>(nThreads, product.BuildEvalState<T_>());
+            for (auto& evalState : evalStateVector)
+                evalState.SetDefEps(eps);
+        } else
+            evalVector = Vector_<FuzzyEvaluator_<T_>>(nThreads, product.BuildFuzzyEvaluator<T_>(max_nested_ifs, eps));
+
+        for (size_t k = 0; k < nInputs; ++k) {
+            const size_t j = input_indices[k];
+            if (j < nParams)
+                model->Parameters()[j]->Seed(k);
+            else
+                for (size_t t = 0; t < nThreads; ++t)
+                    (compiled ? evalStateVector[t].ConstVarVals() : evalVector[t].ConstVarVals())[j - nParams].Seed(k);
+        }
+        model->Init(product.TimeLine(), product.DefLine());
+
+        Vector_<TaskHandle_> futures;
+        const int batchSize = BATCH_SIZE;
+        Vector_<HessianResults_> simResults((n_paths + batchSize - 1) / batchSize, HessianResults_(inputs));
+        int firstPath = 0;
+        int pathsLeft = static_cast<int>(n_paths);
+        size_t loopIndex = 0;
+        auto payoffIndex = product.PayOffIdx();
+        while (pathsLeft > 0) {
+            auto pathsInTask = std::min(pathsLeft, batchSize);
+            auto& batch = simResults[loopIndex];
+            loopIndex += 1;
+            futures.push_back(pool->SpawnTask([&, firstPath, pathsInTask]() {
+                const size_t threadNum = ThreadPool_::ThreadNum();
+                Vector_<>& gaussVec = gaussVectors[threadNum];
+                Scenario_<T_>& path = paths[threadNum];
+                auto& random = rngVector[threadNum];
+                random->SkipTo(firstPath);
+
+                for (size_t i = 0; i < pathsInTask; ++i) {
+                    random->FillNormal(&gaussVec);
+                    model->GeneratePath(gaussVec, &path);
+                    T_ payoff;
+                    if (compiled) {
+                        product.EvaluateCompiled(path, evalStateVector[threadNum]);
+                        payoff = evalStateVector[threadNum].VarVals()[payoffIndex];
+                    } else {
+                        product.Evaluate(path, evalVector[threadNum]);
+                        payoff = evalVector[threadNum].VarVals()[payoffIndex];
+                    }
+                    batch.aggregated_ += payoff.value();
+                    batch.squared_ += payoff.value() * payoff.value();
+                    for (size_t k = 0; k < nInputs; ++k) {
+                        batch.risks_[k] += payoff.Tangent(k) / static_cast<double>(n_paths);
+                        for (size_t l = 0; l < nInputs; ++l)
+                            batch.hessian_(static_cast<int>(k), static_cast<int>(l)) += payoff.Second(k, l) / static_cast<double>(n_paths);
+                    }
+                }
+                batch.nPaths_ = pathsInTask;
+                return true;
+            }));
+            pathsLeft -= pathsInTask;
+            firstPath += pathsInTask;
         }
+
+        //  reduced in batch order, so that the results do not depend on the number of threads
+        HessianResults_ rtn(inputs);
+        for (size_t i = 0; i < futures.size(); ++i) {
+            pool->ActiveWait(futures[i]);
+            const auto& batch = simResults[i];
+            rtn.aggregated_ += batch.aggregated_;
+            rtn.squared_ += batch.squared_;
+            rtn.nPaths_ += batch.nPaths_;
+            for (size_t k = 0; k < nInputs; ++k) {
+                rtn.risks_[k] += batch.risks_[k];
+                for (size_t l = 0; l < nInputs; ++l)
+                    rtn.hessian_(static_cast<int>(k), static_cast<int>(l)) += batch.hessian_(static_cast<int>(k), static_cast<int>(l));
+            }
+        }
+        //  the first error of the tasks is rethrown once none of them is left running on this frame
+        for (auto& future : futures)
+            future.get();
         return rtn;
     }
+
+    //  Second order sensitivities (gamma, vanna, volga by default) from a single simulation, on the paths of MCSimulation
+    //  the inputs are model parameters or constant variables, at most 4 of them: the Hessian is computed forward over forward
+    //  with AAD::Dual2_, whose cost grows with the square of the inputs, not forward over reverse; the derivatives are pathwise,
+    //  so they are only meaningful for payoffs which are smooth in the inputs, or smoothed through eps
+    inline HessianResults_ MCSimulationHessian(const ScriptProduct_& product,
+                                               const Handle_<ModelData_>& model_data,
+                                               size_t n_paths,
+                                               const Vector_<String_>& inputs = {"spot", "vol"},
+                                               const String_& rsg = "sobol",
+                                               bool use_bb = false,
+                                               bool compiled = false,
+                                               int max_nested_ifs = -1,
+                                               double eps = 0.01) {
+        REQUIRE(!inputs.empty() && inputs.size() <= 4, "second order sensitivities take 1 to 4 inputs");
+        std::unique_ptr<AAD::Model_<double>> labels = CreateModel<double>(model_data);
+        labels->Allocate(product.TimeLine(), product.DefLine());
+        const Vector_<String_> names = Vector::Join(labels->ParameterLabels(), product.ConstVarNames());
+        Vector_<size_t> inputIndices;
+        for (const auto& input : inputs) {
+            auto pn = std::find(names.begin(), names.end(), input);
+            REQUIRE(pn != names.end(), "unknown input " + input);
+            inputIndices.push_back(static_cast<size_t>(pn - names.begin()));
+        }
+        if (inputs.size() <= 2)
+            return MCSimulationHessianT<AAD::Dual2_<2>>(product, model_data, inputs, inputIndices, n_paths, rsg, use_bb, compiled, max_nested_ifs, eps);
+        return MCSimulationHessianT<AAD::Dual2_<4>>(product, model_data, inputs, inputIndices, n_paths, rsg, use_bb, compiled, max_nested_ifs, eps);
+    }
 }
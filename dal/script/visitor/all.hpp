@@ -10,8 +10,12 @@
 #include <dal/script/visitor/evaluator.hpp>
 #include <dal/script/visitor/pastevaluator.hpp>
 #include <dal/script/visitor/compiler.hpp>
+#include <dal/script/visitor/batch.hpp>
+#include <dal/script/visitor/register.hpp>
+#include <dal/script/visitor/codegen.hpp>
 #include <dal/script/visitor/fuzzy.hpp>
 #include <dal/script/visitor/domainproc.hpp>
 #include <dal/script/visitor/constcondprocessor.hpp>
 #include <dal/script/visitor/constprocessor.hpp>
 #include <dal/script/visitor/ifprocessor.hpp>
+#include <dal/script/visitor/liveness.hpp>
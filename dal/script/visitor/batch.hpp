@@ -0,0 +1,389 @@
+//
+// Created by wegam on 2024/10/12.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <dal/math/aad/sample.hpp>
+#include <dal/math/vectors.hpp>
+#include <dal/platform/platform.hpp>
+#include <dal/script/visitor/compiler.hpp>
+#include <dal/utilities/exceptions.hpp>
+
+namespace Dal::Script {
+
+    //  Evaluation state for a batch of paths run together through the compiled stream
+    //  variables and work stacks are stored lane-contiguous: slot i of path k sits at [i * width + k]
+    class BatchEvalState_ {
+        size_t width_;
+        Vector_<> variablesInit_;
+        Vector_<> variables_;
+
+        //  Work space
+        Vector_<> dStack_;
+        Vector_<unsigned char> bStack_;
+        int dSp_ = -1;
+        int bSp_ = -1;
+
+        //  One mask per nested if level
+        Vector_<Vector_<unsigned char>> masks_;
+
+    public:
+        static constexpr int STACK_DEPTH = 128;
+
+        BatchEvalState_(const Vector_<>& variables, size_t width)
+            : width_(width), variablesInit_(variables), variables_(variables.size() * width),
+              dStack_(STACK_DEPTH * width), bStack_(STACK_DEPTH * width) {
+            Init();
+        }
+
+        //  Initializer
+        void Init() {
+            for (size_t i = 0; i < variablesInit_.size(); ++i)
+                std::fill(Var(i), Var(i) + width_, variablesInit_[i]);
+            dSp_ = -1;
+            bSp_ = -1;
+        }
+
+        [[nodiscard]] FORCE_INLINE size_t Width() const { return width_; }
+        [[nodiscard]] FORCE_INLINE size_t NumVars() const { return variablesInit_.size(); }
+
+        //  Lane of variable i
+        FORCE_INLINE double* Var(size_t i) { return &variables_[i * width_]; }
+        [[nodiscard]] FORCE_INLINE const double* Var(size_t i) const { return &variables_[i * width_]; }
+
+        //  Number stack, lanes indexed from the top
+        FORCE_INLINE double* PushD() { return &dStack_[++dSp_ * width_]; }
+        FORCE_INLINE double* TopD(int i = 0) { return &dStack_[(dSp_ - i) * width_]; }
+        FORCE_INLINE void PopD(int n = 1) { dSp_ -= n; }
+
+        //  Condition stack
+        FORCE_INLINE unsigned char* PushB() { return &bStack_[++bSp_ * width_]; }
+        FORCE_INLINE unsigned char* TopB(int i = 0) { return &bStack_[(bSp_ - i) * width_]; }
+        FORCE_INLINE void PopB() { --bSp_; }
+
+        //  Mask buffer for nested level `depth`, allocated on first use
+        unsigned char* Mask(size_t depth) {
+            if (depth >= masks_.size())
+                masks_.Resize(depth + 1);
+            if (masks_[depth].size() != width_)
+                masks_[depth].Resize(width_);
+            return &masks_[depth][0];
+        }
+    };
+
+    namespace Batch {
+        template <class OP_> FORCE_INLINE void Binary(BatchEvalState_& state, OP_ op) {
+            const size_t w = state.Width();
+            double* x = state.TopD(1);
+            const double* y = state.TopD();
+            for (size_t k = 0; k < w; ++k)
+                x[k] = op(x[k], y[k]);
+            state.PopD();
+        }
+
+        template <class OP_> FORCE_INLINE void Unary(BatchEvalState_& state, OP_ op) {
+            const size_t w = state.Width();
+            double* x = state.TopD();
+            for (size_t k = 0; k < w; ++k)
+                x[k] = op(x[k]);
+        }
+
+        template <class OP_> FORCE_INLINE void Condition(BatchEvalState_& state, OP_ op) {
+            const size_t w = state.Width();
+            const double* x = state.TopD();
+            unsigned char* b = state.PushB();
+            for (size_t k = 0; k < w; ++k)
+                b[k] = op(x[k]);
+            state.PopD();
+        }
+
+        //  Write src into dst on the lanes where mask is set, all lanes when mask is null
+        FORCE_INLINE void Store(double* dst, const double* src, const unsigned char* mask, size_t w) {
+            if (mask) {
+                for (size_t k = 0; k < w; ++k)
+                    dst[k] = mask[k] ? src[k] : dst[k];
+            } else
+                std::copy(src, src + w, dst);
+        }
+
+        //  Combine the enclosing mask with a condition, return whether any lane is left active
+        FORCE_INLINE bool Restrict(unsigned char* dst, const unsigned char* cond, const unsigned char* mask, size_t w) {
+            unsigned char any = 0;
+            for (size_t k = 0; k < w; ++k) {
+                dst[k] = cond[k] && (!mask || mask[k]);
+                any |= dst[k];
+            }
+            return any;
+        }
+
+        inline void Eval(const Vector_<int>& nodeStream,
+                         const Vector_<double>& constStream,
+                         const AAD::BatchSample_& scenario,
+                         BatchEvalState_& state,
+                         const unsigned char* mask,
+                         size_t depth,
+                         size_t first,
+                         size_t last) {
+            const size_t w = state.Width();
+            size_t i = first;
+            double c;
+            double* x;
+            const double* y;
+            unsigned char* b;
+            size_t idx;
+
+            //  Loop on instructions
+            while (i < last) {
+                //  Big switch
+                switch (nodeStream[i]) {
+                case Add:
+                    Binary(state, [](double l, double r) { return l + r; });
+                    ++i;
+                    break;
+                case AddConst:
+                    c = constStream[nodeStream[++i]];
+                    Unary(state, [c](double l) { return l + c; });
+                    ++i;
+                    break;
+                case Sub:
+                    Binary(state, [](double l, double r) { return l - r; });
+                    ++i;
+                    break;
+                case SubConst:
+                    c = constStream[nodeStream[++i]];
+                    Unary(state, [c](double l) { return l - c; });
+                    ++i;
+                    break;
+                case ConstSub:
+                    c = constStream[nodeStream[++i]];
+                    Unary(state, [c](double r) { return c - r; });
+                    ++i;
+                    break;
+                case Multi:
+                    Binary(state, [](double l, double r) { return l * r; });
+                    ++i;
+                    break;
+                case MultiConst:
+                    c = constStream[nodeStream[++i]];
+                    Unary(state, [c](double l) { return l * c; });
+                    ++i;
+                    break;
+                case Div:
+                    Binary(state, [](double l, double r) { return l / r; });
+                    ++i;
+                    break;
+                case DivConst:
+                    c = constStream[nodeStream[++i]];
+                    Unary(state, [c](double l) { return l / c; });
+                    ++i;
+                    break;
+                case ConstDiv:
+                    c = constStream[nodeStream[++i]];
+                    Unary(state, [c](double r) { return c / r; });
+                    ++i;
+                    break;
+                case Pow:
+                    Binary(state, [](double l, double r) { return std::pow(l, r); });
+                    ++i;
+                    break;
+                case PowConst:
+                    c = constStream[nodeStream[++i]];
+                    Unary(state, [c](double l) { return std::pow(l, c); });
+                    ++i;
+                    break;
+                case ConstPow:
+                    c = constStream[nodeStream[++i]];
+                    Unary(state, [c](double r) { return std::pow(c, r); });
+                    ++i;
+                    break;
+                case Max2:
+                    Binary(state, [](double l, double r) { return r > l ? r : l; });
+                    ++i;
+                    break;
+                case Max2Const:
+                    c = constStream[nodeStream[++i]];
+                    Unary(state, [c](double l) { return c > l ? c : l; });
+                    ++i;
+                    break;
+                case Min2:
+                    Binary(state, [](double l, double r) { return r < l ? r : l; });
+                    ++i;
+                    break;
+                case Min2Const:
+                    c = constStream[nodeStream[++i]];
+                    Unary(state, [c](double l) { return c < l ? c : l; });
+                    ++i;
+                    break;
+                case Spot:
+                    x = state.PushD();
+                    std::copy(scenario.spot_.begin(), scenario.spot_.begin() + w, x);
+                    ++i;
+                    break;
+                case Var:
+                    x = state.PushD();
+                    y = state.Var(nodeStream[++i]);
+                    std::copy(y, y + w, x);
+                    ++i;
+                    break;
+                case ConstVar:
+                case Const:
+                    x = state.PushD();
+                    std::fill(x, x + w, constStream[nodeStream[++i]]);
+                    ++i;
+                    break;
+                case Assign:
+                    idx = nodeStream[++i];
+                    Store(state.Var(idx), state.TopD(), mask, w);
+                    state.PopD();
+                    ++i;
+                    break;
+                case AssignConst:
+                    c = constStream[nodeStream[++i]];
+                    idx = nodeStream[++i];
+                    x = state.Var(idx);
+                    for (size_t k = 0; k < w; ++k)
+                        x[k] = !mask || mask[k] ? c : x[k];
+                    ++i;
+                    break;
+                case Pays:
+                    idx = nodeStream[++i];
+                    x = state.Var(idx);
+                    y = state.TopD();
+                    for (size_t k = 0; k < w; ++k)
+                        x[k] = !mask || mask[k] ? x[k] + y[k] / scenario.numeraire_[k] : x[k];
+                    state.PopD();
+                    ++i;
+                    break;
+                case PaysConst:
+                    c = constStream[nodeStream[++i]];
+                    idx = nodeStream[++i];
+                    x = state.Var(idx);
+                    for (size_t k = 0; k < w; ++k)
+                        x[k] = !mask || mask[k] ? x[k] + c / scenario.numeraire_[k] : x[k];
+                    ++i;
+                    break;
+                case If: {
+                    unsigned char* m = state.Mask(depth);
+                    const bool any = Restrict(m, state.TopB(), mask, w);
+                    state.PopB();
+                    //  Skip the statements when no path takes the branch
+                    if (any)
+                        Eval(nodeStream, constStream, scenario, state, m, depth + 1, i + 2, nodeStream[i + 1]);
+                    i = nodeStream[i + 1];
+                    break;
+                }
+                case IfElse: {
+                    unsigned char* m = state.Mask(depth);
+                    const bool anyTrue = Restrict(m, state.TopB(), mask, w);
+                    state.PopB();
+                    if (anyTrue)
+                        Eval(nodeStream, constStream, scenario, state, m, depth + 1, i + 3, nodeStream[i + 1]);
+                    //  Lanes of the else branch: active in the enclosing mask but not in the if-true mask
+                    m = state.Mask(depth);
+                    unsigned char anyFalse = 0;
+                    for (size_t k = 0; k < w; ++k) {
+                        m[k] = !m[k] && (!mask || mask[k]);
+                        anyFalse |= m[k];
+                    }
+                    if (anyFalse)
+                        Eval(nodeStream, constStream, scenario, state, m, depth + 1, nodeStream[i + 1], nodeStream[i + 2]);
+                    i = nodeStream[i + 2];
+                    break;
+                }
+                case Equal:
+                    Condition(state, [](double v) { return v == 0; });
+                    ++i;
+                    break;
+                case Sup:
+                    Condition(state, [](double v) { return v > 0; });
+                    ++i;
+                    break;
+                case SupEqual:
+                    Condition(state, [](double v) { return v >= 0; });
+                    ++i;
+                    break;
+                case And:
+                    b = state.TopB(1);
+                    for (size_t k = 0; k < w; ++k)
+                        b[k] = b[k] && state.TopB()[k];
+                    state.PopB();
+                    ++i;
+                    break;
+                case Or:
+                    b = state.TopB(1);
+                    for (size_t k = 0; k < w; ++k)
+                        b[k] = b[k] || state.TopB()[k];
+                    state.PopB();
+                    ++i;
+                    break;
+                case Smooth: {
+                    //  Arguments: condition, value if true, value if false, smoothing factor
+                    const double* cond = state.TopD(3);
+                    const double* vTrue = state.TopD(2);
+                    const double* vFalse = state.TopD(1);
+                    const double* eps = state.TopD();
+                    double* out = state.TopD(3);
+                    for (size_t k = 0; k < w; ++k) {
+                        const double half = 0.5 * eps[k];
+                        const double x0 = cond[k];
+                        out[k] = x0 < -half ? vFalse[k] : (x0 > half ? vTrue[k] : vFalse[k] + 0.5 * (vTrue[k] - vFalse[k]) / half * (x0 + half));
+                    }
+                    state.PopD(3);
+                    ++i;
+                    break;
+                }
+                case Sqrt:
+                    Unary(state, [](double v) { return std::sqrt(v); });
+                    ++i;
+                    break;
+                case Log:
+                    Unary(state, [](double v) { return std::log(v); });
+                    ++i;
+                    break;
+                case Exp:
+                    Unary(state, [](double v) { return std::exp(v); });
+                    ++i;
+                    break;
+                case Not:
+                    b = state.TopB();
+                    for (size_t k = 0; k < w; ++k)
+                        b[k] = !b[k];
+                    ++i;
+                    break;
+                case UMinus:
+                    Unary(state, [](double v) { return -v; });
+                    ++i;
+                    break;
+                case True:
+                    b = state.PushB();
+                    std::fill(b, b + w, 1);
+                    ++i;
+                    break;
+                case False:
+                    b = state.PushB();
+                    std::fill(b, b + w, 0);
+                    ++i;
+                    break;
+                default:
+                    THROW("instruction not supported in batched evaluation");
+                }
+            }
+        }
+    } // namespace Batch
+
+    //  Batch counterpart of EvalCompiled: each instruction is executed over all the paths of the batch at once
+    //  control flow is handled with lane masks, so the results per path are identical to EvalCompiled
+    inline void EvalCompiledBatch(
+        //  Stream to eval
+        const Vector_<int>& nodeStream,
+        const Vector_<double>& constStream,
+        //  Scenario
+        const AAD::BatchSample_& scenario,
+        //  State
+        BatchEvalState_& state) {
+        Batch::Eval(nodeStream, constStream, scenario, state, nullptr, 0, 0, nodeStream.size());
+    }
+} // namespace Dal::Script
@@ -0,0 +1,159 @@
+//
+// Created by wegam on 2024/11/18.
+//
+
+#pragma once
+
+#include <cmath>
+#include <cstdio>
+#include <dal/math/stacks.hpp>
+#include <dal/platform/platform.hpp>
+#include <dal/script/node.hpp>
+#include <dal/script/visitor.hpp>
+#include <dal/utilities/exceptions.hpp>
+
+namespace Dal::Script {
+    //  Writes the statements of an event as C++ templated on the number type T_
+    //  follows the choices of Compiler_ (constants folded, the constant on the right of max and min)
+    //  so the generated code computes what the non-fuzzy compiled stream does
+    //  the code reads the sample as s and the variables as v
+    class CodeGenerator_ : public ConstVisitor_<CodeGenerator_> {
+        String_ code_;
+        String_ indent_;
+        Stack_<String_> exprs_;
+
+        void Line(const String_& line) { code_ += indent_ + line + '\n'; }
+
+        String_ Expr(const Node_& node) {
+            node.Accept(*this);
+            String_ retval = std::move(exprs_.Top());
+            exprs_.Pop();
+            return retval;
+        }
+
+        String_ Operand(const std::unique_ptr<Node_>& arg) {
+            const auto* expr = Downcast<ExprNode_>(arg);
+            return expr->isConst_ ? Literal(expr->constVal_) : Expr(*arg);
+        }
+
+        void VisitBinary(const ExprNode_& node, const String_& op) {
+            if (node.isConst_)
+                exprs_.Push(Literal(node.constVal_));
+            else
+                exprs_.Push("(" + Operand(node.arguments_[0]) + " " + op + " " + Operand(node.arguments_[1]) + ")");
+        }
+
+        void VisitFunction(const ExprNode_& node, const String_& func) {
+            if (node.isConst_)
+                exprs_.Push(Literal(node.constVal_));
+            else if (node.arguments_.size() == 1)
+                exprs_.Push(func + "(" + Expr(*node.arguments_[0]) + ")");
+            else
+                exprs_.Push(func + "(" + Operand(node.arguments_[0]) + ", " + Operand(node.arguments_[1]) + ")");
+        }
+
+        //  the compiled stream compares a constant with the other argument, whichever side it comes from
+        void VisitSelect(const ExprNode_& node, const String_& func) {
+            const auto* lhs = Downcast<ExprNode_>(node.arguments_[0]);
+            if (!node.isConst_ && lhs->isConst_)
+                exprs_.Push(func + "(" + Expr(*node.arguments_[1]) + ", " + Literal(lhs->constVal_) + ")");
+            else
+                VisitFunction(node, func);
+        }
+
+        template <class OP_> void VisitCondition(const BoolNode_& node, const String_& op, OP_ fold) {
+            const auto* arg = Downcast<ExprNode_>(node.arguments_[0]);
+            if (arg->isConst_)
+                exprs_.Push(fold(arg->constVal_) ? "true" : "false");
+            else
+                exprs_.Push("(" + Expr(*node.arguments_[0]) + " " + op + " 0.0)");
+        }
+
+        String_ Variable(const std::unique_ptr<Node_>& arg) const {
+            return "v[" + String_(std::to_string(Downcast<NodeVar_>(arg)->index_)) + "]";
+        }
+
+    public:
+        using ConstVisitor_<CodeGenerator_>::Visit;
+
+        explicit CodeGenerator_(String_ indent = String_()) : indent_(std::move(indent)) {}
+
+        [[nodiscard]] const String_& Code() const { return code_; }
+
+        //  Exact and always a double, so that no overload on int is picked
+        static String_ Literal(double val) {
+            REQUIRE(std::isfinite(val), "generated code only takes finite constants");
+            char buf[32];
+            std::snprintf(buf, sizeof(buf), "%.17g", val);
+            String_ retval(buf);
+            if (retval.find_first_of(".e") == String_::npos)
+                retval += ".0";
+            return val < 0.0 ? "(" + retval + ")" : retval;
+        }
+
+        //  Expressions
+
+        void Visit(const NodeAdd_& node) { VisitBinary(node, "+"); }
+        void Visit(const NodeSub_& node) { VisitBinary(node, "-"); }
+        void Visit(const NodeMulti_& node) { VisitBinary(node, "*"); }
+        void Visit(const NodeDiv_& node) { VisitBinary(node, "/"); }
+        void Visit(const NodePow_& node) { VisitFunction(node, "pow"); }
+        void Visit(const NodeMax_& node) { VisitSelect(node, "Generated::Max2<T_>"); }
+        void Visit(const NodeMin_& node) { VisitSelect(node, "Generated::Min2<T_>"); }
+
+        void Visit(const NodeUPlus_& node) { exprs_.Push(Expr(*node.arguments_[0])); }
+        void Visit(const NodeUMinus_& node) { VisitFunction(node, "-"); }
+        void Visit(const NodeLog_& node) { VisitFunction(node, "log"); }
+        void Visit(const NodeSqrt_& node) { VisitFunction(node, "sqrt"); }
+        void Visit(const NodeExp_& node) { VisitFunction(node, "exp"); }
+
+        //  Conditions
+
+        void Visit(const NodeEqual_& node) { VisitCondition(node, "==", [](double x) { return x == 0.0; }); }
+        void Visit(const NodeSup_& node) { VisitCondition(node, ">", [](double x) { return x > 0.0; }); }
+        void Visit(const NodeSupEqual_& node) { VisitCondition(node, ">=", [](double x) { return x > -Dal::EPSILON; }); }
+
+        void Visit(const NodeAnd_& node) { exprs_.Push("(" + Expr(*node.arguments_[0]) + " && " + Expr(*node.arguments_[1]) + ")"); }
+        void Visit(const NodeOr_& node) { exprs_.Push("(" + Expr(*node.arguments_[0]) + " || " + Expr(*node.arguments_[1]) + ")"); }
+        void Visit(const NodeNot_& node) { exprs_.Push("!" + Expr(*node.arguments_[0])); }
+        void Visit(const NodeTrue_&) { exprs_.Push("true"); }
+        void Visit(const NodeFalse_&) { exprs_.Push("false"); }
+
+        //  Leaves
+
+        void Visit(const NodeSpot_&) { exprs_.Push("s.spot_"); }
+        void Visit(const NodeVar_& node) { exprs_.Push("v[" + String_(std::to_string(node.index_)) + "]"); }
+        void Visit(const NodeConst_& node) { exprs_.Push(Literal(node.constVal_)); }
+        void Visit(const NodeConstVar_& node) { exprs_.Push(Literal(node.constVal_)); }
+
+        //  Statements
+
+        void Visit(const NodeAssign_& node) {
+            const auto* rhs = Downcast<ExprNode_>(node.arguments_[1]);
+            Line(Variable(node.arguments_[0]) + " = " + (rhs->isConst_ ? "T_(" + Literal(rhs->constVal_) + ")" : Expr(*node.arguments_[1])) + ";");
+        }
+
+        void Visit(const NodePays_& node) {
+            const auto* rhs = Downcast<ExprNode_>(node.arguments_[1]);
+            Line(Variable(node.arguments_[0]) + " += " + (rhs->isConst_ ? "T_(" + Literal(rhs->constVal_) + ")" : Expr(*node.arguments_[1])) +
+                 " / s.numeraire_;");
+        }
+
+        void Visit(const NodeIf_& node) {
+            Line("if (" + Expr(*node.arguments_[0]) + ") {");
+            indent_ += "    ";
+            const auto lastTrue = node.firstElse_ == -1 ? node.arguments_.size() - 1 : node.firstElse_ - 1;
+            for (size_t i = 1; i <= lastTrue; ++i)
+                node.arguments_[i]->Accept(*this);
+            indent_.resize(indent_.size() - 4);
+            if (node.firstElse_ != -1) {
+                Line("} else {");
+                indent_ += "    ";
+                for (size_t i = node.firstElse_; i < node.arguments_.size(); ++i)
+                    node.arguments_[i]->Accept(*this);
+                indent_.resize(indent_.size() - 4);
+            }
+            Line("}");
+        }
+    };
+} // namespace Dal::Script
@@ -23,6 +23,7 @@ As long as this comment is preserved at the Top of the file
 #include <dal/math/stacks.hpp>
 #include <dal/script/node.hpp>
 #include <dal/script/visitor.hpp>
+#include <dal/script/visitor/fuzzy.hpp>
 
 /*IF--------------------------------------------------------------------------
 enumeration NodeType
@@ -76,6 +77,10 @@ namespace Dal::Script {
         Vector_<> variablesInit_;
         Vector_<T_> constVariables_;
 
+        //  Fuzzy evaluation: default smoothing factor and storage for the variables affected by fuzzy ifs
+        double defEps_ = 0.0;
+        Vector_<T_> fuzzyStore_;
+
         //  Constructor
         explicit EvalState_(const Vector_<>& variables, const Vector_<T_>& const_variables = Vector_<T_>())
             : variablesInit_(variables), constVariables_(const_variables) {
@@ -98,6 +103,9 @@ namespace Dal::Script {
         const Vector_<T_>& ConstVarVals() const {
             return constVariables_;
         }
+
+        // (Re)set default smoothing factor
+        void SetDefEps(double defEps) { defEps_ = defEps; }
     };
 
     enum NodeType_ {
@@ -140,7 +148,18 @@ namespace Dal::Script {
         UMinus = 36,
         True = 37,
         False = 38,
-        ConstVar = 39
+        ConstVar = 39,
+        //  Fuzzy counterparts, degrees of truth are kept on a number stack
+        FuzzyEqual = 40,
+        FuzzyEqualDiscrete = 41,
+        FuzzySup = 42,
+        FuzzySupDiscrete = 43,
+        FuzzyAnd = 44,
+        FuzzyOr = 45,
+        FuzzyNot = 46,
+        FuzzyTrue = 47,
+        FuzzyFalse = 48,
+        FuzzyIf = 49
     };
 
     class Compiler_ : public ConstVisitor_<Compiler_> {
@@ -149,8 +168,13 @@ namespace Dal::Script {
         Vector_<double> constStream_;
         Vector_<const void*> dataStream_;
 
+        //  Emit the fuzzy instructions for conditions and ifs, relies on the fuzzy domain processing
+        bool fuzzy_;
+
     public:
         using ConstVisitor_<Compiler_>::Visit;
+
+        explicit Compiler_(bool fuzzy = false) : fuzzy_(fuzzy) {}
         // Accessors
         // Access the streams after traversal
         [[nodiscard]] const Vector_<int>& NodeStream() const { return nodeStream_; }
@@ -229,15 +253,40 @@ namespace Dal::Script {
             }
         }
 
+        //  Fuzzy conditions are not folded: a constant close to 0 still has a fuzzy degree of truth
+        //  followed by the smoothing factor, or by the left and right bounds when discrete
+        template <NodeType_ NT, NodeType_ NT_DISCRETE> void VisitFuzzyCondition(const CompNode_& node) {
+            node.arguments_[0]->Accept(*this);
+            if (node.isDiscrete_) {
+                nodeStream_.emplace_back(NT_DISCRETE);
+                nodeStream_.emplace_back(int(constStream_.size()));
+                constStream_.emplace_back(node.lb_);
+                constStream_.emplace_back(node.rb_);
+            } else {
+                nodeStream_.emplace_back(NT);
+                nodeStream_.emplace_back(int(constStream_.size()));
+                constStream_.emplace_back(node.eps_);
+            }
+        }
+
         void Visit(const NodeEqual_& node) {
-            VisitCondition<Equal>(node, [](double x) { return x == 0.0; });
+            if (fuzzy_)
+                VisitFuzzyCondition<FuzzyEqual, FuzzyEqualDiscrete>(node);
+            else
+                VisitCondition<Equal>(node, [](double x) { return x == 0.0; });
         }
 
         void Visit(const NodeSup_& node) {
-            VisitCondition<Sup>(node, [](double x) { return x > 0.0; });
+            if (fuzzy_)
+                VisitFuzzyCondition<FuzzySup, FuzzySupDiscrete>(node);
+            else
+                VisitCondition<Sup>(node, [](double x) { return x > 0.0; });
         }
         void Visit(const NodeSupEqual_& node) {
-            VisitCondition<SupEqual>(node, [](double x) { return x > -Dal::EPSILON; });
+            if (fuzzy_)
+                VisitFuzzyCondition<FuzzySup, FuzzySupDiscrete>(node);
+            else
+                VisitCondition<SupEqual>(node, [](double x) { return x > -Dal::EPSILON; });
         }
 
         //  And/Or/Not
@@ -245,18 +294,18 @@ namespace Dal::Script {
         void Visit(const NodeAnd_& node) {
             node.arguments_[0]->Accept(*this);
             node.arguments_[1]->Accept(*this);
-            nodeStream_.emplace_back(And);
+            nodeStream_.emplace_back(fuzzy_ ? FuzzyAnd : And);
         }
 
         void Visit(const NodeOr_& node) {
             node.arguments_[0]->Accept(*this);
             node.arguments_[1]->Accept(*this);
-            nodeStream_.emplace_back(Or);
+            nodeStream_.emplace_back(fuzzy_ ? FuzzyOr : Or);
         }
 
         void Visit(const NodeNot_& node) {
             node.arguments_[0]->Accept(*this);
-            nodeStream_.emplace_back(Not);
+            nodeStream_.emplace_back(fuzzy_ ? FuzzyNot : Not);
         }
 
         //  Assign, pays
@@ -310,15 +359,43 @@ namespace Dal::Script {
             constStream_.emplace_back(node.constVal_);
         }
 
-        void Visit(const NodeTrue_&) { nodeStream_.emplace_back(True); }
+        void Visit(const NodeTrue_&) { nodeStream_.emplace_back(fuzzy_ ? FuzzyTrue : True); }
 
-        void Visit(const NodeFalse_&) { nodeStream_.emplace_back(False); }
+        void Visit(const NodeFalse_&) { nodeStream_.emplace_back(fuzzy_ ? FuzzyFalse : False); }
 
         // Scenario related
         void Visit(const NodeSpot_&) { nodeStream_.emplace_back(Spot); }
 
         // Instructions
+        //  Fuzzy if: last if-true, last if-false, number of affected variables and their indices, then the statements
+        void VisitFuzzyIf(const NodeIf_& node) {
+            node.arguments_[0]->Accept(*this);
+
+            nodeStream_.emplace_back(FuzzyIf);
+            const size_t thisSpace = nodeStream_.size() - 1;
+            nodeStream_.emplace_back(0);
+            nodeStream_.emplace_back(0);
+            nodeStream_.emplace_back(int(node.affectedVars_.size()));
+            for (auto idx : node.affectedVars_)
+                nodeStream_.emplace_back(int(idx));
+
+            const auto lastTrue = node.firstElse_ == -1 ? node.arguments_.size() - 1 : node.firstElse_ - 1;
+            for (size_t i = 1; i <= lastTrue; ++i)
+                node.arguments_[i]->Accept(*this);
+            nodeStream_[thisSpace + 1] = int(nodeStream_.size());
+
+            if (node.firstElse_ != -1)
+                for (size_t i = node.firstElse_; i < node.arguments_.size(); ++i)
+                    node.arguments_[i]->Accept(*this);
+            nodeStream_[thisSpace + 2] = int(nodeStream_.size());
+        }
+
         void Visit(const NodeIf_& node) {
+            if (fuzzy_) {
+                VisitFuzzyIf(node);
+                return;
+            }
+
             //  Visit condition
             node.arguments_[0]->Accept(*this);
 
@@ -370,13 +447,18 @@ namespace Dal::Script {
 
         //  Work space
         T_ x, y, z, t;
+        double eps;
         size_t idx;
 
-        //  Stacks
-        thread_local  static StaticStack_<T_> dStack;
-        dStack.Reset();
+        //  Stacks, shared with the nested calls evaluating the statements of ifs
+        thread_local static StaticStack_<T_> dStack;
         thread_local static StaticStack_<bool> bStack;
-        bStack.Reset();
+        thread_local static StaticStack_<T_> fStack;
+        if (!last) {
+            dStack.Reset();
+            bStack.Reset();
+            fStack.Reset();
+        }
 
         //  Loop on instructions
         while (i < n) {
@@ -512,14 +594,13 @@ namespace Dal::Script {
                 bStack.Pop();
                 break;
             case IfElse:
-                if (!bStack.Top()) {
+                if (!bStack.TopAndPop()) {
                     i = nodeStream[++i];
                 } else {
                     //  Cannot avoid nested call here
                     EvalCompiled(nodeStream, constStream, dataStream, scenario, state, i + 3, nodeStream[i + 1]);
                     i = nodeStream[i + 2];
                 }
-                bStack.Pop();
                 break;
             case Equal:
                 bStack.Push(dStack.TopAndPop() == 0);
@@ -557,7 +638,7 @@ namespace Dal::Script {
                 if (x < -y)
                     dStack.Top() = t;
                 // Right
-                if (x < -y)
+                else if (x > y)
                     dStack.Top() = z;
 
                 // Fuzzy
@@ -593,6 +674,81 @@ namespace Dal::Script {
                 bStack.Push(false);
                 ++i;
                 break;
+            case FuzzyEqual:
+                eps = constStream[nodeStream[++i]];
+                fStack.Push(BFly(dStack.TopAndPop(), eps < 0 ? state.defEps_ : eps));
+                ++i;
+                break;
+            case FuzzyEqualDiscrete:
+                idx = nodeStream[++i];
+                fStack.Push(BFly(dStack.TopAndPop(), constStream[idx], constStream[idx + 1]));
+                ++i;
+                break;
+            case FuzzySup:
+                eps = constStream[nodeStream[++i]];
+                fStack.Push(CSpr(dStack.TopAndPop(), eps < 0 ? state.defEps_ : eps));
+                ++i;
+                break;
+            case FuzzySupDiscrete:
+                idx = nodeStream[++i];
+                fStack.Push(CSpr(dStack.TopAndPop(), constStream[idx], constStream[idx + 1]));
+                ++i;
+                break;
+            case FuzzyAnd:
+                y = fStack.TopAndPop();
+                fStack.Top() = y * fStack.Top();
+                ++i;
+                break;
+            case FuzzyOr:
+                y = fStack.TopAndPop();
+                x = fStack.TopAndPop();
+                fStack.Push(y + x - y * x);
+                ++i;
+                break;
+            case FuzzyNot:
+                fStack.Top() = 1.0 - fStack.Top();
+                ++i;
+                break;
+            case FuzzyTrue:
+                fStack.Push(1.0);
+                ++i;
+                break;
+            case FuzzyFalse:
+                fStack.Push(0.0);
+                ++i;
+                break;
+            case FuzzyIf: {
+                const T_ dt = fStack.TopAndPop();
+                const size_t lastTrue = nodeStream[i + 1];
+                const size_t lastFalse = nodeStream[i + 2];
+                const size_t nAffected = nodeStream[i + 3];
+                const int* affected = &nodeStream[i + 4];
+                const size_t firstTrue = i + 4 + nAffected;
+                //  Absolutely true or false: only one branch
+                if (dt > 1.0 - EPSILON)
+                    EvalCompiled(nodeStream, constStream, dataStream, scenario, state, firstTrue, lastTrue);
+                else if (dt < EPSILON)
+                    EvalCompiled(nodeStream, constStream, dataStream, scenario, state, lastTrue, lastFalse);
+                //  Fuzzy: both branches, affected variables set to the average weighted by the degree of truth
+                else {
+                    auto& store = state.fuzzyStore_;
+                    const size_t base = store.size();
+                    store.Resize(base + 2 * nAffected);
+                    for (size_t k = 0; k < nAffected; ++k)
+                        store[base + k] = state.variables_[affected[k]];
+                    EvalCompiled(nodeStream, constStream, dataStream, scenario, state, firstTrue, lastTrue);
+                    for (size_t k = 0; k < nAffected; ++k) {
+                        store[base + nAffected + k] = state.variables_[affected[k]];
+                        state.variables_[affected[k]] = store[base + k];
+                    }
+                    EvalCompiled(nodeStream, constStream, dataStream, scenario, state, lastTrue, lastFalse);
+                    for (size_t k = 0; k < nAffected; ++k)
+                        state.variables_[affected[k]] = dt * store[base + nAffected + k] + (1.0 - dt) * state.variables_[affected[k]];
+                    store.Resize(base);
+                }
+                i = lastFalse;
+                break;
+            }
             }
         }
     }
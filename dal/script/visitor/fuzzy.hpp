@@ -116,13 +116,13 @@ namespace Dal::Script {
         }
 
         FuzzyEvaluator_(FuzzyEvaluator_&& rhs) noexcept
-            : Base(move(rhs)), defEps_(rhs.defEps_), varStore0_(move(rhs.varStore0_)), varStore1_(move(rhs.varStore1_)),
+            : Base(std::move(rhs)), defEps_(rhs.defEps_), varStore0_(std::move(rhs.varStore0_)), varStore1_(std::move(rhs.varStore1_)),
               nestedIfLvl_(0) {}
         FuzzyEvaluator_& operator = (FuzzyEvaluator_&& rhs) noexcept {
-            Base::operator=(move(rhs));
+            Base::operator=(std::move(rhs));
             defEps_ = rhs.defEps_;
-            varStore0_ = move(rhs.varStore0_);
-            varStore1_ = move(rhs.varStore1_);
+            varStore0_ = std::move(rhs.varStore0_);
+            varStore1_ = std::move(rhs.varStore1_);
             nestedIfLvl_ = 0;
             return *this;
         }
@@ -239,7 +239,7 @@ namespace Dal::Script {
         FORCE_INLINE void Visit(const NodeSupEqual_& node) { VisitComp(node); }
 
         // Negation
-        FORCE_INLINE void visitNot(const NodeNot_& node) {
+        FORCE_INLINE void Visit(const NodeNot_& node) {
             VisitNode(*node.arguments_[0]);
             fuzzyStack_.Top() = 1.0 - fuzzyStack_.Top();
         }
@@ -0,0 +1,113 @@
+//
+// Created by wegam on 2024/11/20.
+//
+
+#pragma once
+
+#include <set>
+#include <utility>
+#include <dal/platform/platform.hpp>
+#include <dal/script/node.hpp>
+#include <dal/script/visitor.hpp>
+#include <dal/script/visitor/debugger.hpp>
+
+namespace Dal::Script {
+
+    // Liveness processor
+    // Sweeps the statements backward from the end of the script, keeping the set of variables whose value is still read
+    // An assignment or a payment to a variable that is not live is dead and removed, so is an if left without statements
+    // Variables must have been indexed, and the sweep must visit events from the last one to the first one
+    // Removed statements are kept in the functional form of the debugger
+
+    class LivenessProcessor_ : public Visitor_<LivenessProcessor_> {
+        // Indices of the variables live at the current point of the sweep
+        std::set<size_t> live_;
+
+        // Set when the statement just visited is dead
+        bool dead_ = false;
+
+        Vector_<String_> removed_;
+
+        void Remove(const Node_& node) {
+            Debugger_ d;
+            node.Accept(d);
+            removed_.push_back(d.String());
+            dead_ = true;
+        }
+
+        // Sweep the statements in [begin, end) backward, erase the dead ones and return the number left
+        size_t Sweep(Vector_<ExprTree_>& stats, size_t begin, size_t end) {
+            size_t left = end - begin;
+            for (size_t i = end; i > begin; --i) {
+                dead_ = false;
+                stats[i - 1]->Accept(*this);
+                if (dead_) {
+                    stats.erase(stats.begin() + static_cast<std::ptrdiff_t>(i - 1));
+                    --left;
+                }
+            }
+            dead_ = false;
+            return left;
+        }
+
+    public:
+        using Visitor_<LivenessProcessor_>::Visit;
+
+        // Variables read after the script, e.g. the payoff
+        explicit LivenessProcessor_(std::set<size_t> live) : live_(std::move(live)) {}
+
+        void ProcessEvent(Event_& event) { Sweep(event, 0, event.size()); }
+
+        [[nodiscard]] const std::set<size_t>& Live() const { return live_; }
+        [[nodiscard]] const Vector_<String_>& Removed() const { return removed_; }
+
+        // Statements
+
+        void Visit(NodeAssign_& node) {
+            // The assignment kills the variable, then the rhs makes its own variables live
+            if (!live_.erase(Downcast<NodeVar_>(node.arguments_[0])->index_))
+                Remove(node);
+            else
+                node.arguments_[1]->Accept(*this);
+        }
+
+        void Visit(NodePays_& node) {
+            // Payments accumulate, the variable stays live
+            if (!live_.count(Downcast<NodeVar_>(node.arguments_[0])->index_))
+                Remove(node);
+            else
+                node.arguments_[1]->Accept(*this);
+        }
+
+        void Visit(NodeIf_& node) {
+            const auto liveAfter = live_;
+            const size_t lastTrueStat = node.firstElse_ == -1 ? node.arguments_.size() - 1 : node.firstElse_ - 1;
+
+            // Else statements first, erasing them leaves the if-true statements in place
+            size_t nElse = 0;
+            if (node.firstElse_ != -1)
+                nElse = Sweep(node.arguments_, node.firstElse_, node.arguments_.size());
+            const auto liveElse = std::move(live_);
+
+            live_ = liveAfter;
+            const size_t nTrue = Sweep(node.arguments_, 1, lastTrueStat + 1);
+            node.firstElse_ = nElse ? static_cast<int>(nTrue + 1) : -1;
+
+            if (!nTrue && !nElse) {
+                live_ = liveAfter;
+                dead_ = true;
+                return;
+            }
+
+            // Live before the if: live before either branch, plus the variables read by the condition
+            live_.insert(liveElse.begin(), liveElse.end());
+            node.arguments_[0]->Accept(*this);
+        }
+
+        void Visit(NodeCollect_& node) { dead_ = !Sweep(node.arguments_, 0, node.arguments_.size()); }
+
+        // Expressions
+
+        void Visit(NodeVar_& node) { live_.insert(node.index_); }
+    };
+} // namespace Dal::Script
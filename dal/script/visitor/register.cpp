@@ -0,0 +1,329 @@
+//
+// Created by wegam on 2024/11/17.
+//
+
+#include <algorithm>
+#include <dal/platform/platform.hpp>
+#include <dal/script/visitor/all.hpp>
+
+namespace Dal::Script {
+    namespace {
+        //  Value waiting on the translation stack, loaded in the register of its depth only when an instruction needs it
+        //  so that leaves and the product of a variable by a constant can be fused in the instruction consuming them
+        struct Operand_ {
+            enum Kind_ { REGISTER, VARIABLE, SPOT, CONSTANT, SCALED_VARIABLE };
+            Kind_ kind_;
+            int idx_;
+            double const_;
+        };
+
+        RegOp_ RegOfConstOp(int op) {
+            switch (op) {
+            case AddConst:
+                return RegAddConst;
+            case SubConst:
+                return RegSubConst;
+            case ConstSub:
+                return RegConstSub;
+            case MultiConst:
+                return RegMultiConst;
+            case DivConst:
+                return RegDivConst;
+            case ConstDiv:
+                return RegConstDiv;
+            case PowConst:
+                return RegPowConst;
+            case ConstPow:
+                return RegConstPow;
+            case Max2Const:
+                return RegMax2Const;
+            default:
+                return RegMin2Const;
+            }
+        }
+
+        class Translator_ {
+            const Vector_<int>& nodes_;
+            const Vector_<double>& consts_;
+            RegProgram_ program_;
+            Vector_<Operand_> operands_;
+            int nConds_ = 0;
+
+            //  Code position reached at each stream position, before and after the jump over an else branch starting there
+            Vector_<int> before_;
+            Vector_<int> after_;
+            //  End of the else branch starting at each stream position, -1 if none
+            Vector_<int> elseEnds_;
+            //  Jumps to patch: code position, stream target and whether they land after the jump over the else branch
+            struct Jump_ {
+                size_t at_;
+                int target_;
+                bool after_;
+            };
+            Vector_<Jump_> jumps_;
+
+            void Emit(int op, int dst, int lhs = 0, int rhs = 0, double c = 0.0) { program_.code_.push_back(RegInstr_{op, dst, lhs, rhs, c}); }
+
+            void EmitJump(int op, int lhs, int target, bool after) {
+                jumps_.push_back(Jump_{program_.code_.size(), target, after});
+                Emit(op, 0, lhs);
+            }
+
+            int Depth() const { return static_cast<int>(operands_.size()) - 1; }
+
+            void Push(Operand_::Kind_ kind, int idx = 0, double c = 0.0) { operands_.push_back(Operand_{kind, idx, c}); }
+
+            void Pop() { operands_.pop_back(); }
+
+            int Materialize(int depth) {
+                Operand_& operand = operands_[depth];
+                switch (operand.kind_) {
+                case Operand_::VARIABLE:
+                    Emit(RegLoadVar, depth, operand.idx_);
+                    break;
+                case Operand_::SPOT:
+                    Emit(RegLoadSpot, depth);
+                    break;
+                case Operand_::CONSTANT:
+                    Emit(RegLoadConst, depth, 0, 0, operand.const_);
+                    break;
+                case Operand_::SCALED_VARIABLE:
+                    Emit(RegLoadVar, depth, operand.idx_);
+                    Emit(RegMultiConst, depth, depth, 0, operand.const_);
+                    break;
+                default:
+                    break;
+                }
+                operand.kind_ = Operand_::REGISTER;
+                program_.nRegs_ = std::max(program_.nRegs_, depth + 1);
+                return depth;
+            }
+
+            //  The result replaces the left operand
+            void Binary(RegOp_ op) {
+                const int lhs = Materialize(Depth() - 1);
+                const int rhs = Materialize(Depth());
+                Emit(op, lhs, lhs, rhs);
+                Pop();
+            }
+
+            void Sum() {
+                const Operand_& lhs = operands_[Depth() - 1];
+                const Operand_& rhs = operands_[Depth()];
+                const Operand_* scaled = lhs.kind_ == Operand_::SCALED_VARIABLE ? &lhs : rhs.kind_ == Operand_::SCALED_VARIABLE ? &rhs : nullptr;
+                const Operand_* other = scaled == &lhs ? &rhs : &lhs;
+                if (scaled && other->kind_ == Operand_::VARIABLE) {
+                    const int dst = Depth() - 1;
+                    Emit(RegVarMultiConstAddVar, dst, scaled->idx_, other->idx_, scaled->const_);
+                    program_.nRegs_ = std::max(program_.nRegs_, dst + 1);
+                    Pop();
+                    operands_[dst].kind_ = Operand_::REGISTER;
+                } else
+                    Binary(RegAdd);
+            }
+
+            void WithConst(int op, double c) {
+                Operand_& top = operands_[Depth()];
+                if (top.kind_ == Operand_::SPOT && (op == SubConst || op == Max2Const)) {
+                    Emit(op == SubConst ? RegSpotSubConst : RegSpotMax2Const, Depth(), 0, 0, c);
+                    top.kind_ = Operand_::REGISTER;
+                    program_.nRegs_ = std::max(program_.nRegs_, Depth() + 1);
+                } else if (top.kind_ == Operand_::VARIABLE && op == MultiConst) {
+                    top.kind_ = Operand_::SCALED_VARIABLE;
+                    top.const_ = c;
+                } else {
+                    const int arg = Materialize(Depth());
+                    Emit(RegOfConstOp(op), arg, arg, 0, c);
+                }
+            }
+
+            void Unary(RegOp_ op) {
+                const int arg = Materialize(Depth());
+                Emit(op, arg, arg);
+            }
+
+            void Store(RegOp_ op, int var) {
+                const int arg = Materialize(Depth());
+                Emit(op, var, arg);
+                Pop();
+            }
+
+            void PushCond(RegOp_ op, int lhs = 0, int rhs = 0) {
+                Emit(op, nConds_, lhs, rhs);
+                program_.nConds_ = std::max(program_.nConds_, ++nConds_);
+            }
+
+            //  Jump over the if-true statements unless the condition holds, returns the position of the first one
+            size_t Branch(size_t pos, RegOp_ op, int lhs) {
+                const int lastTrue = nodes_[pos + 1];
+                if (nodes_[pos] == If) {
+                    EmitJump(op, lhs, lastTrue, false);
+                    return pos + 2;
+                }
+                const int lastFalse = nodes_[pos + 2];
+                if (lastFalse != lastTrue)
+                    elseEnds_[lastTrue] = lastFalse;
+                EmitJump(op, lhs, lastTrue, true);
+                return pos + 3;
+            }
+
+            //  Condition on a number, fused with the if consuming it
+            size_t Compare(size_t pos, RegOp_ op, RegOp_ jump) {
+                const int arg = Materialize(Depth());
+                Pop();
+                if (pos + 1 < nodes_.size() && (nodes_[pos + 1] == If || nodes_[pos + 1] == IfElse))
+                    return Branch(pos + 1, jump, arg);
+                PushCond(op, arg);
+                return pos + 1;
+            }
+
+            void Label(size_t pos) {
+                before_[pos] = static_cast<int>(program_.code_.size());
+                if (elseEnds_[pos] >= 0) {
+                    jumps_.push_back(Jump_{program_.code_.size(), elseEnds_[pos], false});
+                    Emit(RegJump, 0);
+                }
+                after_[pos] = static_cast<int>(program_.code_.size());
+            }
+
+        public:
+            Translator_(const Vector_<int>& nodes, const Vector_<double>& consts)
+                : nodes_(nodes), consts_(consts), before_(nodes.size() + 1, 0), after_(nodes.size() + 1, 0), elseEnds_(nodes.size() + 1, -1) {}
+
+            //  Empty program when an instruction has no register form
+            RegProgram_ operator()() {
+                size_t pos = 0;
+                while (pos < nodes_.size()) {
+                    Label(pos);
+                    const int op = nodes_[pos];
+                    switch (op) {
+                    case Add:
+                        Sum();
+                        ++pos;
+                        break;
+                    case Sub:
+                        Binary(RegSub);
+                        ++pos;
+                        break;
+                    case Multi:
+                        Binary(RegMulti);
+                        ++pos;
+                        break;
+                    case Div:
+                        Binary(RegDiv);
+                        ++pos;
+                        break;
+                    case Pow:
+                        Binary(RegPow);
+                        ++pos;
+                        break;
+                    case Max2:
+                        Binary(RegMax2);
+                        ++pos;
+                        break;
+                    case Min2:
+                        Binary(RegMin2);
+                        ++pos;
+                        break;
+                    case AddConst:
+                    case SubConst:
+                    case ConstSub:
+                    case MultiConst:
+                    case DivConst:
+                    case ConstDiv:
+                    case PowConst:
+                    case ConstPow:
+                    case Max2Const:
+                    case Min2Const:
+                        WithConst(op, consts_[nodes_[pos + 1]]);
+                        pos += 2;
+                        break;
+                    case Spot:
+                        Push(Operand_::SPOT);
+                        ++pos;
+                        break;
+                    case Var:
+                        Push(Operand_::VARIABLE, nodes_[pos + 1]);
+                        pos += 2;
+                        break;
+                    case Const:
+                    case ConstVar:
+                        Push(Operand_::CONSTANT, 0, consts_[nodes_[pos + 1]]);
+                        pos += 2;
+                        break;
+                    case Assign:
+                        Store(RegAssign, nodes_[pos + 1]);
+                        pos += 2;
+                        break;
+                    case Pays:
+                        Store(RegPays, nodes_[pos + 1]);
+                        pos += 2;
+                        break;
+                    case AssignConst:
+                    case PaysConst:
+                        Emit(op == AssignConst ? RegAssignConst : RegPaysConst, nodes_[pos + 2], 0, 0, consts_[nodes_[pos + 1]]);
+                        pos += 3;
+                        break;
+                    case If:
+                    case IfElse:
+                        pos = Branch(pos, RegJumpIfNot, --nConds_);
+                        break;
+                    case Equal:
+                        pos = Compare(pos, RegEqual, RegJumpIfNotEqual);
+                        break;
+                    case Sup:
+                        pos = Compare(pos, RegSup, RegJumpIfNotSup);
+                        break;
+                    case SupEqual:
+                        pos = Compare(pos, RegSupEqual, RegJumpIfNotSupEqual);
+                        break;
+                    case And:
+                    case Or:
+                        --nConds_;
+                        Emit(op == And ? RegAnd : RegOr, nConds_ - 1, nConds_ - 1, nConds_);
+                        ++pos;
+                        break;
+                    case Not:
+                        Emit(RegNot, nConds_ - 1, nConds_ - 1);
+                        ++pos;
+                        break;
+                    case True:
+                    case False:
+                        PushCond(op == True ? RegTrue : RegFalse);
+                        ++pos;
+                        break;
+                    case Sqrt:
+                        Unary(RegSqrt);
+                        ++pos;
+                        break;
+                    case Log:
+                        Unary(RegLog);
+                        ++pos;
+                        break;
+                    case Exp:
+                        Unary(RegExp);
+                        ++pos;
+                        break;
+                    case UMinus:
+                        Unary(RegUMinus);
+                        ++pos;
+                        break;
+                    default:
+                        //  smoothing and fuzzy logic stay on the stack stream
+                        return RegProgram_();
+                    }
+                }
+                Label(nodes_.size());
+                Emit(RegStop, 0);
+
+                for (const auto& jump : jumps_)
+                    program_.code_[jump.at_].dst_ = jump.after_ ? after_[jump.target_] : before_[jump.target_];
+                return program_;
+            }
+        };
+    } // namespace
+
+    RegProgram_ ToRegisters(const Vector_<int>& node_stream, const Vector_<double>& const_stream) {
+        return Translator_(node_stream, const_stream)();
+    }
+} // namespace Dal::Script
@@ -0,0 +1,282 @@
+//
+// Created by wegam on 2024/11/17.
+//
+
+#pragma once
+
+#include <dal/math/aad/sample.hpp>
+#include <dal/math/vectors.hpp>
+#include <dal/platform/platform.hpp>
+#include <dal/script/visitor/compiler.hpp>
+
+//  Register instructions, in the order of their labels in the threaded dispatch
+//  the last ones are superinstructions fusing frequent sequences of the stack stream
+#define DAL_REGISTER_OPS(X)                                                                                            \
+    X(RegStop)                                                                                                         \
+    X(RegLoadVar)                                                                                                      \
+    X(RegLoadSpot)                                                                                                     \
+    X(RegLoadConst)                                                                                                    \
+    X(RegAdd)                                                                                                          \
+    X(RegAddConst)                                                                                                     \
+    X(RegSub)                                                                                                          \
+    X(RegSubConst)                                                                                                     \
+    X(RegConstSub)                                                                                                     \
+    X(RegMulti)                                                                                                        \
+    X(RegMultiConst)                                                                                                   \
+    X(RegDiv)                                                                                                          \
+    X(RegDivConst)                                                                                                     \
+    X(RegConstDiv)                                                                                                     \
+    X(RegPow)                                                                                                          \
+    X(RegPowConst)                                                                                                     \
+    X(RegConstPow)                                                                                                     \
+    X(RegMax2)                                                                                                         \
+    X(RegMax2Const)                                                                                                    \
+    X(RegMin2)                                                                                                         \
+    X(RegMin2Const)                                                                                                    \
+    X(RegSqrt)                                                                                                         \
+    X(RegLog)                                                                                                          \
+    X(RegExp)                                                                                                          \
+    X(RegUMinus)                                                                                                       \
+    X(RegAssign)                                                                                                       \
+    X(RegAssignConst)                                                                                                  \
+    X(RegPays)                                                                                                         \
+    X(RegPaysConst)                                                                                                    \
+    X(RegEqual)                                                                                                        \
+    X(RegSup)                                                                                                          \
+    X(RegSupEqual)                                                                                                     \
+    X(RegAnd)                                                                                                          \
+    X(RegOr)                                                                                                           \
+    X(RegNot)                                                                                                          \
+    X(RegTrue)                                                                                                         \
+    X(RegFalse)                                                                                                        \
+    X(RegJump)                                                                                                         \
+    X(RegJumpIfNot)                                                                                                    \
+    X(RegSpotSubConst)                                                                                                 \
+    X(RegSpotMax2Const)                                                                                                \
+    X(RegVarMultiConstAddVar)                                                                                          \
+    X(RegJumpIfNotEqual)                                                                                               \
+    X(RegJumpIfNotSup)                                                                                                 \
+    X(RegJumpIfNotSupEqual)
+
+namespace Dal::Script {
+
+#define DAL_REGISTER_ENUM(op) op,
+    enum RegOp_ { DAL_REGISTER_OPS(DAL_REGISTER_ENUM) };
+#undef DAL_REGISTER_ENUM
+
+    //  Three address instruction
+    //  dst_ is the register, condition or variable written, or the jump target
+    //  lhs_ and rhs_ the registers, conditions or variables read, const_ the inlined constant
+    struct RegInstr_ {
+        int op_;
+        int dst_;
+        int lhs_;
+        int rhs_;
+        double const_;
+    };
+
+    //  Second stage of the compilation: the stack stream of an event translated to register code
+    //  a value lives in the register of the depth it would have on the stack, so no allocation is needed
+    //  and if-else branches become flat jumps instead of nested calls
+    struct RegProgram_ {
+        Vector_<RegInstr_> code_;
+        int nRegs_ = 0;
+        int nConds_ = 0;
+
+        //  Empty when the stream has instructions without register form, the stack stream is then evaluated
+        [[nodiscard]] bool IsValid() const { return !code_.empty(); }
+    };
+
+    //  Fuzzy instructions have no register form
+    RegProgram_ ToRegisters(const Vector_<int>& node_stream, const Vector_<double>& const_stream);
+
+    template <class T_>
+    inline void EvalRegisters(const RegProgram_& program, const AAD::Sample_<T_>& scenario, EvalState_<T_>& state) {
+        //  Register files, shared by the events evaluated on this thread
+        thread_local static Vector_<T_> regs;
+        thread_local static Vector_<unsigned char> conds;
+        if (regs.size() < static_cast<size_t>(program.nRegs_))
+            regs.Resize(program.nRegs_);
+        if (conds.size() < static_cast<size_t>(program.nConds_))
+            conds.Resize(program.nConds_);
+
+        T_* r = regs.empty() ? nullptr : &regs[0];
+        unsigned char* b = conds.empty() ? nullptr : &conds[0];
+        Vector_<T_>& v = state.variables_;
+        const RegInstr_* const code = &program.code_[0];
+        const RegInstr_* pc = code;
+
+        //  Threaded dispatch where labels are values (gcc and clang), a switch otherwise
+#if defined(__GNUC__)
+#define DAL_REGISTER_LABEL(op) &&L_##op,
+        static const void* const labels[] = {DAL_REGISTER_OPS(DAL_REGISTER_LABEL)};
+#undef DAL_REGISTER_LABEL
+#define REG_OP(op) L_##op:
+#define REG_NEXT goto* labels[(++pc)->op_]
+#define REG_GOTO(target)                                                                                               \
+    pc = code + (target);                                                                                              \
+    goto* labels[pc->op_]
+        goto* labels[pc->op_];
+        {
+#else
+#define REG_OP(op) case op:
+#define REG_NEXT                                                                                                       \
+    ++pc;                                                                                                              \
+    continue
+#define REG_GOTO(target)                                                                                               \
+    pc = code + (target);                                                                                              \
+    continue
+        for (;;) {
+            switch (pc->op_) {
+#endif
+            REG_OP(RegStop)
+                return;
+            REG_OP(RegLoadVar)
+                r[pc->dst_] = v[pc->lhs_];
+                REG_NEXT;
+            REG_OP(RegLoadSpot)
+                r[pc->dst_] = scenario.spot_;
+                REG_NEXT;
+            REG_OP(RegLoadConst)
+                r[pc->dst_] = T_(pc->const_);
+                REG_NEXT;
+            REG_OP(RegAdd)
+                r[pc->dst_] = r[pc->lhs_] + r[pc->rhs_];
+                REG_NEXT;
+            REG_OP(RegAddConst)
+                r[pc->dst_] = r[pc->lhs_] + pc->const_;
+                REG_NEXT;
+            REG_OP(RegSub)
+                r[pc->dst_] = r[pc->lhs_] - r[pc->rhs_];
+                REG_NEXT;
+            REG_OP(RegSubConst)
+                r[pc->dst_] = r[pc->lhs_] - pc->const_;
+                REG_NEXT;
+            REG_OP(RegConstSub)
+                r[pc->dst_] = pc->const_ - r[pc->lhs_];
+                REG_NEXT;
+            REG_OP(RegMulti)
+                r[pc->dst_] = r[pc->lhs_] * r[pc->rhs_];
+                REG_NEXT;
+            REG_OP(RegMultiConst)
+                r[pc->dst_] = r[pc->lhs_] * pc->const_;
+                REG_NEXT;
+            REG_OP(RegDiv)
+                r[pc->dst_] = r[pc->lhs_] / r[pc->rhs_];
+                REG_NEXT;
+            REG_OP(RegDivConst)
+                r[pc->dst_] = r[pc->lhs_] / pc->const_;
+                REG_NEXT;
+            REG_OP(RegConstDiv)
+                r[pc->dst_] = pc->const_ / r[pc->lhs_];
+                REG_NEXT;
+            REG_OP(RegPow)
+                r[pc->dst_] = pow(r[pc->lhs_], r[pc->rhs_]);
+                REG_NEXT;
+            REG_OP(RegPowConst)
+                r[pc->dst_] = pow(r[pc->lhs_], pc->const_);
+                REG_NEXT;
+            REG_OP(RegConstPow)
+                r[pc->dst_] = pow(pc->const_, r[pc->lhs_]);
+                REG_NEXT;
+            //  max and min select one of their arguments, like the stack stream
+            REG_OP(RegMax2)
+                r[pc->dst_] = r[pc->rhs_] > r[pc->lhs_] ? r[pc->rhs_] : r[pc->lhs_];
+                REG_NEXT;
+            REG_OP(RegMax2Const)
+                r[pc->dst_] = pc->const_ > r[pc->lhs_] ? T_(pc->const_) : r[pc->lhs_];
+                REG_NEXT;
+            REG_OP(RegMin2)
+                r[pc->dst_] = r[pc->rhs_] < r[pc->lhs_] ? r[pc->rhs_] : r[pc->lhs_];
+                REG_NEXT;
+            REG_OP(RegMin2Const)
+                r[pc->dst_] = pc->const_ < r[pc->lhs_] ? T_(pc->const_) : r[pc->lhs_];
+                REG_NEXT;
+            REG_OP(RegSqrt)
+                r[pc->dst_] = sqrt(r[pc->lhs_]);
+                REG_NEXT;
+            REG_OP(RegLog)
+                r[pc->dst_] = log(r[pc->lhs_]);
+                REG_NEXT;
+            REG_OP(RegExp)
+                r[pc->dst_] = exp(r[pc->lhs_]);
+                REG_NEXT;
+            REG_OP(RegUMinus)
+                r[pc->dst_] = -r[pc->lhs_];
+                REG_NEXT;
+            REG_OP(RegAssign)
+                v[pc->dst_] = r[pc->lhs_];
+                REG_NEXT;
+            REG_OP(RegAssignConst)
+                v[pc->dst_] = T_(pc->const_);
+                REG_NEXT;
+            REG_OP(RegPays)
+                v[pc->dst_] += r[pc->lhs_] / scenario.numeraire_;
+                REG_NEXT;
+            REG_OP(RegPaysConst)
+                v[pc->dst_] += T_(pc->const_) / scenario.numeraire_;
+                REG_NEXT;
+            REG_OP(RegEqual)
+                b[pc->dst_] = r[pc->lhs_] == 0;
+                REG_NEXT;
+            REG_OP(RegSup)
+                b[pc->dst_] = r[pc->lhs_] > 0;
+                REG_NEXT;
+            REG_OP(RegSupEqual)
+                b[pc->dst_] = r[pc->lhs_] >= 0;
+                REG_NEXT;
+            REG_OP(RegAnd)
+                b[pc->dst_] = b[pc->lhs_] && b[pc->rhs_];
+                REG_NEXT;
+            REG_OP(RegOr)
+                b[pc->dst_] = b[pc->lhs_] || b[pc->rhs_];
+                REG_NEXT;
+            REG_OP(RegNot)
+                b[pc->dst_] = !b[pc->lhs_];
+                REG_NEXT;
+            REG_OP(RegTrue)
+                b[pc->dst_] = true;
+                REG_NEXT;
+            REG_OP(RegFalse)
+                b[pc->dst_] = false;
+                REG_NEXT;
+            REG_OP(RegJump)
+                REG_GOTO(pc->dst_);
+            REG_OP(RegJumpIfNot)
+                if (!b[pc->lhs_]) {
+                    REG_GOTO(pc->dst_);
+                }
+                REG_NEXT;
+            REG_OP(RegSpotSubConst)
+                r[pc->dst_] = scenario.spot_ - pc->const_;
+                REG_NEXT;
+            REG_OP(RegSpotMax2Const)
+                r[pc->dst_] = pc->const_ > scenario.spot_ ? T_(pc->const_) : scenario.spot_;
+                REG_NEXT;
+            REG_OP(RegVarMultiConstAddVar)
+                r[pc->dst_] = v[pc->lhs_] * pc->const_ + v[pc->rhs_];
+                REG_NEXT;
+            REG_OP(RegJumpIfNotEqual)
+                if (!(r[pc->lhs_] == 0)) {
+                    REG_GOTO(pc->dst_);
+                }
+                REG_NEXT;
+            REG_OP(RegJumpIfNotSup)
+                if (!(r[pc->lhs_] > 0)) {
+                    REG_GOTO(pc->dst_);
+                }
+                REG_NEXT;
+            REG_OP(RegJumpIfNotSupEqual)
+                if (!(r[pc->lhs_] >= 0)) {
+                    REG_GOTO(pc->dst_);
+                }
+                REG_NEXT;
+#if !defined(__GNUC__)
+            }
+#endif
+        }
+#undef REG_OP
+#undef REG_NEXT
+#undef REG_GOTO
+    }
+} // namespace Dal::Script
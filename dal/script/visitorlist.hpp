@@ -15,20 +15,23 @@ namespace Dal::Script {
     template <class T_> class Evaluator_;
     template <class T_> class PastEvaluator_;
     class Compiler_;
+    class CodeGenerator_;
     class ConstCondProcessor_;
     class IFProcessor_;
     class DomainProcessor_;
+    class LivenessProcessor_;
     template <class T> class FuzzyEvaluator_;
 
 //  List
 
 //  Modifying visitors
-#define MODIFY_VISITORS VarIndexer_, ConstProcessor_, ConstCondProcessor_, IFProcessor_, DomainProcessor_
+#define MODIFY_VISITORS VarIndexer_, ConstProcessor_, ConstCondProcessor_, IFProcessor_, DomainProcessor_, LivenessProcessor_
 
 //  Const visitors
 #define CONST_VISITORS                                                                                                 \
-    Debugger_, Evaluator_<double>, Evaluator_<AAD::Number_>, PastEvaluator_<double>, Compiler_, FuzzyEvaluator_<double>,                       \
-        FuzzyEvaluator_<AAD::Number_>
+    Debugger_, Evaluator_<double>, Evaluator_<AAD::Number_>, PastEvaluator_<double>, Compiler_, CodeGenerator_, FuzzyEvaluator_<double>,       \
+        FuzzyEvaluator_<AAD::Number_>, FuzzyEvaluator_<AAD::Dual_<1>>, FuzzyEvaluator_<AAD::Dual_<4>>,                    \
+        FuzzyEvaluator_<AAD::Dual2_<2>>, FuzzyEvaluator_<AAD::Dual2_<4>>
 
 //  All visitors
 #define VISITORS MODIFY_VISITORS, CONST_VISITORS
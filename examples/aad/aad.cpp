@@ -30,6 +30,50 @@ T_ BlackTest(const T_& fwd, const T_& vol, const T_& numeraire, const T_& strike
 }
 
 
+//  Reverse sweep alone: a long tape is recorded once and its adjoints propagated repeatedly, in single and multi-adjoint mode
+void SweepBenchmark(int n_nodes, int n_sweeps, size_t n_adjoints) {
+    Timer_ timer;
+    auto resetter = Dal::AAD::SetNumResultsForAAD(n_adjoints > 1, n_adjoints);
+    Tape_ tape;
+    Number_::SetTape(tape);
+
+    Vector_<Number_> inputs(64);
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        inputs[i] = 1.0 + 0.01 * static_cast<double>(i);
+        inputs[i].PutOnTape();
+    }
+    Number_ y = inputs[0];
+    for (int i = 0; i < n_nodes / 3; ++i) {
+        Number_ t = inputs[i % inputs.size()] * inputs[(i + 7) % inputs.size()];
+        t = sqrt(t);
+        y = y + t;
+    }
+
+    timer.Reset();
+    for (int i = 0; i < n_sweeps; ++i) {
+        tape.ResetAdjoints();
+        if (n_adjoints > 1) {
+            for (size_t k = 0; k < n_adjoints; ++k)
+                y.Adjoint(k) = 1.0;
+            Number_::PropagateAdjointsMulti(std::prev(tape.End()), tape.Begin());
+        } else
+            y.PropagateToStart();
+    }
+    const auto duration = static_cast<double>(timer.Elapsed<milliseconds>());
+    const double nodes = static_cast<double>(tape.Stats().nodes_);
+
+    std::cout << std::setw(14) << std::left << (n_adjoints > 1 ? "Multi x" + std::to_string(n_adjoints) : "Single")
+              << std::fixed
+              << std::setprecision(6)
+              << std::setw(14) << std::right << (n_adjoints > 1 ? inputs[0].Adjoint(n_adjoints - 1) : inputs[0].Adjoint())
+              << std::setw(14) << std::right << static_cast<int>(nodes)
+              << std::setprecision(3)
+              << std::setw(14) << std::right << 1.0e6 * duration / (nodes * n_sweeps)
+              << std::setw(14) << std::right << static_cast<int>(duration)
+              << std::endl;
+}
+
+
 int main() {
     Dal::RegisterAll_::Init();
 
@@ -145,5 +189,17 @@ int main() {
                   << std::endl;
     }
 
+    std::cout << std::endl
+              << std::setw(14) << std::left << "Sweep"
+              << std::setw(14) << std::right << "dY/dX0"
+              << std::setw(14) << std::right << "Nodes"
+              << std::setw(14) << std::right << "ns/node"
+              << std::setw(14) << std::right << "Elapsed (ms)"
+              << std::endl;
+    Tape_* mainTape = Number_::Tape();
+    SweepBenchmark(300000, 100, 1);
+    SweepBenchmark(300000, 20, 8);
+    Number_::SetTape(*mainTape);
+
     return 0;
 }
\ No newline at end of file
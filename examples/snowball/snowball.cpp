@@ -103,6 +103,29 @@ int main() {
                   << std::endl;
     }
 
+    {
+        Handle_<ModelData_> model_data(new BSModelData_("bsmodel", spot, vol, rate, div));
+
+        timer.Reset();
+        product.Compile();
+        SimResults_ results = MCSimulation<double>(product, model_data, num_path, String_("sobol"), false, true, -1, 0.01, true);
+
+        auto calculated = results.aggregated_ / static_cast<double>(num_path);
+
+        std::cout << std::setw(widths[0]) << std::left << "Batched"
+                  << std::setw(widths[1]) << std::right << num_path
+                  << std::setw(widths[2]) << std::right << num_obs
+                  << std::fixed
+                  << std::setprecision(6)
+                  << std::setw(widths[3]) << std::right << calculated
+                  << std::setw(widths[4]) << std::right << "#NA"
+                  << std::setw(widths[5]) << std::right << "#NA"
+                  << std::setw(widths[6]) << std::right << "#NA"
+                  << std::setw(widths[7]) << std::right << "#NA"
+                  << std::setw(widths[8]) << std::right << int(timer.Elapsed<milliseconds>())
+                  << std::endl;
+    }
+
     {
         Handle_<ModelData_> model_data(new BSModelData_("bsmodel", spot, vol, rate, div));
 
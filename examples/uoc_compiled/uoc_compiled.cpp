@@ -2,6 +2,8 @@
 // Created by wegam on 2020/12/21.
 //
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <iomanip>
 #include <dal/platform/platform.hpp>
@@ -72,6 +74,43 @@ int main() {
               << std::setw(widths[8]) << std::right << "dP/dK"
               << std::setw(widths[9]) << std::right << "Elapsed (ms)"
               << std::endl;
+    {
+        //  Interpreter alone: one path evaluated again and again on the stack stream, then on the register code
+        ScriptProduct_ product(eventDates, events);
+        product.PreProcess(false, false);
+        Scenario_<double> path;
+        AllocatePath(product.DefLine(), path);
+        InitializePath(path);
+        for (size_t i = 0; i < path.size(); ++i)
+            path[i].spot_ = spot * (1.0 + 0.25 * static_cast<double>(i) / static_cast<double>(path.size() - 1));
+        auto state = product.BuildEvalState<double>();
+        const auto& names = product.VarNames();
+        const auto payoff = std::find(names.begin(), names.end(), "call") - names.begin();
+        const int num_eval = std::pow(2, 16);
+
+        for (auto registers : {false, true}) {
+            product.Compile(false, registers);
+            timer.Reset();
+            double total = 0.0;
+            for (int k = 0; k < num_eval; ++k) {
+                product.EvaluateCompiled(path, state);
+                total += state.VarVals()[payoff];
+            }
+
+            std::cout << std::setw(widths[0]) << std::left << (registers ? "Registers" : "Stack")
+                      << std::setw(widths[1]) << std::right << num_eval
+                      << std::setw(widths[2]) << std::right << num_obs
+                      << std::fixed << std::setprecision(6)
+                      << std::setw(widths[3]) << std::right << total / num_eval
+                      << std::setw(widths[4]) << std::right << "#NA"
+                      << std::setw(widths[5]) << std::right << "#NA"
+                      << std::setw(widths[6]) << std::right << "#NA"
+                      << std::setw(widths[7]) << std::right << "#NA"
+                      << std::setw(widths[8]) << std::right << "#NA"
+                      << std::setw(widths[9]) << std::right << int(timer.Elapsed<milliseconds>()) << std::endl;
+        }
+    }
+
     {
         Handle_<ModelData_> model_data(new DupireModelData_("dupiremodel",
                                                                       spot,
@@ -115,7 +154,7 @@ int main() {
 
         ScriptProduct_ product(eventDates, events);
         int max_nested_ifs = product.PreProcess(true, true);
-        product.Compile();
+        product.Compile(true);
         const int num_path = std::pow(2, 20);
         SimResults_ results = MCSimulation<Number_>(product, model_data, num_path, String_("sobol"), false, true, max_nested_ifs, 0.01);
 
@@ -27,6 +27,10 @@ enable_aad is boolean
     whether to enable aad mode
 smooth is number
     smooth factor for non-continuous
+compiled is boolean
+    whether to evaluate the product in compiled mode, which gives no risks to constant variables
+antithetic is boolean
+    whether to simulate antithetic pairs of paths (pseudo random generators only)
 &outputs
 values is cell[][]
     the output values
@@ -42,8 +46,10 @@ namespace Dal {
                               bool use_bb,
                               bool enable_aad,
                               double smooth,
+                              bool compiled,
+                              bool antithetic,
                               Matrix_<Cell_>* values) {
-            auto val = ValueByMonteCarlo(product, modelData, (int)n_paths, rsg, use_bb, enable_aad, smooth);
+            auto val = ValueByMonteCarlo(product, modelData, (int)n_paths, rsg, use_bb, enable_aad, smooth, compiled, antithetic);
             values->Resize(val.size(), 2);
             int i = 0;
             for (auto& d : val) {
@@ -25,21 +25,32 @@ namespace Dal {
                                                 const String_& rsg,
                                                 bool use_bb,
                                                 bool enable_aad,
-                                                double smooth) {
+                                                double smooth,
+                                                bool compiled,
+                                                bool antithetic) {
         const auto modelType = model_data->Type();
         REQUIRE(MODEL_STORE.find(modelType) != MODEL_STORE.end(), "only support black scholes and Dupire model now");
-        auto prd = product->Product();
+        REQUIRE(!antithetic || rsg != "sobol", "antithetic sampling is only supported with pseudo random generators");
         std::map<String_, double> res;
         if (enable_aad) {
-            int max_nested_ifs = prd.PreProcess(true, true);
-            SimResults_ results = Script::MCSimulation<AAD::Number_>(prd, model_data, n_paths, rsg, use_bb, false, max_nested_ifs, smooth);
+            size_t max_nested_ifs = 0;
+            const auto prd = product->PreProcessed(true, true, compiled, &max_nested_ifs);
+            SimResults_ results = Script::MCSimulation<AAD::Number_>(*prd, model_data, n_paths, rsg, use_bb, compiled, static_cast<int>(max_nested_ifs), smooth,
+                                                                     false, nullptr, 0, nullptr, antithetic);
             res["PV"] = results.aggregated_ / static_cast<double>(n_paths);
-            for(const auto& n: results.names_)
-                res["d_" + n] = results[n];
+            res["PV_stderr"] = results.StdErr();
+            //  the compiled form folds constant variables into literals, so only the model parameters get risks
+            const size_t nRisks = compiled ? results.names_.size() - prd->ConstVarNames().size() : results.names_.size();
+            for (size_t i = 0; i < nRisks; ++i) {
+                res["d_" + results.names_[i]] = results.risks_[i];
+                res["d_" + results.names_[i] + "_stderr"] = results.RiskStdErr(i);
+            }
         } else {
-            prd.PreProcess(false, false);
-            SimResults_ results = Script::MCSimulation<double>(prd, model_data, n_paths, rsg, use_bb, false);
+            const auto prd = product->PreProcessed(false, false, compiled);
+            SimResults_ results = Script::MCSimulation<double>(*prd, model_data, n_paths, rsg, use_bb, compiled, -1, smooth,
+                                                                 false, nullptr, 0, nullptr, antithetic);
             res["PV"] = results.aggregated_ / static_cast<double>(n_paths);
+            res["PV_stderr"] = results.StdErr();
             return res;
         }
         return res;
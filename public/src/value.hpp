@@ -11,13 +11,16 @@ namespace Dal {
     using AAD::Model_;
     using Script::ScriptProductData_;
 
+    //  in AAD mode, the risks to the model parameters and, unless compiled, to the constant variables of the product
     std::map<String_, double> ValueByMonteCarlo(const Handle_<ScriptProductData_>& product,
                                                 const Handle_<ModelData_>& modelData,
                                                 int num_path,
                                                 const String_& rsg = "sobol",
                                                 bool use_bb = false,
                                                 bool enable_aad = false,
-                                                double smooth = 0.01);
+                                                double smooth = 0.01,
+                                                bool compiled = false,
+                                                bool antithetic = false);
 
 
 }
\ No newline at end of file
@@ -18,8 +18,10 @@
                                                    const std::string& method = "sobol",
                                                    bool use_bb = false,
                                                    bool enable_aad = false,
-                                                   double smooth = 0.01) {
-    auto res = ValueByMonteCarlo(product, modelData, num_path, String_(method), use_bb, enable_aad, smooth);
+                                                   double smooth = 0.01,
+                                                   bool compiled = false,
+                                                   bool antithetic = false) {
+    auto res = ValueByMonteCarlo(product, modelData, num_path, String_(method), use_bb, enable_aad, smooth, compiled, antithetic);
     std::map<std::string, double> rtn;
     for (auto& d : res)
         rtn[d.first.c_str()] = d.second;
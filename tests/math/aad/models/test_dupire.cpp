@@ -19,3 +19,49 @@ TEST(AADTest, TestDupireCalib) {
     auto results = DupireCalib(ivs, incl_spots, max_ds, incl_times, max_dt);
     ASSERT_NEAR(results.lVols_(0, 0), 0.187513, 1e-5);
 }
+
+TEST(AADTest, TestDupireCalibJacobian) {
+    MertonIVS_ ivs(100.0, 0.15, 0.05, -0.15, 0.1);
+    Dal::Vector_<> incl_spots{50.0, 100.0, 200.0};
+    Dal::Vector_<> incl_times{1.0};
+    const Dal::Vector_<> strikes{60.0, 80.0, 100.0, 120.0, 150.0};
+    const Dal::Vector_<> mats{0.25, 0.5, 1.0};
+    const auto jacobian = DupireCalibWithJacobian(ivs, incl_spots, 10.0, incl_times, 0.25, strikes, mats);
+    const size_t nSpots = jacobian.spots_.size();
+    const size_t nTimes = jacobian.times_.size();
+    ASSERT_EQ(jacobian.rows_.size(), nSpots * nTimes);
+    //  seven calls, each on an interpolation cell of the risk view
+    for (const auto& row : jacobian.rows_)
+        ASSERT_LE(row.size(), 28);
+
+    //  the whole calibration on tape
+    Tape_ tape;
+    TapeScope_ scope(tape);
+    RiskView_<Number_> riskView(strikes, mats);
+    PutOnTape(riskView.begin(), riskView.end());
+    auto results = DupireCalib(ivs, incl_spots, 10.0, incl_times, 0.25, riskView);
+
+    //  a price linear in the local volatilities, with risks (after spot, rate and repo) in the order of the Dupire_ parameters
+    Dal::Vector_<> risks(3 + nSpots * nTimes, 0.0);
+    Number_ price(0.0);
+    for (size_t i = 0; i < nSpots; ++i)
+        for (size_t j = 0; j < nTimes; ++j) {
+            const double w = 1.0 + 0.01 * static_cast<double>(i) - 0.02 * static_cast<double>(j);
+            risks[3 + i * nTimes + j] = w;
+            price += w * results.lVols_(i, j);
+            ASSERT_NEAR(jacobian.lVols_(i, j), results.lVols_(i, j).value(), 1e-6);
+        }
+    price.PropagateToStart();
+
+    const auto ivsRisks = jacobian.Chain(risks, 3);
+    ASSERT_EQ(ivsRisks.Rows(), strikes.size());
+    ASSERT_EQ(ivsRisks.Cols(), mats.size());
+    double total = 0.0;
+    for (size_t k = 0; k < strikes.size(); ++k)
+        for (size_t l = 0; l < mats.size(); ++l) {
+            const double expected = riskView.Risks()(k, l).Adjoint();
+            ASSERT_NEAR(ivsRisks(k, l), expected, 1e-8 * std::max(1.0, std::fabs(expected)));
+            total += std::fabs(expected);
+        }
+    ASSERT_GT(total, 0.0);
+}
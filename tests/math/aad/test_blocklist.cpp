@@ -41,3 +41,108 @@ TEST(AADTest, TestBlockListRewindToMark) {
     blocks.RewindToMark();
     ASSERT_EQ(blocks.Size(), 5);
 }
+
+TEST(AADTest, TestBlockListAcrossBlocks) {
+    BlockList_<double, 10> blocks;
+    for (int i = 0; i < 35; ++i)
+        *blocks.EmplaceBack() = i;
+    ASSERT_EQ(blocks.Size(), 35);
+    ASSERT_EQ(blocks.HighWater(), 4);
+
+    int expected = 0;
+    for (auto it = blocks.Begin(); it != blocks.End(); ++it)
+        ASSERT_EQ(*it, expected++);
+    ASSERT_EQ(expected, 35);
+
+    auto it = blocks.End();
+    for (int i = 34; i >= 0; --i)
+        ASSERT_EQ(*--it, i);
+
+    double* element = &*blocks.Find(nullptr);
+    ASSERT_EQ(element, &*blocks.End());
+    auto found = blocks.Begin();
+    for (int i = 0; i < 23; ++i)
+        ++found;
+    ASSERT_EQ(&*blocks.Find(&*found), &*found);
+    ASSERT_EQ(*blocks.Find(&*found), 23);
+}
+
+TEST(AADTest, TestBlockListRewindReusesBlocks) {
+    BlockList_<double, 10> blocks;
+    for (int i = 0; i < 6; ++i)
+        blocks.EmplaceBackMulti(5);
+    const auto nBlocks = blocks.NumBlocks();
+    const auto bytes = blocks.Bytes();
+    blocks.Rewind();
+    for (int i = 0; i < 4; ++i)
+        blocks.EmplaceBackMulti(5);
+    ASSERT_EQ(blocks.Size(), 20);
+    ASSERT_EQ(blocks.NumBlocks(), nBlocks);
+    ASSERT_EQ(blocks.Bytes(), bytes);
+
+    //  the end of a full block is the beginning of the next allocated one
+    int count = 0;
+    for (auto it = blocks.Begin(); it != blocks.End(); ++it)
+        ++count;
+    ASSERT_EQ(count, 20);
+}
+
+TEST(AADTest, TestBlockListReserve) {
+    BlockList_<double, 10> blocks;
+    blocks.Reserve(8);
+    ASSERT_EQ(blocks.NumBlocks(), 8);
+    ASSERT_EQ(blocks.Bytes(), 8 * 10 * sizeof(double));
+    for (int i = 0; i < 15; ++i)
+        blocks.EmplaceBackMulti(5);
+    ASSERT_EQ(blocks.NumBlocks(), 8);
+    ASSERT_EQ(blocks.HighWater(), 8);
+}
+
+TEST(AADTest, TestBlockListBlockSize) {
+    BlockList_<double, 10> blocks(4);
+    ASSERT_EQ(blocks.BlockSize(), 4);
+    for (int i = 0; i < 10; ++i)
+        blocks.EmplaceBack();
+    ASSERT_EQ(blocks.Size(), 10);
+    ASSERT_EQ(blocks.HighWater(), 3);
+
+    //  room for 9 more entries in groups of 3, from the current position, without allocating
+    blocks.ReserveAhead(9);
+    const auto bytes = blocks.Bytes();
+    for (int i = 0; i < 3; ++i)
+        blocks.EmplaceBackMulti(3);
+    ASSERT_EQ(blocks.Bytes(), bytes);
+
+    blocks.SetBlockSize(16);
+    ASSERT_EQ(blocks.Size(), 0);
+    ASSERT_EQ(blocks.Bytes(), 16 * sizeof(double));
+    ASSERT_EQ(blocks.HighWater(), 1);
+    ASSERT_THROW(blocks.EmplaceBackMulti(17), Dal::Exception_);
+    int count = 0;
+    for (int i = 0; i < 20; ++i)
+        blocks.EmplaceBack();
+    for (auto it = blocks.Begin(); it != blocks.End(); ++it)
+        ++count;
+    ASSERT_EQ(count, 20);
+}
+
+TEST(AADTest, TestBlockListTrimResetsMark) {
+    BlockList_<double, 10> blocks;
+    for (int i = 0; i < 8; ++i)
+        blocks.EmplaceBackMulti(5);
+    //  the mark is in a chunk released by Trim
+    blocks.SetMark();
+    ASSERT_GT(blocks.NumBlocks(), 1);
+    blocks.Trim();
+    blocks.RewindToMark();
+    ASSERT_EQ(blocks.Size(), 0);
+    blocks.EmplaceBackMulti(5);
+    ASSERT_EQ(blocks.Size(), 5);
+
+    blocks.EmplaceBackMulti(5);
+    blocks.EmplaceBackMulti(5);
+    blocks.SetMark();
+    blocks.Clear();
+    blocks.RewindToMark();
+    ASSERT_EQ(blocks.Size(), 0);
+}
@@ -5,6 +5,7 @@
 #include <gtest/gtest.h>
 #include <dal/platform/platform.hpp>
 #include <dal/math/aad/aad.hpp>
+#include <dal/math/aad/checkpoint.hpp>
 #include <dal/math/vectors.hpp>
 #include <dal/concurrency/threadpool.hpp>
 
@@ -181,4 +182,73 @@ TEST(AADTest, TestWithCheckpointWithMultiThreading) {
     ASSERT_NEAR(greeks[4], -0.242113, 1e-6);
     ASSERT_NEAR(greeks[5], 0.0216408, 1e-6);
 
-}
\ No newline at end of file
+}
+
+TEST(AADTest, TestCheckpointSection) {
+    Tape_* mainTape = Number_::Tape();
+    Tape_ tape;
+    Number_::SetTape(tape);
+
+    //  reference: section recorded on the working tape
+    Number_ a(1.5);
+    Number_ b(0.7);
+    a.PutOnTape();
+    b.PutOnTape();
+    Number_ c = a * b;
+    Number_ d = exp(a) + b;
+    Number_ y = c * d + log(d);
+    y.PropagateToStart();
+    const double da = a.Adjoint();
+    const double db = b.Adjoint();
+
+    //  same section checkpointed: the working tape only holds c and d
+    Number_ a2(1.5);
+    Number_ b2(0.7);
+    Number_ c2;
+    Number_ d2;
+    const Vector_<Number_*> outputs = {&c2, &d2};
+    Checkpoint_ checkpoint({&a2, &b2}, [&]() {
+        c2 = a2 * b2;
+        d2 = exp(a2) + b2;
+        return outputs;
+    });
+    ASSERT_EQ(checkpoint.NumInputs(), 2);
+    ASSERT_EQ(checkpoint.NumOutputs(), 2);
+    ASSERT_EQ(Number_::Tape(), &tape);
+
+    tape.Clear();
+    checkpoint.Restore(outputs);
+    ASSERT_NEAR(c2.value(), c.value(), 1e-14);
+    ASSERT_EQ(tape.Stats().nodes_, 2);
+    Number_ y2 = c2 * d2 + log(d2);
+    y2.PropagateToStart();
+
+    Vector_<> risks(2, 0.0);
+    checkpoint.Differentiate({c2.Adjoint(), d2.Adjoint()}, &risks);
+    ASSERT_NEAR(risks[0], da, 1e-12);
+    ASSERT_NEAR(risks[1], db, 1e-12);
+
+    //  the checkpoint is only read, the adjoints live in the workspace
+    Vector_<> workspace;
+    risks.Fill(0.0);
+    checkpoint.Differentiate({c2.Adjoint(), d2.Adjoint()}, &risks, &workspace);
+    ASSERT_NEAR(risks[0], da, 1e-12);
+    risks.Fill(0.0);
+    checkpoint.Differentiate({c2.Adjoint(), d2.Adjoint()}, &risks, &workspace);
+    ASSERT_NEAR(risks[1], db, 1e-12);
+
+    //  several sets of adjoints in one sweep
+    Matrix_<> outputAdjoints(2, 2);
+    outputAdjoints(0, 0) = c2.Adjoint();
+    outputAdjoints(0, 1) = d2.Adjoint();
+    outputAdjoints(1, 0) = 2.0 * c2.Adjoint();
+    outputAdjoints(1, 1) = 0.0;
+    Matrix_<> inputAdjoints(2, 2, 0.0);
+    checkpoint.Differentiate(outputAdjoints, &inputAdjoints, &workspace);
+    ASSERT_NEAR(inputAdjoints(0, 0), da, 1e-12);
+    ASSERT_NEAR(inputAdjoints(0, 1), db, 1e-12);
+    //  c = a * b
+    ASSERT_NEAR(inputAdjoints(1, 0), 2.0 * c2.Adjoint() * b2.value(), 1e-12);
+    ASSERT_NEAR(inputAdjoints(1, 1), 2.0 * c2.Adjoint() * a2.value(), 1e-12);
+    Number_::SetTape(*mainTape);
+}
@@ -7,6 +7,8 @@
 #include <dal/math/vectors.hpp>
 #include <dal/math/aad/aad.hpp>
 #include <dal/concurrency/threadpool.hpp>
+#include <mutex>
+#include <thread>
 
 using Dal::ThreadPool_;
 using Dal::Vector_;
@@ -87,4 +89,67 @@ TEST(AADTest, TestAADMutiThread) {
     ASSERT_NEAR(greeks[1], 3.0, 1e-8);
     ASSERT_NEAR(greeks[2], 2.0, 1e-8);
 
-}
\ No newline at end of file
+}
+
+TEST(AADTest, TestNumResultsPerThread) {
+    //  multi mode on this thread leaves another thread recording and propagating single adjoints
+    auto resetter = Dal::AAD::SetNumResultsForAAD(true, 3);
+    double adjoint = 0.0;
+    std::thread other([&adjoint]() {
+        Tape_ tape;
+        Number_::SetTape(tape);
+        Number_ x(2.0);
+        x.PutOnTape();
+        Number_ y = x * x;
+        y.PropagateToStart();
+        adjoint = x.Adjoint();
+    });
+    other.join();
+    ASSERT_NEAR(adjoint, 4.0, 1e-12);
+}
+
+TEST(AADTest, TestThreadTapes) {
+    ThreadPool_* thread_pool = ThreadPool_::GetInstance();
+    const size_t n_threads = thread_pool->NumThreads();
+
+    //  a thread gets the same tape from one task to the next, and no other thread gets it
+    std::vector<Tape_*> tapes(n_threads, nullptr);
+    std::mutex m;
+    std::vector<TaskHandle_> futures;
+    for (int i = 0; i < 64; ++i)
+        futures.push_back(thread_pool->SpawnTask([&]() {
+            std::lock_guard<std::mutex> lock(m);
+            const size_t num = ThreadPool_::ThreadNum();
+            if (!tapes[num])
+                tapes[num] = Dal::AAD::ThreadTape();
+            return tapes[num] == Dal::AAD::ThreadTape();
+        }));
+    for (auto& f : futures) {
+        thread_pool->ActiveWait(f);
+        ASSERT_TRUE(f.get());
+    }
+    for (size_t i = 0; i < n_threads; ++i)
+        for (size_t j = 0; j < i; ++j)
+            if (tapes[i] && tapes[j])
+                ASSERT_NE(tapes[i], tapes[j]);
+
+    //  a trim request is carried out by the owner at its next rewind, not by the requesting thread
+    Tape_* tape = Dal::AAD::ThreadTape();
+    const size_t bytes = tape->Stats().bytes_;
+    Dal::AAD::TapeStats_ reserved;
+    reserved.nodeBlocks_ = 8;
+    reserved.derBlocks_ = 8;
+    tape->Reserve(reserved);
+    const size_t grown = tape->Stats().bytes_;
+    ASSERT_GT(grown, bytes);
+    Dal::AAD::TrimThreadTapes();
+    ASSERT_EQ(tape->Stats().bytes_, grown);
+    tape->Rewind();
+    ASSERT_EQ(tape->Stats().bytes_, bytes);
+    ASSERT_EQ(tape, Dal::AAD::ThreadTape());
+
+    //  the tapes of stopped threads are gone, requests right after a restart only reach the live ones
+    thread_pool->Start(2, true);
+    Dal::AAD::TrimThreadTapes();
+    thread_pool->Start(-1, true);
+}
@@ -0,0 +1,85 @@
+//
+// Created by wegam on 2024/11/9.
+//
+
+#include <gtest/gtest.h>
+#include <dal/platform/platform.hpp>
+#include <dal/math/operators.hpp>
+
+using namespace Dal;
+using namespace Dal::AAD;
+
+namespace {
+    auto f = [](const auto& x, const auto& y) {
+        using T_ = std::decay_t<decltype(x)>;
+        T_ z = x * y + Dal::exp(-x) / y - 2.0 * Dal::sqrt(x);
+        z += Dal::max(x - 1.0, 0.0) * Dal::pow(y, 2.0);
+        return T_(NCDF(z / 10.0) + Dal::log(y));
+    };
+} // namespace
+
+TEST(AADTest, TestDualMatchesNumber) {
+    Tape_* mainTape = Number_::Tape();
+    Tape_ tape;
+    Number_::SetTape(tape);
+    Number_ x(1.5);
+    Number_ y(0.7);
+    x.PutOnTape();
+    y.PutOnTape();
+    Number_ z = f(x, y);
+    z.PropagateToStart();
+
+    Dual_<2> xd(1.5);
+    Dual_<2> yd(0.7);
+    xd.Seed(0);
+    yd.Seed(1);
+    const Dual_<2> zd = f(xd, yd);
+    ASSERT_NEAR(zd.value(), z.value(), 1e-14);
+    ASSERT_NEAR(zd.Tangent(0), x.Adjoint(), 1e-12);
+    ASSERT_NEAR(zd.Tangent(1), y.Adjoint(), 1e-12);
+
+    //  constants carry no tangent
+    Dual_<1> c(3.0);
+    ASSERT_EQ((c * c + 1.0).Tangent(0), 0.0);
+    ASSERT_TRUE(c > 2 && c == 3.0 && -c < c);
+    Number_::SetTape(*mainTape);
+}
+
+TEST(AADTest, TestDual2MatchesDual) {
+    auto g = [](const auto& x, const auto& y) {
+        using T_ = std::decay_t<decltype(x)>;
+        return T_(f(x, y) + Dal::pow(x, y) * NPDF(y) + erfc(x / y) - 1.0 / (x * x));
+    };
+    auto gradient = [&](double x, double y) {
+        Dual_<2> xd(x);
+        Dual_<2> yd(y);
+        xd.Seed(0);
+        yd.Seed(1);
+        return g(xd, yd);
+    };
+
+    Dual2_<2> x(1.5);
+    Dual2_<2> y(0.7);
+    x.Seed(0);
+    y.Seed(1);
+    const Dual2_<2> z = g(x, y);
+    const Dual_<2> zd = gradient(1.5, 0.7);
+    ASSERT_NEAR(z.value(), zd.value(), 1e-14);
+    ASSERT_NEAR(z.Tangent(0), zd.Tangent(0), 1e-12);
+    ASSERT_NEAR(z.Tangent(1), zd.Tangent(1), 1e-12);
+
+    //  second derivatives against central differences of the first ones
+    const double h = 1.0e-5;
+    const Dual_<2> xUp = gradient(1.5 + h, 0.7), xDown = gradient(1.5 - h, 0.7);
+    const Dual_<2> yUp = gradient(1.5, 0.7 + h), yDown = gradient(1.5, 0.7 - h);
+    ASSERT_NEAR(z.Second(0, 0), (xUp.Tangent(0) - xDown.Tangent(0)) / (2.0 * h), 1e-6);
+    ASSERT_NEAR(z.Second(1, 0), (xUp.Tangent(1) - xDown.Tangent(1)) / (2.0 * h), 1e-6);
+    ASSERT_NEAR(z.Second(0, 1), (yUp.Tangent(0) - yDown.Tangent(0)) / (2.0 * h), 1e-6);
+    ASSERT_NEAR(z.Second(1, 1), (yUp.Tangent(1) - yDown.Tangent(1)) / (2.0 * h), 1e-6);
+    ASSERT_EQ(z.Second(0, 1), z.Second(1, 0));
+
+    //  constants carry no derivative
+    Dual2_<2> c(3.0);
+    ASSERT_EQ((c * c + 1.0).Second(0, 0), 0.0);
+    ASSERT_TRUE(c > 2 && c == 3.0 && -c < c);
+}
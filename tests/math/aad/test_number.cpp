@@ -5,6 +5,7 @@
 #include <gtest/gtest.h>
 #include <dal/platform/platform.hpp>
 #include <dal/math/aad/aad.hpp>
+#include <dal/utilities/exceptions.hpp>
 
 using namespace Dal::AAD;
 
@@ -534,4 +535,121 @@ TEST(AADTest, TestNumberFabs) {
     ASSERT_NEAR(value.value(), 2.0, 1e-10);
     value.PropagateToStart();
     ASSERT_NEAR(s1.Adjoint(), -1.0, 1e-10);
-}
\ No newline at end of file
+}
+
+TEST(AADTest, TestTapeStats) {
+    Tape_* mainTape = Number_::Tape();
+    Tape_ tape;
+    Number_::SetTape(tape);
+    Number_ x(1.0);
+    x.PutOnTape();
+    Number_ y = x;
+    for (int i = 0; i < 20000; ++i)
+        y = y * x + 1.0;
+
+    const TapeStats_ stats = tape.Stats();
+    ASSERT_GT(stats.nodes_, 20000);
+    ASSERT_EQ(stats.nodeBlocks_, (stats.nodes_ + BLOCK_SIZE - 1) / BLOCK_SIZE);
+    ASSERT_GE(stats.blocks_, stats.nodeBlocks_ + stats.derBlocks_ + stats.argBlocks_);
+    ASSERT_GT(stats.bytes_, 0);
+
+    //  a tape reserved from the high-water marks records the same computation without allocating
+    Tape_ reserved;
+    reserved.Reserve(stats);
+    const auto bytes = reserved.Stats().bytes_;
+    Number_::SetTape(reserved);
+    Number_ z(1.0);
+    z.PutOnTape();
+    Number_ w = z;
+    for (int i = 0; i < 20000; ++i)
+        w = w * z + 1.0;
+    ASSERT_EQ(reserved.Stats().bytes_, bytes);
+    ASSERT_EQ(reserved.Stats().nodes_, stats.nodes_);
+    Number_::SetTape(*mainTape);
+}
+
+TEST(AADTest, TestTapeBlockSize) {
+    Tape_* mainTape = Number_::Tape();
+    ASSERT_THROW(Tape_::SetBlockSize(16), Dal::Exception_);
+    {
+        //  in multi mode, a block holds the adjoints of a node
+        auto resetter = SetNumResultsForAAD(true, 1024);
+        ASSERT_THROW(Tape_::SetBlockSize(256), Dal::Exception_);
+        Tape_::SetBlockSize(512);
+    }
+    Tape_::SetBlockSize(1024);
+    Tape_ tape;
+    Number_::SetTape(tape);
+    Number_ x(1.0);
+    x.PutOnTape();
+    Number_ y = x;
+    for (int i = 0; i < 5000; ++i)
+        y = y + x;
+    const TapeStats_ stats = tape.Stats();
+    ASSERT_EQ(stats.nodeBlocks_, (stats.nodes_ + 1023) / 1024);
+    y.PropagateToStart();
+    ASSERT_NEAR(x.Adjoint(), 5001.0, 1e-8);
+
+    //  a reserved path bound is recorded without allocating
+    Tape_::SetBlockSize(BLOCK_SIZE);
+    tape.Clear();
+    x.PutOnTape();
+    tape.Mark();
+    const TapeSize_ path{5000, 10000};
+    tape.ReserveAhead(path);
+    const auto bytes = tape.Stats().bytes_;
+    y = x;
+    for (int i = 0; i < 2500; ++i)
+        y = y * x + 1.0;
+    ASSERT_EQ(tape.Stats().bytes_, bytes);
+    ASSERT_GE(path.Bytes(), 5000 * sizeof(TapNode_));
+    Number_::SetTape(*mainTape);
+}
+
+TEST(AADTest, TestTapeScope) {
+    Tape_* mainTape = Number_::Tape();
+    Tape_ tape;
+    try {
+        TapeScope_ scope(tape);
+        ASSERT_EQ(Number_::Tape(), &tape);
+        throw std::runtime_error("leaving the scope");
+    } catch (const std::runtime_error&) {
+    }
+    ASSERT_EQ(Number_::Tape(), mainTape);
+}
+
+TEST(AADTest, TestNumberPassive) {
+    Tape_* mainTape = Number_::Tape();
+    Tape_ tape;
+    Number_::SetTape(tape);
+
+    //  constants and expressions of constants stay off tape
+    Number_ c(2.0);
+    Number_ d = c * c + 1.0;
+    d = 0.0;
+    ASSERT_FALSE(c.Active());
+    ASSERT_FALSE(d.Active());
+    ASSERT_EQ(tape.Stats().nodes_, 0);
+
+    Number_ x(3.0);
+    x.PutOnTape();
+    ASSERT_TRUE(x.Active());
+    Number_ y = x * c + exp(c);
+    ASSERT_TRUE(y.Active());
+    ASSERT_EQ(tape.Stats().nodes_, 2);
+    ASSERT_NEAR(y.value(), 6.0 + std::exp(2.0), 1e-10);
+
+    y.PropagateToStart();
+    ASSERT_NEAR(x.Adjoint(), 2.0, 1e-10);
+    ASSERT_NEAR(static_cast<const Number_&>(c).Adjoint(), 0.0, 1e-10);
+
+    //  a passive result has nothing to propagate
+    d.PropagateToStart();
+    ASSERT_NEAR(x.Adjoint(), 2.0, 1e-10);
+
+    //  writes to the adjoint of a passive number are not seen by other passive numbers
+    c.Adjoint() = 5.0;
+    ASSERT_NEAR(d.Adjoint(), 0.0, 1e-10);
+    ASSERT_NEAR(c.Adjoint(), 0.0, 1e-10);
+    Number_::SetTape(*mainTape);
+}
@@ -114,8 +114,9 @@ TEST(PseudoRandomTest, TestNewPseudoRandomMRG32SkipTo) {
     Vector_<> data(dim);
     Vector_<> data2(dim);
 
+    //  SkipTo counts paths of normal draws: uniform draws come in mirrored pairs, each pair spans one path of the stream
     gen2->SkipTo(size_to_skip);
-    for (int i = 0; i < size_to_skip; ++i)
+    for (int i = 0; i < 2 * size_to_skip; ++i)
         gen->FillUniform(&data);
 
     gen->FillUniform(&data);
@@ -130,7 +131,7 @@ TEST(PseudoRandomTest, TestNewPseudoRandomMRG32SkipTo) {
     data2.Resize(dim);
 
     gen2->SkipTo(size_to_skip);
-    for (int i = 0; i < size_to_skip; ++i)
+    for (int i = 0; i < 2 * size_to_skip; ++i)
         gen->FillUniform(&data);
 
     gen->FillUniform(&data);
@@ -139,6 +140,28 @@ TEST(PseudoRandomTest, TestNewPseudoRandomMRG32SkipTo) {
         ASSERT_DOUBLE_EQ(data[k], data2[k]);
 }
 
+TEST(PseudoRandomTest, TestNewPseudoRandomMRG32SkipToNormal) {
+    const int dim = 10;
+    const int seed = 1024;
+    for (int size_to_skip : {1000, 1001}) {
+        std::unique_ptr<Random_> gen(New(RNGType_("MRG32"), seed, dim));
+        std::unique_ptr<Random_> gen2(New(RNGType_("MRG32"), seed, dim));
+        Vector_<> data(dim);
+        Vector_<> data2(dim);
+
+        gen2->SkipTo(size_to_skip);
+        for (int i = 0; i < size_to_skip; ++i)
+            gen->FillNormal(&data);
+
+        for (int i = 0; i < 3; ++i) {
+            gen->FillNormal(&data);
+            gen2->FillNormal(&data2);
+            for (int k = 0; k < dim; ++k)
+                ASSERT_DOUBLE_EQ(data[k], data2[k]);
+        }
+    }
+}
+
 TEST(RandomTest, NewPseudoRandomIRNPerformance) {
     int dim = 100;
     int seed = 1024;
@@ -165,4 +188,46 @@ TEST(RandomTest, NewPseudoRandomMRG32Performance) {
         gen->FillUniform(&dst);
         sum += dst[0];
     }
-}
\ No newline at end of file
+}
+
+TEST(PseudoRandomTest, TestNewPseudoRandomMRG32Antithetic) {
+    const int dim = 10;
+    const int seed = 1024;
+    std::unique_ptr<Random_> gen(New(RNGType_("MRG32"), seed, dim, false, true));
+    Vector_<> first(dim);
+    Vector_<> second(dim);
+    for (int i = 0; i < 100; ++i) {
+        gen->FillNormal(&first);
+        gen->FillNormal(&second);
+        for (int k = 0; k < dim; ++k)
+            ASSERT_DOUBLE_EQ(first[k], -second[k]);
+    }
+
+    std::unique_ptr<Random_> clone(gen->Clone());
+    clone->FillUniform(&first);
+    clone->FillUniform(&second);
+    for (int k = 0; k < dim; ++k)
+        ASSERT_DOUBLE_EQ(first[k], 1.0 - second[k]);
+}
+
+TEST(PseudoRandomTest, TestNewPseudoRandomMRG32AntitheticSkipTo) {
+    const int dim = 10;
+    const int seed = 1024;
+    for (int size_to_skip : {1000, 1001}) {
+        std::unique_ptr<Random_> gen(New(RNGType_("MRG32"), seed, dim, false, true));
+        std::unique_ptr<Random_> gen2(New(RNGType_("MRG32"), seed, dim, false, true));
+        Vector_<> data(dim);
+        Vector_<> data2(dim);
+
+        gen2->SkipTo(size_to_skip);
+        for (int i = 0; i < size_to_skip; ++i)
+            gen->FillNormal(&data);
+
+        for (int i = 0; i < 3; ++i) {
+            gen->FillNormal(&data);
+            gen2->FillNormal(&data2);
+            for (int k = 0; k < dim; ++k)
+                ASSERT_DOUBLE_EQ(data[k], data2[k]);
+        }
+    }
+}
@@ -4,7 +4,11 @@
 
 #include <gtest/gtest.h>
 #include <dal/platform/platform.hpp>
+#include <dal/math/aad/checkpoint.hpp>
 #include <dal/model/dupire.hpp>
+#include <dal/model/factory.hpp>
+#include <dal/script/simulation.hpp>
+#include <dal/storage/globals.hpp>
 #include <dal/storage/json.hpp>
 
 using namespace Dal;
@@ -17,3 +21,101 @@ TEST(ModelTest, TestDupireModelData) {
     ASSERT_NEAR(std::dynamic_pointer_cast<const DupireModelData_>(rtn)->spot_, 100.0, 1e-8);
     ASSERT_NEAR(std::dynamic_pointer_cast<const DupireModelData_>(rtn)->rate_, 0.05, 1e-8);
 }
+
+TEST(ModelTest, TestDupireCheckpointedInit) {
+    using namespace Dal::AAD;
+    Tape_* mainTape = Number_::Tape();
+    Tape_ tape;
+    Number_::SetTape(tape);
+
+    const Vector_<> spots = {80.0, 90.0, 100.0, 110.0, 120.0};
+    const Vector_<> times = {0.5, 1.0, 2.0};
+    Matrix_<> vols(spots.size(), times.size());
+    for (int i = 0; i < vols.Rows(); ++i)
+        for (int j = 0; j < vols.Cols(); ++j)
+            vols(i, j) = 0.15 + 0.01 * i + 0.02 * j;
+
+    const Vector_<> timeLine = {1.5};
+    Vector_<SampleDef_> defLine(1);
+    defLine[0].numeraire_ = true;
+    defLine[0].discountMats_ = {2.0};
+    defLine[0].forwardMats_ = {{1.5}};
+    Vector_<> gauss;
+    Scenario_<Number_> path;
+    AllocatePath(defLine, path);
+
+    auto payoff = [&](Dupire_<Number_>& model) {
+        InitializePath(path);
+        gauss.Resize(model.SimDim());
+        for (size_t i = 0; i < gauss.size(); ++i)
+            gauss[i] = 0.3 - 0.2 * static_cast<double>(i);
+        model.GeneratePath(gauss, &path);
+        return Number_(path[0].spot_ * path[0].discounts_[0] / path[0].numeraire_);
+    };
+
+    Dupire_<Number_> direct(Number_(100.0), Number_(0.03), Number_(0.01), spots, times, ToMatrix<Number_>(vols), 0.25);
+    direct.Allocate(timeLine, defLine);
+    tape.Rewind();
+    for (auto* p : direct.Parameters())
+        p->PutOnTape();
+    direct.Init(timeLine, defLine);
+    Number_ y = payoff(direct);
+    y.PropagateToStart();
+    Vector_<> expected;
+    for (auto* p : direct.Parameters())
+        expected.push_back(p->Adjoint());
+
+    Dupire_<Number_> recorded(Number_(100.0), Number_(0.03), Number_(0.01), spots, times, ToMatrix<Number_>(vols), 0.25);
+    recorded.Allocate(timeLine, defLine);
+    Checkpoint_ checkpoint(recorded.Parameters(), [&]() {
+        recorded.Init(timeLine, defLine);
+        return recorded.InitOutputs();
+    });
+
+    Dupire_<Number_> model(Number_(100.0), Number_(0.03), Number_(0.01), spots, times, ToMatrix<Number_>(vols), 0.25);
+    model.Allocate(timeLine, defLine);
+    tape.Clear();
+    for (auto* p : model.Parameters())
+        p->PutOnTape();
+    const auto outputs = model.InitOutputs();
+    checkpoint.Restore(outputs);
+    ASSERT_LE(tape.Stats().nodes_, model.Parameters().size() + outputs.size());
+    Number_ y2 = payoff(model);
+    ASSERT_NEAR(y2.value(), y.value(), 1e-12);
+    ASSERT_NE(y2.value(), 0.0);
+    y2.PropagateToStart();
+
+    Vector_<> outputAdjoints(outputs.size());
+    for (size_t k = 0; k < outputs.size(); ++k)
+        outputAdjoints[k] = outputs[k]->Adjoint();
+    Vector_<> risks(model.Parameters().size(), 0.0);
+    checkpoint.Differentiate(outputAdjoints, &risks);
+    for (size_t j = 0; j < risks.size(); ++j)
+        ASSERT_NEAR(risks[j] + model.Parameters()[j]->Adjoint(), expected[j], 1e-10);
+    Number_::SetTape(*mainTape);
+}
+
+TEST(ModelTest, TestDupireAADCheckpointedSimulation) {
+    using namespace Dal::Script;
+    Global::Dates_::SetEvaluationDate(Date_(2022, 6, 22));
+    Vector_<Cell_> eventDates(1, Cell_(Date_(2024, 6, 21)));
+    Vector_<String_> events(1, "call pays MAX(spot() - 105.0, 0.0)");
+    ScriptProduct_ product(eventDates, events);
+    const int maxNested = product.PreProcess(false, false);
+
+    const Vector_<> spots = {60.0, 80.0, 100.0, 120.0, 140.0, 160.0};
+    const Vector_<> times = {0.5, 1.0, 2.0, 3.0};
+    Handle_<ModelData_> dupire(new DupireModelData_("dupire", 100.0, 0.03, 0.01, spots, times, Matrix_<>(spots.size(), times.size(), 0.2)));
+    Handle_<ModelData_> bs(new BSModelData_("bs", 100.0, 0.2, 0.03, 0.01));
+
+    SimResults_ local = MCSimulation<AAD::Number_>(product, dupire, 20000, "mrg32", false, false, maxNested);
+    SimResults_ flat = MCSimulation<AAD::Number_>(product, bs, 20000, "mrg32", false, false, maxNested);
+    ASSERT_NEAR(local.Mean(), flat.Mean(), 4.0 * flat.StdErr());
+    ASSERT_NEAR(local["spot"], flat["spot"], 4.0 * flat.RiskStdErr(0));
+
+    //  the lvol sensitivities add up to the flat volatility one
+    double vega = 0.0;
+    for (size_t i = 3; i < local.names_.size(); ++i)
+        vega += local.risks_[i];
+    ASSERT_NEAR(vega, flat["vol"], 0.05 * flat["vol"]);
+}
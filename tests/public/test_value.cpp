@@ -0,0 +1,50 @@
+//
+// Created by wegam on 2026/10/17.
+//
+
+#include <gtest/gtest.h>
+#include <dal/platform/platform.hpp>
+#include <dal/model/blackscholes.hpp>
+#include <dal/storage/globals.hpp>
+#include <public/src/value.hpp>
+
+using namespace Dal;
+using namespace Dal::Script;
+
+TEST(PublicTest, TestValueByMonteCarloAntithetic) {
+    Global::Dates_::SetEvaluationDate(Date_(2022, 6, 22));
+    Vector_<Cell_> eventDates(1, Cell_("STRIKE"));
+    Vector_<String_> events(1, ToString(11.0));
+    eventDates.push_back(Cell_(Date_(2024, 6, 21)));
+    events.push_back("call pays MAX(spot() - STRIKE, 0.0)");
+    Handle_<ScriptProductData_> product(new ScriptProductData_("call", eventDates, events));
+    Handle_<ModelData_> model_data(new BSModelData_("bsmodel", 10.0, 0.20, 0.034, 0.021));
+
+    //  sobol is the default generator, it has no antithetic mode
+    ASSERT_THROW(ValueByMonteCarlo(product, model_data, 1000, "sobol", false, false, 0.01, false, true), Exception_);
+    ASSERT_THROW(ValueByMonteCarlo(product, model_data, 1000, "sobol", false, true, 0.01, false, true), Exception_);
+
+    const auto values = ValueByMonteCarlo(product, model_data, 10000, "mrg32", false, true, 0.01, false, true);
+    ASSERT_NEAR(values.at("PV"), 0.806119, 4.0 * values.at("PV_stderr"));
+}
+
+TEST(PublicTest, TestValueByMonteCarloCompiledRisks) {
+    Global::Dates_::SetEvaluationDate(Date_(2022, 6, 22));
+    Vector_<Cell_> eventDates(1, Cell_("STRIKE"));
+    Vector_<String_> events(1, ToString(11.0));
+    eventDates.push_back(Cell_(Date_(2024, 6, 21)));
+    events.push_back("call pays MAX(spot() - STRIKE, 0.0)");
+    Handle_<ScriptProductData_> product(new ScriptProductData_("call", eventDates, events));
+    Handle_<ModelData_> model_data(new BSModelData_("bsmodel", 10.0, 0.20, 0.034, 0.021));
+
+    const auto interpreted = ValueByMonteCarlo(product, model_data, 10000, "mrg32", false, true, 0.01, false);
+    const auto compiled = ValueByMonteCarlo(product, model_data, 10000, "mrg32", false, true, 0.01, true);
+    ASSERT_LT(interpreted.at("d_STRIKE"), 0.0);
+
+    //  the compiled form folds STRIKE, it reports the model risks only
+    ASSERT_EQ(compiled.count("d_STRIKE"), 0);
+    ASSERT_EQ(compiled.count("d_STRIKE_stderr"), 0);
+    ASSERT_EQ(compiled.size(), interpreted.size() - 2);
+    for (const auto& v : compiled)
+        ASSERT_NEAR(v.second, interpreted.at(v.first), 1e-3 * std::max(1.0, std::fabs(v.second)));
+}
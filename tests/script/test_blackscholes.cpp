@@ -5,6 +5,7 @@
 #include <gtest/gtest.h>
 #include <dal/platform/platform.hpp>
 #include <dal/model/blackscholes.hpp>
+#include <dal/model/dupire.hpp>
 #include <dal/storage/globals.hpp>
 #include <dal/script/event.hpp>
 #include <dal/script/simulation.hpp>
@@ -39,6 +40,42 @@ TEST(ScriptTest, TestBlackScholes) {
     ASSERT_NEAR(results.aggregated_ / num_paths, expected, 1e-2);
 }
 
+TEST(ScriptTest, TestBlackScholesBatched) {
+    Global::Dates_::SetEvaluationDate(Date_(2022, 6, 22));
+    const double strike = 11.0;
+    const double barrier = 12.0;
+    const String_ rsg = "sobol";
+    const size_t num_paths = 100000;
+
+    Vector_<Cell_> eventDates(1, Cell_("STRIKE"));
+    Vector_<String_> events(1, ToString(strike));
+    eventDates.push_back(Cell_("BARRIER"));
+    events.push_back(ToString(barrier));
+    eventDates.push_back(Cell_(Date_(2022, 6, 22)));
+    events.push_back("alive = 1");
+    eventDates.push_back(Cell_(Date_(2023, 6, 22)));
+    events.push_back("IF spot() > BARRIER THEN alive = 0 END");
+    eventDates.push_back(Cell_(Date_(2024, 6, 21)));
+    events.push_back("IF spot() > BARRIER THEN alive = 0 END call pays alive * MAX(spot() - STRIKE, 0.0)");
+
+    ScriptProduct_ product(eventDates, events);
+    Handle_<ModelData_> model_data(new BSModelData_("bsmodel", 10.0, 0.20, 0.034, 0.021));
+
+    product.PreProcess(false, false);
+    product.Compile();
+    SimResults_ expected = MCSimulation<double>(product, model_data, num_paths, rsg, false, true);
+    SimResults_ results = MCSimulation<double>(product, model_data, num_paths, rsg, false, true, -1, 0.01, true);
+
+    ASSERT_DOUBLE_EQ(results.aggregated_, expected.aggregated_);
+
+    //  the batched kernel evaluates the non-fuzzy compiled form only
+    ASSERT_THROW(MCSimulation<double>(product, model_data, num_paths, rsg, false, false, -1, 0.01, true), Exception_);
+    ScriptProduct_ fuzzy(eventDates, events);
+    fuzzy.PreProcess(true, false);
+    fuzzy.Compile(true);
+    ASSERT_THROW(MCSimulation<double>(fuzzy, model_data, num_paths, rsg, false, true, -1, 0.01, true), Exception_);
+}
+
 TEST(ScriptTest, TestBlackScholesAAD) {
     Global::Dates_::SetEvaluationDate(Date_(2022, 6, 22));
     Date_ exerciseDate(2024, 6, 21);
@@ -65,4 +102,513 @@ TEST(ScriptTest, TestBlackScholesAAD) {
     ASSERT_NEAR(results.risks_[1], 5.38087423, 1e-4);
     ASSERT_NEAR(results.risks_[2], 7.18505725, 1e-4);
     ASSERT_NEAR(results.risks_[3], -8.7972975, 1e-4);
-}
\ No newline at end of file
+}
+
+TEST(ScriptTest, TestBlackScholesStdErr) {
+    Global::Dates_::SetEvaluationDate(Date_(2022, 6, 22));
+    Date_ exerciseDate(2024, 6, 21);
+    const String_ rsg = "mrg32";
+    const size_t num_paths = 100000;
+
+    Vector_<Cell_> eventDates(1, Cell_("STRIKE"));
+    Vector_<String_> events(1, ToString(11.0));
+    eventDates.push_back(Cell_(exerciseDate));
+    events.push_back("call pays MAX(spot() - STRIKE, 0.0)");
+
+    ScriptProduct_ product(eventDates, events);
+    Handle_<ModelData_> model_data(new BSModelData_("bsmodel", 10.0, 0.20, 0.034, 0.021));
+
+    product.PreProcess(false, false);
+    Vector_<> payoffs;
+    SimResults_ results = MCSimulation<double>(product, model_data, num_paths, rsg, false, false, -1, 0.01, false, &payoffs);
+
+    ASSERT_EQ(payoffs.size(), num_paths);
+    double sum = 0.0, squared = 0.0;
+    for (auto p : payoffs) {
+        sum += p;
+        squared += p * p;
+    }
+    const double mean = sum / num_paths;
+    const double expected = std::sqrt((squared / num_paths - mean * mean) / (num_paths - 1));
+    ASSERT_NEAR(results.aggregated_, sum, 1e-8 * sum);
+    ASSERT_NEAR(results.StdErr(), expected, 1e-4 * expected);
+    ASSERT_NEAR(results.Mean(), 0.806119, 4.0 * results.StdErr());
+}
+
+TEST(ScriptTest, TestBlackScholesAADStdErr) {
+    Global::Dates_::SetEvaluationDate(Date_(2022, 6, 22));
+    Date_ exerciseDate(2024, 6, 21);
+    const String_ rsg = "mrg32";
+    const size_t num_paths = 100000;
+
+    Vector_<Cell_> eventDates(1, Cell_("STRIKE"));
+    Vector_<String_> events(1, ToString(11.0));
+    eventDates.push_back(Cell_(exerciseDate));
+    events.push_back("call pays MAX(spot() - STRIKE, 0.0)");
+
+    ScriptProduct_ product(eventDates, events);
+    Handle_<ModelData_> model_data(new BSModelData_("bsmodel", 10.0, 0.20, 0.034, 0.021));
+
+    int max_nested = product.PreProcess(false, false);
+    SimResults_ results = MCSimulation<Number_>(product, model_data, num_paths, rsg, false, false, max_nested, 0.01, false, nullptr, 0, nullptr, false, 32);
+
+    ASSERT_GT(results.StdErr(), 0.0);
+    ASSERT_NEAR(results.Mean(), 0.806119, 4.0 * results.StdErr());
+    const Vector_<> expected = {0.43986485, 5.38087423, 7.18505725, -8.7972975};
+    for (size_t i = 0; i < expected.size(); ++i) {
+        ASSERT_GT(results.RiskStdErr(i), 0.0);
+        ASSERT_NEAR(results.risks_[i], expected[i], 4.0 * results.RiskStdErr(i));
+    }
+
+    //  by default the adjoints are propagated once per batch: same risks, standard errors from the batches
+    SimResults_ batches = MCSimulation<Number_>(product, model_data, num_paths, rsg, false, false, max_nested);
+    ASSERT_EQ(batches.nGroups_, (num_paths + BATCH_SIZE - 1) / BATCH_SIZE);
+    for (size_t i = 0; i < expected.size(); ++i) {
+        ASSERT_NEAR(batches.risks_[i], results.risks_[i], 1e-10 * std::fabs(expected[i]));
+        ASSERT_NEAR(batches.RiskStdErr(i), results.RiskStdErr(i), 0.5 * results.RiskStdErr(i));
+    }
+}
+
+TEST(ScriptTest, TestBlackScholesAADCompiledFuzzy) {
+    Global::Dates_::SetEvaluationDate(Date_(2022, 6, 22));
+    Date_ exerciseDate(2024, 6, 21);
+    const String_ rsg = "mrg32";
+    const size_t num_paths = 10000;
+
+    Vector_<Cell_> eventDates(1, Cell_("STRIKE"));
+    Vector_<String_> events(1, ToString(11.0));
+    eventDates.push_back(Cell_(exerciseDate));
+    events.push_back(R"(
+    IF spot() > STRIKE THEN
+        digital pays 1
+    END
+    )");
+
+    Handle_<ModelData_> model_data(new BSModelData_("bsmodel", 10.0, 0.20, 0.034, 0.021));
+
+    ScriptProduct_ product(eventDates, events);
+    int max_nested = product.PreProcess(true, true);
+    SimResults_ expected = MCSimulation<Number_>(product, model_data, num_paths, rsg, false, false, max_nested, 0.5);
+
+    ScriptProduct_ compiled(eventDates, events);
+    max_nested = compiled.PreProcess(true, true);
+    compiled.Compile(true);
+    SimResults_ results = MCSimulation<Number_>(compiled, model_data, num_paths, rsg, false, true, max_nested, 0.5);
+
+    ASSERT_NEAR(results.aggregated_, expected.aggregated_, 1e-10 * expected.aggregated_);
+    ASSERT_GT(results.risks_[0], 0.0);
+    for (size_t i = 0; i < 4; ++i)
+        ASSERT_NEAR(results.risks_[i], expected.risks_[i], 1e-10 * std::fabs(expected.risks_[i]));
+}
+
+TEST(ScriptTest, TestBlackScholesAADThreadIndependent) {
+    Global::Dates_::SetEvaluationDate(Date_(2022, 6, 22));
+    Date_ exerciseDate(2024, 6, 21);
+    const String_ rsg = "mrg32";
+    const size_t num_paths = 5000;
+
+    Vector_<Cell_> eventDates(1, Cell_("STRIKE"));
+    Vector_<String_> events(1, ToString(11.0));
+    eventDates.push_back(Cell_(exerciseDate));
+    events.push_back("call pays MAX(spot() - STRIKE, 0.0)");
+
+    ScriptProduct_ product(eventDates, events);
+    Handle_<ModelData_> model_data(new BSModelData_("bsmodel", 10.0, 0.20, 0.034, 0.021));
+    int max_nested = product.PreProcess(false, false);
+
+    ThreadPool_* pool = ThreadPool_::GetInstance();
+    pool->Start(1, true);
+    SimResults_ single = MCSimulation<Number_>(product, model_data, num_paths, rsg, false, false, max_nested);
+    SimResults_ singleDouble = MCSimulation<double>(product, model_data, num_paths, rsg);
+    pool->Start(-1, true);
+    SimResults_ multi = MCSimulation<Number_>(product, model_data, num_paths, rsg, false, false, max_nested);
+    SimResults_ multiDouble = MCSimulation<double>(product, model_data, num_paths, rsg);
+
+    ASSERT_EQ(single.aggregated_, multi.aggregated_);
+    ASSERT_EQ(single.squared_, multi.squared_);
+    ASSERT_EQ(singleDouble.aggregated_, multiDouble.aggregated_);
+    for (size_t i = 0; i < single.risks_.size(); ++i) {
+        ASSERT_EQ(single.risks_[i], multi.risks_[i]);
+        ASSERT_EQ(single.risksSquared_[i], multi.risksSquared_[i]);
+    }
+}
+
+TEST(ScriptTest, TestBlackScholesAADInvalidGenerator) {
+    Global::Dates_::SetEvaluationDate(Date_(2022, 6, 22));
+    Date_ exerciseDate(2024, 6, 21);
+    const size_t num_paths = 5000;
+
+    Vector_<Cell_> eventDates(1, Cell_("STRIKE"));
+    Vector_<String_> events(1, ToString(11.0));
+    eventDates.push_back(Cell_(exerciseDate));
+    events.push_back("call pays MAX(spot() - STRIKE, 0.0)");
+
+    ScriptProduct_ product(eventDates, events);
+    Handle_<ModelData_> model_data(new BSModelData_("bsmodel", 10.0, 0.20, 0.034, 0.021));
+    int max_nested = product.PreProcess(false, false);
+
+    ASSERT_THROW(MCSimulation<Number_>(product, model_data, num_paths, "foo", false, false, max_nested), Exception_);
+
+    //  nothing is left behind by the failed run
+    SimResults_ results = MCSimulation<Number_>(product, model_data, num_paths, "mrg32", false, false, max_nested);
+    ASSERT_NEAR(results.Mean(), 0.806119, 4.0 * results.StdErr());
+}
+
+TEST(ScriptTest, TestBlackScholesUnsupportedFlags) {
+    Global::Dates_::SetEvaluationDate(Date_(2022, 6, 22));
+    Vector_<Cell_> eventDates(1, Cell_(Date_(2024, 6, 21)));
+    Vector_<String_> events(1, "call pays MAX(spot() - 11.0, 0.0)");
+    ScriptProduct_ product(eventDates, events);
+    Handle_<ModelData_> model_data(new BSModelData_("bsmodel", 10.0, 0.20, 0.034, 0.021));
+    int max_nested = product.PreProcess(false, false);
+    product.Compile();
+
+    //  batched mode is double only, risk groups AAD only
+    ASSERT_THROW(MCSimulation<Number_>(product, model_data, 1024, "mrg32", false, true, max_nested, 0.01, true), Exception_);
+    ASSERT_THROW(MCSimulation<Dual_<1>>(product, model_data, 1024, "mrg32", false, true, max_nested, 0.01, true), Exception_);
+    ASSERT_THROW(MCSimulation<double>(product, model_data, 1024, "mrg32", false, true, -1, 0.01, false, nullptr, 0, nullptr, false, 256), Exception_);
+    ASSERT_THROW(MCSimulation<Dual_<1>>(product, model_data, 1024, "mrg32", false, true, max_nested, 0.01, false, nullptr, 0, nullptr, false, 256), Exception_);
+}
+
+TEST(ScriptTest, TestBlackScholesAdaptive) {
+    Global::Dates_::SetEvaluationDate(Date_(2022, 6, 22));
+    Date_ exerciseDate(2024, 6, 21);
+    const String_ rsg = "sobol";
+
+    Vector_<Cell_> eventDates(1, Cell_("STRIKE"));
+    Vector_<String_> events(1, ToString(11.0));
+    eventDates.push_back(Cell_(exerciseDate));
+    events.push_back("call pays MAX(spot() - STRIKE, 0.0)");
+
+    ScriptProduct_ product(eventDates, events);
+    Handle_<ModelData_> model_data(new BSModelData_("bsmodel", 10.0, 0.20, 0.034, 0.021));
+    const int max_nested = product.PreProcess(false, false);
+
+    const double rel_tol = 0.002;
+    SimResults_ results = MCSimulationAdaptive<double>(product, model_data, 0.0, rel_tol, 10000000, 0.0, rsg);
+    ASSERT_EQ(results.nPaths_ % BATCH_SIZE, 0);
+    ASSERT_LE(results.StdErr(), rel_tol * results.Mean());
+    ASSERT_NEAR(results.Mean(), 0.806119, 4.0 * results.StdErr());
+
+    // same paths as a fixed run of the final path count
+    SimResults_ fixed = MCSimulation<double>(product, model_data, results.nPaths_, rsg, false, false);
+    ASSERT_EQ(results.aggregated_, fixed.aggregated_);
+    ASSERT_EQ(results.squared_, fixed.squared_);
+    ASSERT_EQ(results.nSamples_, fixed.nSamples_);
+
+    // the risks too, whatever the rounds
+    SimResults_ risks = MCSimulationAdaptive<AAD::Number_>(product, model_data, 0.0, 0.01, 100000, 0.0, rsg, false, false, max_nested);
+    SimResults_ fixedRisks = MCSimulation<AAD::Number_>(product, model_data, risks.nPaths_, rsg, false, false, max_nested);
+    ASSERT_GT(risks.nPaths_, ADAPTIVE_ROUND);
+    ASSERT_EQ(risks.aggregated_, fixedRisks.aggregated_);
+    for (size_t i = 0; i < risks.risks_.size(); ++i) {
+        ASSERT_EQ(risks.risks_[i], fixedRisks.risks_[i]);
+        ASSERT_EQ(risks.risksSquared_[i], fixedRisks.risksSquared_[i]);
+    }
+
+    // path budget
+    SimResults_ budget = MCSimulationAdaptive<double>(product, model_data, 1e-8, 0.0, 5000, 0.0, rsg);
+    ASSERT_EQ(budget.nPaths_, 5000);
+}
+
+TEST(ScriptTest, TestBlackScholesControlVariate) {
+    Global::Dates_::SetEvaluationDate(Date_(2022, 6, 22));
+    Date_ exerciseDate(2024, 6, 21);
+    const String_ rsg = "mrg32";
+    const size_t num_paths = 20000;
+
+    Vector_<Cell_> eventDates(1, Cell_(exerciseDate));
+    Vector_<String_> events(1, "call pays MAX(spot() - 10.5, 0.0)");
+    ScriptProduct_ product(eventDates, events);
+    Handle_<ModelData_> model_data(new BSModelData_("bsmodel", 10.0, 0.20, 0.034, 0.021));
+    product.PreProcess(false, false);
+
+    const Vector_<ControlVariate_> controls = {{0, 11.0}, {0, 0.0}};
+    SimResults_ plain = MCSimulation<double>(product, model_data, num_paths, rsg);
+    SimResults_ results = MCSimulationControlled<double>(product, model_data, controls, num_paths, 4096, rsg);
+
+    const BlackScholes_<> model(10.0, 0.20, 0.034, 0.021);
+    const double expected = ControlExpectations(ControlVariates_{{{0, 10.5}}}, model, product.TimeLine())[0];
+    ASSERT_EQ(results.nPaths_, num_paths);
+    ASSERT_LT(results.StdErr(), 0.1 * plain.StdErr());
+    ASSERT_NEAR(results.Mean(), expected, 4.0 * results.StdErr());
+}
+
+TEST(ScriptTest, TestControlBetasCollinear) {
+    const int nPaths = 100;
+    Vector_<> payoffs(nPaths);
+    Matrix_<> values(nPaths, 2);
+    for (int i = 0; i < nPaths; ++i) {
+        const double c = std::sin(0.1 * i);
+        payoffs[i] = 2.0 * c + 0.01 * std::cos(0.37 * i);
+        values(i, 0) = c;
+        values(i, 1) = c;
+    }
+
+    //  a duplicate control shares the coefficient
+    const auto betas = ControlBetas(payoffs, values);
+    ASSERT_NEAR(betas[0] + betas[1], 2.0, 1e-3);
+    ASSERT_NEAR(betas[0], betas[1], 1e-6);
+
+    for (int i = 0; i < nPaths; ++i)
+        values(i, 0) = values(i, 1) = 1.0;
+    ASSERT_THROW(ControlBetas(payoffs, values), Exception_);
+}
+
+TEST(ScriptTest, TestBlackScholesAADControlVariate) {
+    Global::Dates_::SetEvaluationDate(Date_(2022, 6, 22));
+    Date_ exerciseDate(2024, 6, 21);
+    const String_ rsg = "mrg32";
+    const size_t num_paths = 20000;
+
+    Vector_<Cell_> eventDates(1, Cell_(exerciseDate));
+    Vector_<String_> events(1, "call pays MAX(spot() - 10.5, 0.0)");
+    ScriptProduct_ product(eventDates, events);
+    Handle_<ModelData_> model_data(new BSModelData_("bsmodel", 10.0, 0.20, 0.034, 0.021));
+    int max_nested = product.PreProcess(false, false);
+
+    const Vector_<ControlVariate_> controls = {{0, 11.0}};
+    SimResults_ plain = MCSimulation<Number_>(product, model_data, num_paths, rsg, false, false, max_nested);
+    SimResults_ results = MCSimulationControlled<Number_>(product, model_data, controls, num_paths, 4096, rsg, false, false, max_nested);
+
+    ASSERT_LT(results.StdErr(), 0.2 * plain.StdErr());
+    for (size_t i = 0; i < 4; ++i) {
+        ASSERT_LT(results.RiskStdErr(i), plain.RiskStdErr(i));
+        ASSERT_NEAR(results.risks_[i], plain.risks_[i], 4.0 * plain.RiskStdErr(i));
+    }
+}
+
+TEST(ScriptTest, TestBlackScholesAntithetic) {
+    Global::Dates_::SetEvaluationDate(Date_(2022, 6, 22));
+    Date_ exerciseDate(2024, 6, 21);
+    const String_ rsg = "mrg32";
+    const size_t num_paths = 20001;
+
+    Vector_<Cell_> eventDates(1, Cell_(exerciseDate));
+    Vector_<String_> events(1, "fwd pays spot() - 10.5");
+    ScriptProduct_ product(eventDates, events);
+    Handle_<ModelData_> model_data(new BSModelData_("bsmodel", 10.0, 0.20, 0.034, 0.021));
+    int max_nested = product.PreProcess(false, false);
+
+    SimResults_ plain = MCSimulation<double>(product, model_data, num_paths, rsg, true);
+    Vector_<> payoffs;
+    SimResults_ results = MCSimulation<double>(product, model_data, num_paths, rsg, true, false, -1, 0.01, false, &payoffs, 0, nullptr, true);
+    ASSERT_EQ(results.nSamples_, num_paths / 2 + 1);
+    ASSERT_LT(results.StdErr(), 0.5 * plain.StdErr());
+
+    const double mat = product.TimeLine()[0];
+    const double expected = 10.0 * std::exp(-0.021 * mat) - 10.5 * std::exp(-0.034 * mat);
+    ASSERT_NEAR(results.Mean(), expected, 4.0 * results.StdErr());
+
+    //  a run starting in the middle of a pair draws the same paths
+    SimResults_ split = MCSimulation<double>(product, model_data, 1001, rsg, true, false, -1, 0.01, false, nullptr, 0, nullptr, true);
+    split.Merge(MCSimulation<double>(product, model_data, num_paths - 1001, rsg, true, false, -1, 0.01, false, nullptr, 1001, nullptr, true));
+    ASSERT_NEAR(split.aggregated_, results.aggregated_, 1e-10 * std::fabs(results.aggregated_));
+
+    SimResults_ aad = MCSimulation<Number_>(product, model_data, num_paths, rsg, true, false, max_nested, 0.01, false, nullptr, 0, nullptr, true);
+    ASSERT_NEAR(aad.aggregated_, results.aggregated_, 1e-8 * std::fabs(results.aggregated_));
+    ASSERT_EQ(aad.nSamples_, results.nSamples_);
+
+    //  quasi random sequences have no antithetic mode, reported before any path is drawn
+    ASSERT_THROW(MCSimulation<double>(product, model_data, num_paths, "sobol", false, false, -1, 0.01, false, nullptr, 0, nullptr, true), Exception_);
+    ASSERT_THROW(MCSimulation<Number_>(product, model_data, num_paths, "sobol", false, false, max_nested, 0.01, false, nullptr, 0, nullptr, true), Exception_);
+}
+
+TEST(ScriptTest, TestBlackScholesAADMulti) {
+    Global::Dates_::SetEvaluationDate(Date_(2022, 6, 22));
+    Date_ exerciseDate(2024, 6, 21);
+    const String_ rsg = "mrg32";
+    const size_t num_paths = 5000;
+
+    Vector_<Cell_> eventDates(1, Cell_("STRIKE"));
+    Vector_<String_> events(1, "10.5");
+    eventDates.push_back(Cell_(exerciseDate));
+    events.push_back("call pays MAX(spot() - STRIKE, 0.0) put pays MAX(STRIKE - spot(), 0.0)");
+    Handle_<ModelData_> model_data(new BSModelData_("bsmodel", 10.0, 0.20, 0.034, 0.021));
+
+    Vector_<String_> variables = {"call", "put"};
+    for (bool compiled : {false, true}) {
+        ScriptProduct_ product(eventDates, events);
+        int max_nested = product.PreProcess(false, false);
+        if (compiled)
+            product.Compile();
+        MultiSimResults_ multi = MCSimulationMulti(product, model_data, variables, num_paths, rsg, false, compiled, max_nested);
+        ASSERT_EQ(multi.nPaths_, num_paths);
+        ASSERT_EQ(multi.risks_.Rows(), 2);
+        ASSERT_GT(multi.risks_(0, 0), 0.0);
+        ASSERT_LT(multi.risks_(1, 0), 0.0);
+
+        for (size_t k = 0; k < variables.size(); ++k) {
+            ScriptProduct_ single(eventDates, events, variables[k]);
+            single.PreProcess(false, false);
+            if (compiled)
+                single.Compile();
+            SimResults_ results = MCSimulation<Number_>(single, model_data, num_paths, rsg, false, compiled, max_nested);
+            ASSERT_NEAR(multi.Mean(k), results.Mean(), 1e-10);
+            ASSERT_EQ(multi.names_, results.names_);
+            for (size_t j = 0; j < results.risks_.size(); ++j)
+                ASSERT_NEAR(multi.risks_(static_cast<int>(k), static_cast<int>(j)), results.risks_[j], 1e-10);
+        }
+    }
+
+    //  later antithetic paths of the sequence, as MCSimulation draws them
+    ScriptProduct_ product(eventDates, events);
+    int max_nested = product.PreProcess(false, false);
+    MultiSimResults_ multi = MCSimulationMulti(product, model_data, variables, num_paths, rsg, false, false, max_nested, 0.01, 1001, true);
+    ASSERT_EQ(multi.nPaths_, num_paths);
+    for (size_t k = 0; k < variables.size(); ++k) {
+        ScriptProduct_ single(eventDates, events, variables[k]);
+        single.PreProcess(false, false);
+        SimResults_ results = MCSimulation<Number_>(single, model_data, num_paths, rsg, false, false, max_nested, 0.01, false, nullptr, 1001, nullptr, true);
+        ASSERT_NEAR(multi.Mean(k), results.Mean(), 1e-10);
+        ASSERT_NEAR(multi.StdErr(k), results.StdErr(), 1e-10);
+        ASSERT_EQ(multi.nSamples_, results.nSamples_);
+    }
+    ASSERT_THROW(MCSimulationMulti(product, model_data, variables, num_paths, "sobol", false, false, max_nested, 0.01, 0, true), Exception_);
+}
+
+TEST(ScriptTest, TestBlackScholesForward) {
+    Global::Dates_::SetEvaluationDate(Date_(2022, 6, 22));
+    Date_ exerciseDate(2024, 6, 21);
+    const String_ rsg = "mrg32";
+    const size_t num_paths = 10000;
+
+    Vector_<Cell_> eventDates(1, Cell_("STRIKE"));
+    Vector_<String_> events(1, ToString(11.0));
+    eventDates.push_back(Cell_(exerciseDate));
+    events.push_back("call pays MAX(spot() - STRIKE, 0.0)");
+    Handle_<ModelData_> model_data(new BSModelData_("bsmodel", 10.0, 0.20, 0.034, 0.021));
+
+    for (bool compiled : {false, true}) {
+        ScriptProduct_ product(eventDates, events);
+        int max_nested = product.PreProcess(false, false);
+        if (compiled)
+            product.Compile();
+        SimResults_ expected = MCSimulation<Number_>(product, model_data, num_paths, rsg, false, compiled, max_nested);
+        SimResults_ single = MCSimulation<Dual_<1>>(product, model_data, num_paths, rsg, false, compiled, max_nested);
+        SimResults_ multi = MCSimulation<Dual_<4>>(product, model_data, num_paths, rsg, false, compiled, max_nested);
+
+        ASSERT_EQ(single.risks_.size(), 5);
+        ASSERT_NEAR(single.aggregated_, expected.aggregated_, 1e-10 * expected.aggregated_);
+        ASSERT_NEAR(multi.aggregated_, expected.aggregated_, 1e-10 * expected.aggregated_);
+        for (size_t i = 0; i < expected.risks_.size(); ++i) {
+            ASSERT_NEAR(single.risks_[i], expected.risks_[i], 1e-10 * std::fabs(expected.risks_[i]));
+            ASSERT_NEAR(multi.risks_[i], expected.risks_[i], 1e-10 * std::fabs(expected.risks_[i]));
+            ASSERT_NEAR(multi.RiskStdErr(i), single.RiskStdErr(i), 1e-12);
+        }
+    }
+}
+
+TEST(ScriptTest, TestBlackScholesHessian) {
+    Global::Dates_::SetEvaluationDate(Date_(2022, 6, 22));
+    Date_ exerciseDate(2024, 6, 21);
+    const String_ rsg = "mrg32";
+    const size_t num_paths = 10000;
+    const double spot = 10.0;
+    const double vol = 0.20;
+    const double h = 1.0e-4;
+
+    Vector_<Cell_> eventDates(1, Cell_("STRIKE"));
+    Vector_<String_> events(1, ToString(11.0));
+    eventDates.push_back(Cell_(exerciseDate));
+    events.push_back("p pays spot() * spot() - STRIKE * spot()");
+    auto bsData = [&](double s, double v) { return Handle_<ModelData_>(new BSModelData_("bsmodel", s, v, 0.034, 0.021)); };
+
+    for (bool compiled : {false, true}) {
+        ScriptProduct_ product(eventDates, events);
+        int max_nested = product.PreProcess(false, false);
+        if (compiled)
+            product.Compile();
+        const SimResults_ first = MCSimulation<Dual_<1>>(product, bsData(spot, vol), num_paths, rsg, false, compiled, max_nested);
+        const HessianResults_ second = MCSimulationHessian(product, bsData(spot, vol), num_paths, {"spot", "vol", "STRIKE"}, rsg, false, compiled, max_nested);
+
+        ASSERT_NEAR(second.Mean(), first.aggregated_ / static_cast<double>(num_paths), 1e-10);
+        ASSERT_NEAR(second.risks_[0], first.risks_[0], 1e-10);
+        ASSERT_NEAR(second.risks_[1], first.risks_[1], 1e-10);
+        ASSERT_NEAR(second.risks_[2], first.risks_[4], 1e-10);
+
+        //  gamma, vanna and volga against central differences of the first order risks on the same paths
+        const SimResults_ spotUp = MCSimulation<Dual_<1>>(product, bsData(spot + h, vol), num_paths, rsg, false, compiled, max_nested);
+        const SimResults_ spotDown = MCSimulation<Dual_<1>>(product, bsData(spot - h, vol), num_paths, rsg, false, compiled, max_nested);
+        const SimResults_ volUp = MCSimulation<Dual_<1>>(product, bsData(spot, vol + h), num_paths, rsg, false, compiled, max_nested);
+        const SimResults_ volDown = MCSimulation<Dual_<1>>(product, bsData(spot, vol - h), num_paths, rsg, false, compiled, max_nested);
+        ASSERT_NEAR(second.Hessian("spot", "spot"), (spotUp.risks_[0] - spotDown.risks_[0]) / (2.0 * h), 1e-6 * std::fabs(second.Hessian("spot", "spot")));
+        ASSERT_NEAR(second.Hessian("spot", "vol"), (volUp.risks_[0] - volDown.risks_[0]) / (2.0 * h), 1e-6 * std::fabs(second.Hessian("spot", "vol")));
+        ASSERT_NEAR(second.Hessian("vol", "spot"), (spotUp.risks_[1] - spotDown.risks_[1]) / (2.0 * h), 1e-6 * std::fabs(second.Hessian("vol", "spot")));
+        ASSERT_NEAR(second.Hessian("vol", "vol"), (volUp.risks_[1] - volDown.risks_[1]) / (2.0 * h), 1e-6 * std::fabs(second.Hessian("vol", "vol")));
+        ASSERT_NEAR(second.Hessian("spot", "STRIKE"), (spotUp.risks_[4] - spotDown.risks_[4]) / (2.0 * h), 1e-6 * std::fabs(second.Hessian("spot", "STRIKE")));
+        ASSERT_NEAR(second.Hessian("STRIKE", "STRIKE"), 0.0, 1e-12);
+    }
+}
+
+TEST(ScriptTest, TestPathTapeSize) {
+    Global::Dates_::SetEvaluationDate(Date_(2022, 6, 22));
+    Vector_<Cell_> eventDates(1, Cell_("STRIKE"));
+    Vector_<String_> events(1, ToString(11.0));
+    eventDates.push_back(Cell_(Date_(2023, 6, 21)));
+    events.push_back("x = spot()");
+    eventDates.push_back(Cell_(Date_(2024, 6, 21)));
+    events.push_back(R"(
+    IF spot() > x THEN
+        y = spot() - x
+        p pays LOG(spot()) * y + MAX(y, 0.0)
+    ELSE
+        y = x - spot()
+        p pays EXP(-y)
+    END
+    )");
+    //  a spot off the grid points, so that the local volatility is interpolated on every step
+    const Vector_<> spots = {6.0, 8.0, 10.0, 12.0, 14.0, 16.0};
+    const Vector_<> times = {0.5, 1.0, 2.0, 3.0};
+    const Vector_<Handle_<ModelData_>> models = {
+        Handle_<ModelData_>(new BSModelData_("bsmodel", 10.0, 0.20, 0.034, 0.021)),
+        Handle_<ModelData_>(new DupireModelData_("dupire", 10.5, 0.034, 0.021, spots, times, Matrix_<>(spots.size(), times.size(), 0.2)))};
+
+    for (const auto& model_data : models) {
+        for (bool compiled : {false, true}) {
+            ScriptProduct_ product(eventDates, events);
+            int max_nested = product.PreProcess(true, true);
+            if (compiled)
+                product.Compile(true);
+            auto model = CreateModel<Number_>(model_data);
+            model->Allocate(product.TimeLine(), product.DefLine());
+            const AAD::TapeSize_ modelBound = model->PathTapeSize();
+            AAD::TapeSize_ bound = product.PathTapeSize();
+            bound += modelBound;
+
+            Tape_ tape;
+            TapeScope_ scope(tape);
+            Scenario_<Number_> path;
+            AllocatePath(product.DefLine(), path);
+            auto evalState = product.BuildEvalState<Number_>();
+            //  a large smoothing takes both branches of the if
+            evalState.SetDefEps(100.0);
+            auto evaluator = product.BuildFuzzyEvaluator<Number_>(max_nested, 100.0);
+            if (compiled)
+                InitModel4ParallelAAD(product, *model, path, evalState);
+            else
+                InitModel4ParallelAAD(product, *model, path, evaluator);
+            const TapeStats_ atMark = tape.Stats();
+
+            auto random = CreateRNG("mrg32", model->SimDim(), false);
+            Vector_<> gauss(model->SimDim());
+            for (int i = 0; i < 16; ++i) {
+                tape.RewindToMark();
+                random->FillNormal(&gauss);
+                model->GeneratePath(gauss, &path);
+                //  each bound holds on its own, not only in the sum
+                const TapeStats_ generated = tape.Stats();
+                ASSERT_LE(generated.nodes_ - atMark.nodes_, modelBound.nodes_);
+                ASSERT_LE(generated.derivatives_ - atMark.derivatives_, modelBound.derivatives_);
+                if (compiled)
+                    product.EvaluateCompiled(path, evalState);
+                else
+                    product.Evaluate(path, evaluator);
+                const TapeStats_ stats = tape.Stats();
+                ASSERT_GT(stats.nodes_, atMark.nodes_);
+                ASSERT_LE(stats.nodes_ - atMark.nodes_, bound.nodes_);
+                ASSERT_LE(stats.derivatives_ - atMark.derivatives_, bound.derivatives_);
+            }
+        }
+    }
+}
@@ -2,6 +2,7 @@
 // Created by wegam on 2023/5/2.
 //
 
+#include <sstream>
 #include <gtest/gtest.h>
 #include <dal/platform/platform.hpp>
 #include <dal/script/event.hpp>
@@ -61,6 +62,67 @@ TEST(ScriptTest, TestEventWithMacroDuplicated) {
     ASSERT_THROW(Script::ScriptProduct_(dates, events), Dal::ScriptError_);
 }
 
+TEST(ScriptTest, TestEventWithMacroExpandedByToken) {
+    Vector_<Cell_> dates;
+    Vector_<String_> events;
+    Global::Dates_::SetEvaluationDate(Date_(2023, 1, 1));
+
+    dates.push_back(Cell_("K"));
+    events.push_back("110.0");
+    dates.push_back(Cell_("S"));
+    events.push_back("spot()");
+    dates.push_back(Cell_("PAYOFF"));
+    events.push_back("MAX(S - K, 0.0)");
+
+    //  `S` is not replaced inside `SCALE`, and `PAYOFF` carries the already expanded `S`
+    dates.push_back((Cell_(Date_(2023, 12, 1))));
+    events.push_back("SCALE = 1 call PAYS SCALE * PAYOFF");
+
+    ScriptProduct_ product(dates, events);
+    ASSERT_EQ(product.EventDates().size(), 1);
+    ASSERT_EQ(product.Events()[0].size(), 2);
+
+    const auto* mult = dynamic_cast<NodeMulti_*>(product.Events()[0][1]->arguments_[1].get());
+    ASSERT_NE(mult, nullptr);
+    ASSERT_EQ(dynamic_cast<NodeVar_*>(mult->arguments_[0].get())->name_, "SCALE");
+    const auto* sub = dynamic_cast<NodeSub_*>(mult->arguments_[1]->arguments_[0].get());
+    ASSERT_NE(sub, nullptr);
+    ASSERT_NE(dynamic_cast<NodeSpot_*>(sub->arguments_[0].get()), nullptr);
+    ASSERT_EQ(dynamic_cast<NodeConstVar_*>(sub->arguments_[1].get())->name_, "K");
+}
+
+TEST(ScriptTest, TestEventWithMacroMixedCase) {
+    Vector_<Cell_> dates;
+    Vector_<String_> events;
+    Global::Dates_::SetEvaluationDate(Date_(2022, 5, 1));
+
+    //  macro names and placeholders match whatever their case
+    dates.push_back(Cell_("Gap"));
+    events.push_back("spot() - 110.0");
+    dates.push_back(Cell_("START: 2022-05-07 END: 2023-05-07 FREQ: 1m CALENDAR: CN.SSE"));
+    events.push_back("acc = DCF(ACT365F, periodbegin, PERIODEND) x = gap");
+    ScriptProduct_ product(dates, events);
+    ASSERT_EQ(product.EventDates().size(), 12);
+
+    const auto& e = product.Events()[0];
+    ASSERT_EQ(e.size(), 2);
+    ASSERT_NEAR(dynamic_cast<NodeConst_*>(e[0]->arguments_[1].get())->constVal_, 31.0 / 365.0, 1e-10);
+    const auto* sub = dynamic_cast<NodeSub_*>(e[1]->arguments_[1].get());
+    ASSERT_NE(sub, nullptr);
+    ASSERT_NE(dynamic_cast<NodeSpot_*>(sub->arguments_[0].get()), nullptr);
+}
+
+TEST(ScriptTest, TestEventWithMacroNotAWord) {
+    Vector_<Cell_> dates;
+    Vector_<String_> events;
+    Global::Dates_::SetEvaluationDate(Date_(2023, 1, 1));
+
+    dates.push_back(Cell_("MY STRIKE"));
+    events.push_back("110.0");
+
+    ASSERT_THROW(Script::ScriptProduct_(dates, events), Dal::ScriptError_);
+}
+
 TEST(ScriptTest, TestEventWithSchedule) {
     Global::Dates_::SetEvaluationDate(Date_(2022, 5, 1));
     Vector_<Cell_> dates;
@@ -190,4 +252,94 @@ TEST(ScriptTest, TestScriptProductWithPastDate) {
         SimResults_ results = MCSimulation<double>(product, model_data, num_paths, rsg);
         ASSERT_NEAR(results.aggregated_, 100.0, 1);
     }
-}
\ No newline at end of file
+}
+
+TEST(ScriptTest, TestScriptProductEliminateDeadCode) {
+    Global::Dates_::SetEvaluationDate(Date_(2023, 1, 1));
+    Vector_<Cell_> dates;
+    Vector_<String_> events;
+    dates.push_back(Cell_(Date_(2022, 12, 1)));
+    events.push_back("start = 100 count = 0");
+    dates.push_back(Cell_(Date_(2023, 6, 1)));
+    events.push_back("s1 = spot() count = count + 1 IF s1 > start THEN hits = 1 END");
+    dates.push_back(Cell_(Date_(2023, 12, 1)));
+    events.push_back("count = count + 1 call PAYS MAX(spot() - start, 0.0) * s1 / start");
+
+    const Handle_<ModelData_> model_data(new BSModelData_("bsmodel", 100.0, 0.2, 0.0, 0.0));
+    ScriptProduct_ full(dates, events, "call");
+    full.PreProcess(false, false);
+    full.Compile();
+    const SimResults_ expected = MCSimulation<double>(full, model_data, 1024, "mrg32", false, true);
+
+    ScriptProduct_ product(dates, events, "call");
+    product.PreProcess(false, false);
+    ASSERT_THROW(product.EliminateDeadCode(Vector_<String_>(1, "unknown")), Exception_);
+    ASSERT_EQ(product.EliminateDeadCode(), 4);
+    ASSERT_EQ(product.VarNames(), Vector_<String_>({"start", "s1", "call"}));
+    ASSERT_EQ(product.VarNames()[product.PayOffIdx()], "call");
+    ASSERT_NEAR(product.VarValues()[0], 100.0, 1e-10);
+    ASSERT_EQ(product.PastEvents()[0].size(), 1);
+    ASSERT_EQ(product.Events()[0].size(), 1);
+    std::ostringstream log;
+    product.Debug(log);
+    ASSERT_NE(log.str().find("Removed variable: count"), String_::npos);
+    ASSERT_NE(log.str().find("Removed statement:"), String_::npos);
+
+    product.Compile();
+    ASSERT_THROW(product.EliminateDeadCode(), Exception_);
+    const SimResults_ results = MCSimulation<double>(product, model_data, 1024, "mrg32", false, true);
+    ASSERT_NEAR(results.aggregated_, expected.aggregated_, 1e-8);
+
+    //  reported variables are kept live
+    ScriptProduct_ reported(dates, events, "call");
+    reported.PreProcess(false, false);
+    ASSERT_EQ(reported.EliminateDeadCode(Vector_<String_>(1, "count")), 1);
+    ASSERT_EQ(reported.VarNames().size(), 4);
+}
+
+TEST(ScriptTest, TestScriptProductDataPreProcessedCache) {
+    Vector_<Cell_> dates;
+    Vector_<String_> events;
+    dates.push_back((Cell_(Date_(2023, 12, 1))));
+    events.push_back("call PAYS MAX(spot() - 110.0, 0.0)");
+    const ScriptProductData_ data("call", dates, events);
+
+    Global::Dates_::SetEvaluationDate(Date_(2023, 1, 1));
+    size_t max_nested = 99;
+    const auto p1 = data.PreProcessed(false, false, true, &max_nested);
+    ASSERT_TRUE(p1->IsCompiled());
+    ASSERT_EQ(max_nested, 0);
+    ASSERT_EQ(p1.get(), data.PreProcessed(false, false, true).get());
+    ASSERT_NE(p1.get(), data.PreProcessed(false, false, false).get());
+    ASSERT_FALSE(data.PreProcessed(false, false, false)->IsCompiled());
+
+    Global::Dates_::SetEvaluationDate(Date_(2023, 2, 1));
+    ASSERT_NE(p1.get(), data.PreProcessed(false, false, true).get());
+}
+
+TEST(ScriptTest, TestPreProcessedSharedByContent) {
+    Vector_<Cell_> dates;
+    Vector_<String_> events;
+    dates.push_back((Cell_(Date_(2023, 12, 1))));
+    events.push_back("put PAYS MAX(105.0 - spot(), 0.0)");
+    const ScriptProductData_ data("put", dates, events);
+    //  rebuilt from the same table, as a repeat valuation would
+    const ScriptProductData_ same("other_put", dates, events);
+    Vector_<String_> otherEvents(1, "put PAYS MAX(104.0 - spot(), 0.0)");
+    const ScriptProductData_ other("put", dates, otherEvents);
+
+    Global::Dates_::SetEvaluationDate(Date_(2023, 1, 1));
+    const auto p1 = data.PreProcessed(false, false, true);
+    ASSERT_EQ(p1.get(), same.PreProcessed(false, false, true).get());
+    ASSERT_NE(p1.get(), other.PreProcessed(false, false, true).get());
+    ASSERT_NE(p1.get(), same.PreProcessed(true, false, true).get());
+
+    //  products handed out outlive the cache
+    ClearPreProcessedProducts();
+    ASSERT_EQ(NumPreProcessedProducts(), 0);
+    ASSERT_TRUE(p1->IsCompiled());
+    const auto p2 = same.PreProcessed(false, false, true);
+    ASSERT_NE(p1.get(), p2.get());
+    ASSERT_EQ(p2.get(), data.PreProcessed(false, false, true).get());
+    ASSERT_EQ(NumPreProcessedProducts(), 1);
+}
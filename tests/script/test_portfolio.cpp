@@ -0,0 +1,92 @@
+//
+// Created by wegam on 2024/10/20.
+//
+
+#include <gtest/gtest.h>
+#include <dal/platform/platform.hpp>
+#include <dal/model/blackscholes.hpp>
+#include <dal/storage/globals.hpp>
+#include <dal/script/portfolio.hpp>
+
+using namespace Dal;
+using namespace Dal::AAD;
+using namespace Dal::Script;
+
+namespace {
+    std::unique_ptr<ScriptProduct_> MakeCall(double strike, const Date_& maturity) {
+        Vector_<Cell_> eventDates(1, Cell_("STRIKE"));
+        Vector_<String_> events(1, ToString(strike));
+        eventDates.push_back(Cell_(maturity));
+        events.push_back("call pays MAX(spot() - STRIKE, 0.0)");
+        return std::make_unique<ScriptProduct_>(eventDates, events);
+    }
+}
+
+TEST(ScriptTest, TestMergeTimeLines) {
+    Global::Dates_::SetEvaluationDate(Date_(2022, 6, 22));
+    auto call1 = MakeCall(11.0, Date_(2024, 6, 21));
+    auto call2 = MakeCall(10.0, Date_(2023, 6, 21));
+    auto call3 = MakeCall(9.0, Date_(2024, 6, 21));
+    for (auto p : {call1.get(), call2.get(), call3.get()})
+        p->PreProcess(false, false);
+
+    PortfolioTimeLine_ merged = MergeTimeLines({call1.get(), call2.get(), call3.get()});
+    ASSERT_EQ(merged.timeLine_.size(), 2);
+    ASSERT_EQ(merged.defLine_.size(), 2);
+    ASSERT_DOUBLE_EQ(merged.timeLine_[0], call2->TimeLine()[0]);
+    ASSERT_DOUBLE_EQ(merged.timeLine_[1], call1->TimeLine()[0]);
+    ASSERT_EQ(merged.indices_[0][0], 1);
+    ASSERT_EQ(merged.indices_[1][0], 0);
+    ASSERT_EQ(merged.indices_[2][0], 1);
+    ASSERT_TRUE(merged.defLine_[0].numeraire_);
+}
+
+TEST(ScriptTest, TestPortfolioSimulation) {
+    Global::Dates_::SetEvaluationDate(Date_(2022, 6, 22));
+    const Date_ maturity(2024, 6, 21);
+    const size_t num_paths = 100000;
+    Handle_<ModelData_> model_data(new BSModelData_("bsmodel", 10.0, 0.20, 0.034, 0.021));
+
+    auto call1 = MakeCall(11.0, maturity);
+    auto call2 = MakeCall(9.0, maturity);
+    for (auto p : {call1.get(), call2.get()}) {
+        p->PreProcess(false, false);
+        p->Compile();
+    }
+
+    PortfolioResults_ results = MCPortfolioSimulation<double>({call1.get(), call2.get()}, model_data, num_paths, "sobol");
+    SimResults_ expected1 = MCSimulation<double>(*call1, model_data, num_paths, "sobol", false, true);
+    SimResults_ expected2 = MCSimulation<double>(*call2, model_data, num_paths, "sobol", false, true);
+
+    // same time line, hence same paths as the single product runs
+    ASSERT_NEAR(results.products_[0].aggregated_, expected1.aggregated_, 1e-10 * expected1.aggregated_);
+    ASSERT_NEAR(results.products_[1].aggregated_, expected2.aggregated_, 1e-10 * expected2.aggregated_);
+    ASSERT_NEAR(results.products_[0].StdErr(), expected1.StdErr(), 1e-8);
+    ASSERT_NEAR(results.total_.Mean(), expected1.Mean() + expected2.Mean(), 1e-10);
+    ASSERT_GT(results.total_.StdErr(), 0.0);
+}
+
+TEST(ScriptTest, TestPortfolioSimulationAAD) {
+    Global::Dates_::SetEvaluationDate(Date_(2022, 6, 22));
+    const size_t num_paths = 100000;
+    Handle_<ModelData_> model_data(new BSModelData_("bsmodel", 10.0, 0.20, 0.034, 0.021));
+
+    auto call1 = MakeCall(11.0, Date_(2024, 6, 21));
+    auto call2 = MakeCall(10.0, Date_(2023, 6, 21));
+    for (auto p : {call1.get(), call2.get()}) {
+        p->PreProcess(false, false);
+        p->Compile();
+    }
+
+    PortfolioResults_ results = MCPortfolioSimulation<Number_>({call1.get(), call2.get()}, model_data, num_paths, "sobol");
+    SimResults_ expected1 = MCSimulation<Number_>(*call1, model_data, num_paths, "sobol", false, true);
+    SimResults_ expected2 = MCSimulation<Number_>(*call2, model_data, num_paths, "sobol", false, true);
+
+    ASSERT_EQ(results.products_.size(), 2);
+    ASSERT_NEAR(results.products_[0].Mean(), expected1.Mean(), 4.0 * expected1.StdErr());
+    ASSERT_NEAR(results.products_[1].Mean(), expected2.Mean(), 4.0 * expected2.StdErr());
+    for (size_t j = 0; j < results.total_.risks_.size(); ++j) {
+        const double tol = 4.0 * (expected1.RiskStdErr(j) + expected2.RiskStdErr(j));
+        ASSERT_NEAR(results.total_.risks_[j], expected1.risks_[j] + expected2.risks_[j], tol);
+    }
+}
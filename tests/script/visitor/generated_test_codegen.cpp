@@ -0,0 +1,44 @@
+//
+//  Generated from script product test_codegen, do not edit
+//
+
+#include <dal/platform/platform.hpp>
+#include <dal/script/generated.hpp>
+
+namespace Dal::Script::Generated {
+    namespace {
+        template <class T_> void Event0([[maybe_unused]] const AAD::Sample_<T_>& s, EvalState_<T_>& state) {
+            [[maybe_unused]] auto& v = state.variables_;
+            v[0] = s.spot_;
+            v[1] = T_(0.0);
+            v[2] = T_(1.0);
+        }
+
+        template <class T_> void Event1([[maybe_unused]] const AAD::Sample_<T_>& s, EvalState_<T_>& state) {
+            [[maybe_unused]] auto& v = state.variables_;
+            if ((((s.spot_ - v[0]) > 0.0) && !((s.spot_ - (2.0 * v[0])) == 0.0))) {
+                if (((s.spot_ - (1.5 * v[0])) >= 0.0)) {
+                    v[1] = T_(2.0);
+                    if ((((3.0 - v[1]) > 0.0) || ((s.spot_ - 2.0) > 0.0))) {
+                        v[2] = ((sqrt(s.spot_) - log(v[0])) + exp(-(v[1])));
+                    } else {
+                        v[2] = -(v[2]);
+                    }
+                } else {
+                    v[1] = T_(1.0);
+                }
+            } else {
+                v[1] = ((Generated::Min2<T_>(s.spot_, v[0]) / v[0]) - pow(s.spot_, 0.5));
+                if (((0.0 - v[1]) > 0.0)) {
+                    v[1] = Generated::Max2<T_>(s.spot_, 0.90000000000000002);
+                }
+            }
+            v[3] += ((Generated::Max2<T_>((s.spot_ - v[0]), 0.0) + (v[1] * v[2])) + (1.0 / v[0])) / s.numeraire_;
+        }
+
+        [[maybe_unused]] const bool registered_ = Register(GeneratedProduct_{"test_codegen",
+                                                                  0xde630754071700c4ULL,
+                                                                  {&Event0<double>, &Event1<double>},
+                                                                  {&Event0<AAD::Number_>, &Event1<AAD::Number_>}});
+    } // namespace
+} // namespace Dal::Script::Generated
@@ -0,0 +1,120 @@
+//
+// Created by wegam on 2024/11/18.
+//
+
+#include <gtest/gtest.h>
+#include <dal/platform/platform.hpp>
+#include <dal/script/event.hpp>
+#include <dal/storage/globals.hpp>
+
+using namespace Dal;
+using namespace Dal::Script;
+
+namespace {
+    //  generated_test_codegen.cpp is the output of GenerateCpp("test_codegen") on this product
+    ScriptProduct_ CodegenProduct(const String_& payoff = "MAX(spot() - x, 0) + y * w + 1 / x") {
+        Global::Dates_::SetEvaluationDate(Date_(2023, 1, 1));
+        Vector_<String_> events = {R"(
+        x = spot()
+        y = 0
+        w = 1
+    )",
+                                   R"(
+    IF spot() > x AND spot() != 2 * x THEN
+        IF spot() >= 1.5 * x THEN
+            y = 2 * w + y
+            IF y < 3 OR spot() > 2 THEN
+                w = SQRT(spot()) - LOG(x) + EXP(-y)
+            ELSE
+                w = -w
+            END
+        ELSE
+            y = 1
+        END
+    ELSE
+        y = MIN(spot(), x) / x - spot() ^ 0.5
+        IF y < 0 THEN
+            y = MAX(spot(), 0.9)
+        END
+    END
+    z pays )" + payoff};
+        Vector_<Cell_> eventDates{Cell_(Date_(2023, 1, 28)), Cell_(Date_(2023, 1, 30))};
+        return ScriptProduct_(eventDates, events);
+    }
+
+    template <class T_> Scenario_<T_> CodegenScenario(double spot) {
+        Scenario_<T_> scenario(2);
+        scenario[0].spot_ = 1.0;
+        scenario[0].numeraire_ = 1.0;
+        scenario[1].spot_ = spot;
+        scenario[1].numeraire_ = 1.1;
+        return scenario;
+    }
+} // namespace
+
+TEST(ScriptTest, TestGenerateCpp) {
+    ScriptProduct_ product = CodegenProduct();
+    product.PreProcess(false, true);
+    ASSERT_THROW(product.GenerateCpp("test_codegen"), Exception_);
+    product.Compile();
+    const String_ code = product.GenerateCpp("test_codegen");
+    ASSERT_NE(code.find("template <class T_> void Event1"), String_::npos);
+    ASSERT_NE(code.find("Register(GeneratedProduct_{\"test_codegen\""), String_::npos);
+
+    //  a fuzzy compiled form has no generated counterpart
+    ScriptProduct_ fuzzy = CodegenProduct();
+    fuzzy.PreProcess(true, true);
+    fuzzy.Compile(true);
+    ASSERT_THROW(fuzzy.GenerateCpp("test_codegen"), Exception_);
+    ASSERT_FALSE(fuzzy.BindGenerated("test_codegen"));
+}
+
+TEST(ScriptTest, TestBindGenerated) {
+    ScriptProduct_ interpreted = CodegenProduct();
+    interpreted.PreProcess(false, true);
+    interpreted.Compile();
+    ScriptProduct_ generated = CodegenProduct();
+    generated.PreProcess(false, true);
+    generated.Compile();
+    ASSERT_TRUE(generated.BindGenerated("test_codegen"));
+    ASSERT_TRUE(generated.IsGenerated());
+    ASSERT_FALSE(generated.BindGenerated("no_such_product"));
+    ASSERT_FALSE(generated.IsGenerated());
+    ASSERT_TRUE(generated.BindGenerated("test_codegen"));
+
+    //  another script does not bind the code generated for this one
+    ScriptProduct_ other = CodegenProduct("MAX(spot() - x, 0) + y * w");
+    other.PreProcess(false, true);
+    other.Compile();
+    ASSERT_FALSE(other.BindGenerated("test_codegen"));
+
+    AAD::Tape_* mainTape = AAD::Number_::Tape();
+    AAD::Tape_ tape;
+    AAD::Number_::SetTape(tape);
+    const Vector_<> spots = {0.5, 0.9, 1.0, 1.2, 1.5, 1.8, 2.0, 2.5, 3.0};
+    for (auto s : spots) {
+        auto state = interpreted.BuildEvalState<double>();
+        auto generated_state = generated.BuildEvalState<double>();
+        interpreted.EvaluateCompiled(CodegenScenario<double>(s), state);
+        generated.EvaluateCompiled(CodegenScenario<double>(s), generated_state);
+        for (size_t i = 0; i < interpreted.VarNames().size(); ++i)
+            ASSERT_DOUBLE_EQ(generated_state.variables_[i], state.variables_[i]);
+
+        //  same derivatives to the spots
+        double adjoints[2][2];
+        for (int k = 0; k < 2; ++k) {
+            tape.Clear();
+            Scenario_<AAD::Number_> scenario = CodegenScenario<AAD::Number_>(s);
+            scenario[0].spot_.PutOnTape();
+            scenario[1].spot_.PutOnTape();
+            auto number_state = interpreted.BuildEvalState<AAD::Number_>();
+            (k ? generated : interpreted).EvaluateCompiled(scenario, number_state);
+            number_state.variables_[3].PropagateToStart();
+            adjoints[k][0] = scenario[0].spot_.Adjoint();
+            adjoints[k][1] = scenario[1].spot_.Adjoint();
+        }
+        ASSERT_NEAR(adjoints[1][0], adjoints[0][0], 1e-12);
+        ASSERT_NEAR(adjoints[1][1], adjoints[0][1], 1e-12);
+    }
+    AAD::Number_::SetTape(*mainTape);
+}
@@ -79,4 +79,206 @@ TEST(ScriptTest, TestCompileWithSeveralEvents) {
 
     ASSERT_DOUBLE_EQ(eval_state.variables_[0], 4);
     ASSERT_DOUBLE_EQ(eval_state.variables_[1], 7);
-}
\ No newline at end of file
+}
+
+TEST(ScriptTest, TestCompileBatch) {
+    Global::Dates_::SetEvaluationDate(Date_(2023, 1, 1));
+    Vector_<String_> events = {R"(
+        x = spot()
+        y = 0
+    )",
+    R"(
+    IF spot() > x THEN
+        IF spot() >= 2 * x THEN
+            y = 2
+        ELSE
+            y = 1
+        END
+    ELSE
+        y = -1
+    END
+    z pays MAX(spot() - x, 0) + y
+    )"};
+    Vector_<Cell_> eventDates{Cell_(Date_(2023, 1, 28)), Cell_(Date_(2023, 1, 30))};
+
+    ScriptProduct_ product(eventDates, events);
+    product.PreProcess(false, true);
+    product.Compile();
+
+    const size_t width = 5;
+    const Vector_<> spots = {0.5, 1.0, 2.0, 3.0, 0.9};
+    AAD::BatchScenario_ batch;
+    AAD::AllocateBatchPath(Vector_<AAD::SampleDef_>(2), width, batch);
+    AAD::InitializeBatchPath(batch);
+    for (size_t k = 0; k < width; ++k) {
+        batch[0].spot_[k] = 1.0;
+        batch[1].spot_[k] = spots[k];
+        batch[1].numeraire_[k] = 1.0 + 0.1 * k;
+    }
+
+    BatchEvalState_ batch_state = product.BuildBatchEvalState(width);
+    product.EvaluateCompiledBatch(batch, batch_state);
+
+    for (size_t k = 0; k < width; ++k) {
+        Scenario_<double> scenario(2);
+        scenario[0].spot_ = 1.0;
+        scenario[0].numeraire_ = 1.0;
+        scenario[1].spot_ = spots[k];
+        scenario[1].numeraire_ = 1.0 + 0.1 * k;
+        EvalState_<double> eval_state(Vector_<>(product.VarNames().size(), 0.0));
+        product.EvaluateCompiled(scenario, eval_state);
+        for (size_t i = 0; i < product.VarNames().size(); ++i)
+            ASSERT_DOUBLE_EQ(batch_state.Var(i)[k], eval_state.variables_[i]);
+    }
+}
+
+TEST(ScriptTest, TestCompileBatchSmooth) {
+    //  x = SMOOTH(spot(), 2, 5, 0.5): no script emits it, the stream is written by hand
+    const Vector_<int> nodes = {Spot, Const, 0, Const, 1, Const, 2, Smooth, Assign, 0};
+    const Vector_<> consts = {2.0, 5.0, 0.5};
+    //  left of, on the edges of and inside the smoothing interval, then right of it
+    const Vector_<> spots = {-1.0, -0.25, -0.1, 0.0, 0.2, 0.25, 1.0};
+    const Vector_<> expected = {5.0, 5.0, 4.1, 3.5, 2.3, 2.0, 2.0};
+
+    const size_t width = spots.size();
+    AAD::BatchSample_ batch;
+    batch.Allocate(width);
+    batch.Initialize();
+    for (size_t k = 0; k < width; ++k)
+        batch.spot_[k] = spots[k];
+    BatchEvalState_ batch_state(Vector_<>(1, 0.0), width);
+    EvalCompiledBatch(nodes, consts, batch, batch_state);
+
+    for (size_t k = 0; k < width; ++k) {
+        Scenario_<double> scenario(1);
+        scenario[0].spot_ = spots[k];
+        EvalState_<double> eval_state(Vector_<>(1, 0.0));
+        EvalCompiled(nodes, consts, Vector_<const void*>(), scenario[0], eval_state);
+        ASSERT_NEAR(eval_state.variables_[0], expected[k], 1e-12);
+        ASSERT_DOUBLE_EQ(batch_state.Var(0)[k], eval_state.variables_[0]);
+    }
+}
+
+TEST(ScriptTest, TestCompileFuzzy) {
+    Global::Dates_::SetEvaluationDate(Date_(2023, 1, 1));
+    Vector_<String_> events = {R"(
+        x = spot()
+        y = 0
+    )",
+    R"(
+    IF spot() > x AND spot() != 2 * x THEN
+        IF spot() >= 1.5 * x:0.2 THEN
+            y = 2
+        ELSE
+            y = 1
+        END
+    ELSE
+        y = -1
+    END
+    IF y > 0 OR spot() < 0.8 * x THEN
+        y = y + 10
+    END
+    z pays MAX(spot() - x, 0) + y
+    )"};
+    Vector_<Cell_> eventDates{Cell_(Date_(2023, 1, 28)), Cell_(Date_(2023, 1, 30))};
+
+    ScriptProduct_ product(eventDates, events);
+    const size_t maxNestedIfs = product.PreProcess(true, true);
+    product.Compile(true);
+
+    const double eps = 0.1;
+    auto evaluator = product.BuildFuzzyEvaluator<double>(static_cast<int>(maxNestedIfs), eps);
+    auto eval_state = product.BuildEvalState<double>();
+    eval_state.SetDefEps(eps);
+    const Vector_<> spots = {0.5, 0.78, 0.82, 1.0, 1.02, 1.46, 1.5, 1.55, 1.98, 2.0, 2.03, 3.0};
+    for (auto s : spots) {
+        Scenario_<double> scenario(2);
+        scenario[0].spot_ = 1.0;
+        scenario[0].numeraire_ = 1.0;
+        scenario[1].spot_ = s;
+        scenario[1].numeraire_ = 1.0;
+        product.Evaluate(scenario, evaluator);
+        product.EvaluateCompiled(scenario, eval_state);
+        for (size_t i = 0; i < product.VarNames().size(); ++i)
+            ASSERT_NEAR(eval_state.variables_[i], evaluator.VarVals()[i], 1e-12);
+    }
+}
+
+TEST(ScriptTest, TestRegistersFuseInstructions) {
+    //  IF spot() >= 2 THEN y = x * 3 + y END
+    const Vector_<int> nodes = {Spot, SubConst, 0, SupEqual, If, 15, Var, 0, MultiConst, 1, Var, 1, Add, Assign, 1};
+    const Vector_<> consts = {2.0, 3.0};
+    const RegProgram_ program = ToRegisters(nodes, consts);
+    ASSERT_TRUE(program.IsValid());
+    ASSERT_EQ(program.code_.size(), 5);
+    ASSERT_EQ(program.code_[0].op_, RegSpotSubConst);
+    ASSERT_EQ(program.code_[1].op_, RegJumpIfNotSupEqual);
+    ASSERT_EQ(program.code_[1].dst_, 4);
+    ASSERT_EQ(program.code_[2].op_, RegVarMultiConstAddVar);
+    ASSERT_EQ(program.code_[3].op_, RegAssign);
+    ASSERT_EQ(program.code_[4].op_, RegStop);
+
+    EvalState_<double> state(Vector_<>{1.0, 0.5});
+    AAD::Sample_<double> sample;
+    sample.spot_ = 2.5;
+    EvalRegisters(program, sample, state);
+    ASSERT_DOUBLE_EQ(state.variables_[1], 3.5);
+    sample.spot_ = 1.5;
+    EvalRegisters(program, sample, state);
+    ASSERT_DOUBLE_EQ(state.variables_[1], 3.5);
+
+    //  fuzzy instructions have no register form
+    ASSERT_FALSE(ToRegisters(Vector_<int>{Spot, FuzzySup, 0}, Vector_<>{0.1}).IsValid());
+}
+
+TEST(ScriptTest, TestCompileRegisters) {
+    Global::Dates_::SetEvaluationDate(Date_(2023, 1, 1));
+    Vector_<String_> events = {R"(
+        x = spot()
+        y = 0
+        w = 1
+    )",
+    R"(
+    IF spot() > x AND spot() != 2 * x THEN
+        IF spot() >= 1.5 * x THEN
+            y = 2 * w + y
+            IF y < 3 OR spot() > 2 THEN
+                w = SQRT(spot()) - LOG(x) + EXP(-y)
+            ELSE
+                w = -w
+            END
+        ELSE
+            y = 1
+        END
+    ELSE
+        y = MIN(spot(), x) / x - spot() ^ 0.5
+        IF y < 0 THEN
+            y = MAX(spot(), 0.9)
+        END
+    END
+    z pays MAX(spot() - x, 0) + y * w + 1 / x
+    )"};
+    Vector_<Cell_> eventDates{Cell_(Date_(2023, 1, 28)), Cell_(Date_(2023, 1, 30))};
+
+    ScriptProduct_ stack(eventDates, events);
+    stack.PreProcess(false, true);
+    stack.Compile(false, false);
+    ScriptProduct_ registers(eventDates, events);
+    registers.PreProcess(false, true);
+    registers.Compile();
+
+    const Vector_<> spots = {0.5, 0.9, 1.0, 1.2, 1.5, 1.8, 2.0, 2.5, 3.0};
+    for (auto s : spots) {
+        Scenario_<double> scenario(2);
+        scenario[0].spot_ = 1.0;
+        scenario[0].numeraire_ = 1.0;
+        scenario[1].spot_ = s;
+        scenario[1].numeraire_ = 1.1;
+        auto stack_state = stack.BuildEvalState<double>();
+        auto register_state = registers.BuildEvalState<double>();
+        stack.EvaluateCompiled(scenario, stack_state);
+        registers.EvaluateCompiled(scenario, register_state);
+        for (size_t i = 0; i < registers.VarNames().size(); ++i)
+            ASSERT_DOUBLE_EQ(register_state.variables_[i], stack_state.variables_[i]);
+    }
+}
@@ -0,0 +1,68 @@
+//
+// Created by wegam on 2024/11/20.
+//
+
+#include <gtest/gtest.h>
+#include <dal/platform/platform.hpp>
+#include <dal/script/parser.hpp>
+#include <dal/script/visitor/all.hpp>
+
+using namespace Dal;
+using namespace Dal::Script;
+
+TEST(ScriptTest, TestLivenessProcessor) {
+    Parser_ parser;
+    String_ event = R"(
+        x = spot()
+        aux = x * 2
+        y = x + 1
+        y = y * 3
+        call PAYS y
+    )";
+    auto res = parser.Parse(event);
+
+    VarIndexer_ indexer;
+    for (auto& stat : res)
+        stat->Accept(indexer);
+    // x: 0, aux: 1, y: 2, call: 3
+    LivenessProcessor_ proc(std::set<size_t>({3}));
+    proc.ProcessEvent(res);
+
+    ASSERT_EQ(res.size(), 4);
+    ASSERT_EQ(proc.Removed().size(), 1);
+    ASSERT_EQ(proc.Live(), std::set<size_t>({3}));
+}
+
+TEST(ScriptTest, TestLivenessProcessorWithIf) {
+    Parser_ parser;
+    String_ event = R"(
+        IF spot() > 100 THEN
+            aux = 1
+            y = 2
+        ELSE
+            aux = 2
+        END
+        IF spot() > 110 THEN
+            aux = 3
+        END
+        call PAYS y
+    )";
+    auto res = parser.Parse(event);
+
+    VarIndexer_ indexer;
+    for (auto& stat : res)
+        stat->Accept(indexer);
+    // aux: 0, y: 1, call: 2
+    LivenessProcessor_ proc(std::set<size_t>({2}));
+    proc.ProcessEvent(res);
+
+    // the second if is left without statements, the first one without else
+    ASSERT_EQ(res.size(), 2);
+    ASSERT_EQ(proc.Removed().size(), 3);
+    const auto* pIf = dynamic_cast<NodeIf_*>(res[0].get());
+    ASSERT_NE(pIf, nullptr);
+    ASSERT_EQ(pIf->arguments_.size(), 2);
+    ASSERT_EQ(pIf->firstElse_, -1);
+    // y is not assigned when the condition is false
+    ASSERT_EQ(proc.Live(), std::set<size_t>({1, 2}));
+}